@@ -23,13 +23,107 @@
 #include <vector>
 #include <map>
 #include <iostream>
+#include <sstream>
+#include <iomanip>
 #include <cstring>
+#include <cstdlib>
+#include <climits>
+#include <cfloat>
+#include <memory>
+#ifdef _WIN32
+#include <io.h>
+#include <fcntl.h>
+#endif
 
 #include "documentClassifier.h"
+#include "documentPipeline.h"
+#include "catWordDataFactory.h"
+#include "countsFile.h"
+#include "crossValidator.h"
+#include "classifyWorkers.h"
+#include "documentCache.h"
+#include "documentStats.h"
+#include "classifyMetrics.h"
+#include "eventTracer.h"
+#include "classifyStats.h"
+#include "resultWriter.h"
+#include "stopwords.h"
 #include "baseException.h"
 
 using namespace std;
 
+// Values of all program arguments
+struct ProgramOptions
+{
+    ProgramOptions() : _trainingDirs(), _trainingCounts(), _classifyFiles(),
+                       _stopwordsFile("stopwords.txt"), _traceInfo(false), _pipelineSettings(),
+                       _emitCounts(), _mergeCounts(), _crossValidateFolds(0), _cacheFile(),
+                       _evaluateDirs(), _scoring(), _workers(0), _workerList(),
+                       _workerOutput(), _workerModel(), _documentStats(false),
+                       _metricsFile(), _resultFormat(TextResults), _backgroundWrite(false),
+                       _traceFile(), _traceRates(TraceEventCount, DefaultTraceRate),
+                       _dumpTrace() {}
+
+    // Share of documents traced for each event, unless set
+    static const double DefaultTraceRate;
+
+    // Use default copy constructor, copy operator and destructor
+
+    vector<string> _trainingDirs;
+    vector<string> _trainingCounts;
+    vector<string> _classifyFiles;
+    string _stopwordsFile;
+    bool _traceInfo;
+    PipelineSettings _pipelineSettings;
+
+    // Write training counts to this file instead of classifying
+    string _emitCounts;
+
+    // Counts files to merge into the emit counts file
+    vector<string> _mergeCounts;
+
+    // Cross validate the training data with this many folds instead of classifying
+    unsigned short _crossValidateFolds;
+
+    // Save document word data here between runs
+    string _cacheFile;
+
+    // Directories of documents by category to measure accuracy on instead of classifying
+    vector<string> _evaluateDirs;
+
+    // How documents are scored against each category
+    ScoringSettings _scoring;
+
+    // Classify in this many separate processes. Zero or one for this process only
+    unsigned short _workers;
+
+    /* When run as a worker, the file listing the documents to classify,
+        where to write their results, and the hashed model file to map if the
+        model is not a counts file */
+    string _workerList;
+    string _workerOutput;
+    string _workerModel;
+
+    // Report the slowest and largest documents processed on exit
+    bool _documentStats;
+
+    // Write classification latencies and counts here on exit, for Prometheus
+    string _metricsFile;
+
+    // How classification results are printed, and if a separate thread writes them
+    ResultFormat _resultFormat;
+    bool _backgroundWrite;
+
+    // Trace a sample of documents to this file, with these rates by event
+    string _traceFile;
+    vector<double> _traceRates;
+
+    // Print this trace file and exit
+    string _dumpTrace;
+};
+
+const double ProgramOptions::DefaultTraceRate = 0.01;
+
 // Class to parse arguments. Used to reduce method scope
 /* Format of input is a switch followed by values for that switch.
     Specifying multiple switches is allowed; the values are merged.
@@ -41,17 +135,23 @@ class ArgumentParser
 {
 public:
 // Parse arguments, returns true if they are valid
-static bool parse(int argc, char** argv, vector<string>& trainingDirs,
-                  vector<string>& classifyFiles, string& stopwordsFile,
-                  bool& traceInfo)
+static bool parse(int argc, char** argv, ProgramOptions& options)
 {
     // Set default values
-    trainingDirs.clear();
-    classifyFiles.clear();
-    stopwordsFile = string("stopwords.txt");
-    traceInfo = false;
+    options = ProgramOptions();
+    vector<string>& trainingDirs = options._trainingDirs;
+    vector<string>& classifyFiles = options._classifyFiles;
+    PipelineSettings& pipelineSettings = options._pipelineSettings;
 
     bool seenStopwords = false;
+    bool seenEmitCounts = false;
+    bool seenCacheFile = false;
+    bool seenWorkerList = false;
+    bool seenWorkerOutput = false;
+    bool seenWorkerModel = false;
+    bool seenMetricsFile = false;
+    bool seenTraceFile = false;
+    bool seenDumpTrace = false;
 
     int index = 1; // 0 is the program name
     bool valid = true;
@@ -83,13 +183,177 @@ static bool parse(int argc, char** argv, vector<string>& trainingDirs,
             else {
                 if (seenStopwords)
                     cerr << "WARNING: --stopwords-file specified twice, previous value ignored" << endl;
-                stopwordsFile = string(argv[index]);
+                options._stopwordsFile = string(argv[index]);
                 seenStopwords = true;
                 index++;
             }
         } // Stopwoards file
         else if (strcmp(argv[index], "--trace-info") == 0) {
-            traceInfo = true;
+            options._traceInfo = true;
+            index++;
+        }
+        else if (strcmp(argv[index], "--training-counts") == 0) {
+            index++;
+            int valueCount = getValues(argc, argv, index, options._trainingCounts);
+            if (!valueCount)
+                cerr << "WARNING: --training-counts option specified with no values" << endl;
+            index += valueCount;
+        }
+        else if (strcmp(argv[index], "--emit-counts") == 0) {
+            index++;
+            valid = getFileName(argc, argv, index, "--emit-counts", options._emitCounts,
+                                seenEmitCounts);
+        }
+        else if (strcmp(argv[index], "--evaluate") == 0) {
+            index++;
+            int valueCount = getValues(argc, argv, index, options._evaluateDirs);
+            if (!valueCount)
+                cerr << "WARNING: --evaluate option specified with no values" << endl;
+            index += valueCount;
+        }
+        else if (strcmp(argv[index], "--cross-validate") == 0) {
+            index++;
+            valid = getCount(argc, argv, index, "--cross-validate", options._crossValidateFolds);
+        }
+        else if (strcmp(argv[index], "--merge-counts") == 0) {
+            index++;
+            int valueCount = getValues(argc, argv, index, options._mergeCounts);
+            if (!valueCount)
+                cerr << "WARNING: --merge-counts option specified with no values" << endl;
+            index += valueCount;
+        }
+        else if (strcmp(argv[index], "--cache-file") == 0) {
+            index++;
+            valid = getFileName(argc, argv, index, "--cache-file", options._cacheFile,
+                                seenCacheFile);
+        }
+        else if (strcmp(argv[index], "--scoring-model") == 0) {
+            index++;
+            valid = getScoringModel(argc, argv, index, options._scoring._model);
+        }
+        else if (strcmp(argv[index], "--output-format") == 0) {
+            index++;
+            valid = getResultFormat(argc, argv, index, options._resultFormat);
+        }
+        else if (strcmp(argv[index], "--background-write") == 0) {
+            options._backgroundWrite = true;
+            index++;
+        }
+        else if (strcmp(argv[index], "--known-word-weight") == 0) {
+            index++;
+            valid = getWeight(argc, argv, index, "--known-word-weight",
+                              options._scoring._knownWordWeight);
+        }
+        else if (strcmp(argv[index], "--read-threads") == 0) {
+            index++;
+            valid = getCount(argc, argv, index, "--read-threads", pipelineSettings._readThreads);
+        }
+        else if (strcmp(argv[index], "--tokenize-threads") == 0) {
+            index++;
+            valid = getCount(argc, argv, index, "--tokenize-threads",
+                             pipelineSettings._tokenizeThreads);
+        }
+        else if (strcmp(argv[index], "--stem-threads") == 0) {
+            index++;
+            valid = getCount(argc, argv, index, "--stem-threads", pipelineSettings._stemThreads);
+        }
+        else if (strcmp(argv[index], "--score-threads") == 0) {
+            index++;
+            valid = getCount(argc, argv, index, "--score-threads", pipelineSettings._scoreThreads);
+        }
+        else if (strcmp(argv[index], "--queue-size") == 0) {
+            index++;
+            valid = getCount(argc, argv, index, "--queue-size", pipelineSettings._queueSize);
+        }
+        else if (strcmp(argv[index], "--progress") == 0) {
+            index++;
+            valid = getCount(argc, argv, index, "--progress", pipelineSettings._progressInterval);
+        }
+        else if (strcmp(argv[index], "--sketch-training") == 0) {
+            index++;
+            unsigned long long heavyHitters = 0;
+            valid = getLargeCount(argc, argv, index, "--sketch-training", heavyHitters);
+            options._scoring._sketch._heavyHitters = (size_t)heavyHitters;
+        }
+        else if (strcmp(argv[index], "--sketch-error") == 0) {
+            index++;
+            valid = getRate(argc, argv, index, "--sketch-error", options._scoring._sketch._errorRate);
+        }
+        else if (strcmp(argv[index], "--sketch-failure") == 0) {
+            index++;
+            valid = getRate(argc, argv, index, "--sketch-failure",
+                            options._scoring._sketch._failureRate);
+        }
+        else if (strcmp(argv[index], "--hash-features") == 0) {
+            index++;
+            valid = getCount(argc, argv, index, "--hash-features", options._scoring._hashBits);
+            if (valid && (options._scoring._hashBits > HashedWordData::MaxHashBits)) {
+                cerr << "ERROR: --hash-features value can not be over "
+                     << HashedWordData::MaxHashBits << endl;
+                valid = false;
+            }
+        }
+        else if (strcmp(argv[index], "--bigrams") == 0) {
+            index++;
+            valid = getLargeCount(argc, argv, index, "--bigrams", options._scoring._bigramMinCount);
+        }
+        else if (strcmp(argv[index], "--bigram-limit") == 0) {
+            index++;
+            valid = getLargeCount(argc, argv, index, "--bigram-limit", pipelineSettings._bigramLimit);
+        }
+        else if (strcmp(argv[index], "--memory-budget") == 0) {
+            index++;
+            valid = getMegabytes(argc, argv, index, "--memory-budget",
+                                 pipelineSettings._memoryBudget);
+        }
+        else if (strcmp(argv[index], "--workers") == 0) {
+            index++;
+            valid = getCount(argc, argv, index, "--workers", options._workers);
+        }
+        else if (strcmp(argv[index], ClassifyWorkers::ListOption) == 0) {
+            index++;
+            valid = getFileName(argc, argv, index, ClassifyWorkers::ListOption,
+                                options._workerList, seenWorkerList);
+        }
+        else if (strcmp(argv[index], ClassifyWorkers::OutputOption) == 0) {
+            index++;
+            valid = getFileName(argc, argv, index, ClassifyWorkers::OutputOption,
+                                options._workerOutput, seenWorkerOutput);
+        }
+        else if (strcmp(argv[index], ClassifyWorkers::ModelOption) == 0) {
+            index++;
+            valid = getFileName(argc, argv, index, ClassifyWorkers::ModelOption,
+                                options._workerModel, seenWorkerModel);
+        }
+        else if (strcmp(argv[index], "--skip-duplicates") == 0) {
+            pipelineSettings._skipDuplicates = true;
+            index++;
+        }
+        else if (strcmp(argv[index], "--pipeline-stats") == 0) {
+            pipelineSettings._reportStats = true;
+            index++;
+        }
+        else if (strcmp(argv[index], "--metrics-file") == 0) {
+            index++;
+            valid = getFileName(argc, argv, index, "--metrics-file", options._metricsFile,
+                                seenMetricsFile);
+        }
+        else if (strcmp(argv[index], "--trace-file") == 0) {
+            index++;
+            valid = getFileName(argc, argv, index, "--trace-file", options._traceFile,
+                                seenTraceFile);
+        }
+        else if (strcmp(argv[index], "--trace-sample") == 0) {
+            index++;
+            valid = getTraceRates(argc, argv, index, options._traceRates);
+        }
+        else if (strcmp(argv[index], "--dump-trace") == 0) {
+            index++;
+            valid = getFileName(argc, argv, index, "--dump-trace", options._dumpTrace,
+                                seenDumpTrace);
+        }
+        else if (strcmp(argv[index], "--stats") == 0) {
+            options._documentStats = true;
             index++;
         }
         else if (strcmp(argv[index], "--help") == 0)
@@ -108,12 +372,103 @@ static bool parse(int argc, char** argv, vector<string>& trainingDirs,
         }
     } // While loop through values
     // Verify that mandatory values have been read.
-    if (valid) {
+    if (valid && ((options._resultFormat != TextResults) || options._backgroundWrite) &&
+        ((options._crossValidateFolds > 0) || (!options._emitCounts.empty()) ||
+         (!options._evaluateDirs.empty()) || options._traceInfo)) {
+        // Only classification results are written this way, and trace output would mix in
+        cerr << "ERROR: --output-format and --background-write can not be used with"
+             << " --cross-validate, --emit-counts, --evaluate, or --trace-info" << endl;
+        valid = false;
+    }
+    else if (valid && (!options._metricsFile.empty()) &&
+        ((options._crossValidateFolds > 0) || (!options._emitCounts.empty()) ||
+         (options._workers > 1))) {
+        // Metrics are recorded by the process that classifies
+        cerr << "ERROR: --metrics-file can not be used with --cross-validate, --emit-counts,"
+             << " or --workers" << endl;
+        valid = false;
+    }
+#ifdef BAYESEAN_CLASSIFIER_NO_EVENT_TRACE
+    else if (valid && (!options._traceFile.empty())) {
+        cerr << "ERROR: --trace-file is not available, event tracing was left out of this build"
+             << endl;
+        valid = false;
+    }
+#endif
+    else if (valid && (!options._traceFile.empty()) && (options._workers > 1)) {
+        // Each worker would need its own trace
+        cerr << "ERROR: --trace-file can not be used with --workers" << endl;
+        valid = false;
+    }
+    else if (valid && (!options._mergeCounts.empty())) {
+        // Merging only needs the files to merge and where to put the result
+        if (options._emitCounts.empty()) {
+            cerr << "ERROR: --merge-counts requires --emit-counts for the merged file" << endl;
+            valid = false;
+        }
+    }
+    else if (valid && (options._scoring._sketch._heavyHitters > 0) &&
+             ((options._crossValidateFolds > 0) || (!options._emitCounts.empty()))) {
+        // Both of these need exact counts
+        cerr << "ERROR: --sketch-training can not be used with --cross-validate or --emit-counts" << endl;
+        valid = false;
+    }
+    else if (valid && (options._scoring._hashBits > 0) &&
+             ((options._crossValidateFolds > 0) || (!options._emitCounts.empty()) ||
+              (options._scoring._sketch._heavyHitters > 0))) {
+        // Counts files and cross validation need the words themselves
+        cerr << "ERROR: --hash-features can not be used with --cross-validate, --emit-counts, or"
+             << " --sketch-training" << endl;
+        valid = false;
+    }
+    else if (valid && (options._scoring._bigramMinCount > 0) &&
+             ((options._crossValidateFolds > 0) || (!options._emitCounts.empty()) ||
+              (!options._trainingCounts.empty()) || (pipelineSettings._memoryBudget > 0))) {
+        // Counts files only hold single words, and the rest rely on them
+        cerr << "ERROR: --bigrams can not be used with --cross-validate, --emit-counts,"
+             << " --training-counts, or --memory-budget" << endl;
+        valid = false;
+    }
+    else if (valid && (options._workers > 1) &&
+             ((options._crossValidateFolds > 0) || (!options._emitCounts.empty()) ||
+              (!options._evaluateDirs.empty()) || (!options._cacheFile.empty()) ||
+              options._traceInfo || (options._scoring._sketch._heavyHitters > 0) ||
+              (options._scoring._bigramMinCount > 0) || options._documentStats ||
+              pipelineSettings._reportStats)) {
+        /* Workers only classify, from a counts file, and each would write to
+            the same cache and trace. Statistics would only cover training */
+        cerr << "ERROR: --workers only classifies documents, and can not be used with"
+             << " --cross-validate, --emit-counts, --evaluate, --cache-file, --trace-info,"
+             << " --sketch-training, --bigrams, --stats, or --pipeline-stats" << endl;
+        valid = false;
+    }
+    else if (valid && ((!options._workerList.empty()) || (!options._workerOutput.empty()) ||
+                       (!options._workerModel.empty()))) {
+        // Set up by --workers, so only checked for consistency. The model is one or the other
+        if (options._workerList.empty() || options._workerOutput.empty() ||
+            (options._trainingCounts.empty() == options._workerModel.empty())) {
+            cerr << "ERROR: " << ClassifyWorkers::ListOption << ", "
+                 << ClassifyWorkers::OutputOption << " and " << ClassifyWorkers::ModelOption
+                 << " are only used by --workers" << endl;
+            valid = false;
+        }
+    }
+    else if (valid && (options._crossValidateFolds > 0)) {
+        // Cross validation needs the documents themselves, so counts files won't do
         if (trainingDirs.empty()) {
             cerr << "ERROR: No directories for training classification files specified" << endl;
             valid = false;
         }
-        if (classifyFiles.empty()) {
+    }
+    else if (valid && options._dumpTrace.empty()) {
+        // A trace file is dumped without training or classifying
+        if (trainingDirs.empty() && options._trainingCounts.empty()) {
+            cerr << "ERROR: No directories for training classification files specified" << endl;
+            valid = false;
+        }
+        // Emitting training counts and evaluating need no other files to classify
+        if (classifyFiles.empty() && options._emitCounts.empty() &&
+            options._evaluateDirs.empty()) {
             cerr << "ERROR: No files to classify specified" << endl;
             valid = false;
         }
@@ -150,6 +505,175 @@ static int getValues(int argc, char** argv, int firstValue,
     return values.size() - startSize;
 }
 
+/* Extracts a count greater than zero for a given argument. Returns false
+    if it is missing or invalid */
+static bool getCount(int argc, char** argv, int& index, const char* option,
+                     unsigned short& count)
+{
+    if ((index == argc) || isOption(argc, argv, index)) {
+        cerr << "ERROR: " << option << " option specified without a value" << endl;
+        return false;
+    }
+    char* end = NULL;
+    long value = strtol(argv[index], &end, 10);
+    if ((*end != '\0') || (value <= 0) || (value > USHRT_MAX)) {
+        cerr << "ERROR: " << option << " value " << argv[index] << " is not a valid count" << endl;
+        return false;
+    }
+    count = (unsigned short)value;
+    index++;
+    return true;
+}
+
+/* Extracts a count greater than zero, with no small limit, for a given
+    argument. Returns false if it is missing or invalid */
+static bool getLargeCount(int argc, char** argv, int& index, const char* option,
+                          unsigned long long& count)
+{
+    if ((index == argc) || isOption(argc, argv, index)) {
+        cerr << "ERROR: " << option << " option specified without a value" << endl;
+        return false;
+    }
+    char* end = NULL;
+    unsigned long long value = strtoull(argv[index], &end, 10);
+    if ((*end != '\0') || (argv[index][0] == '-') || (value == 0) || (value == ULLONG_MAX) ||
+        ((size_t)value != value)) {
+        cerr << "ERROR: " << option << " value " << argv[index] << " is not a valid count" << endl;
+        return false;
+    }
+    count = value;
+    index++;
+    return true;
+}
+
+/* Extracts a size in megabytes greater than zero for a given argument, and
+    returns it in bytes. Returns false if it is missing or invalid */
+static bool getMegabytes(int argc, char** argv, int& index, const char* option,
+                         unsigned long long& bytes)
+{
+    const char* value = (index < argc) ? argv[index] : "";
+    if (!getLargeCount(argc, argv, index, option, bytes))
+        return false;
+    // Limit so the conversion to bytes can not overflow
+    if (bytes > (ULLONG_MAX >> 20)) {
+        cerr << "ERROR: " << option << " value " << value << " is not a valid size" << endl;
+        return false;
+    }
+    bytes <<= 20;
+    return true;
+}
+
+/* Extracts a rate between zero and one for a given argument. Returns false
+    if it is missing or invalid */
+static bool getRate(int argc, char** argv, int& index, const char* option, double& rate)
+{
+    const char* value = (index < argc) ? argv[index] : "";
+    if (!getWeight(argc, argv, index, option, rate))
+        return false;
+    if (rate >= 1.0) {
+        cerr << "ERROR: " << option << " value " << value << " is not between zero and one" << endl;
+        return false;
+    }
+    return true;
+}
+
+/* Extracts a weight greater than zero for a given argument. Returns false
+    if it is missing or invalid */
+static bool getWeight(int argc, char** argv, int& index, const char* option,
+                      double& weight)
+{
+    if ((index == argc) || isOption(argc, argv, index)) {
+        cerr << "ERROR: " << option << " option specified without a value" << endl;
+        return false;
+    }
+    char* end = NULL;
+    double value = strtod(argv[index], &end);
+    // Written to also reject NaN
+    if ((*end != '\0') || (!(value > 0.0)) || (value > DBL_MAX)) {
+        cerr << "ERROR: " << option << " value " << argv[index] << " is not a valid weight" << endl;
+        return false;
+    }
+    weight = value;
+    index++;
+    return true;
+}
+
+// Extracts the scoring model name. Returns false if it is missing or unknown
+static bool getScoringModel(int argc, char** argv, int& index, ScoringModelType& model)
+{
+    if ((index == argc) || isOption(argc, argv, index)) {
+        cerr << "ERROR: --scoring-model option specified without a value" << endl;
+        return false;
+    }
+    if (strcmp(argv[index], "multinomial") == 0)
+        model = MultinomialScoring;
+    else if (strcmp(argv[index], "complement") == 0)
+        model = ComplementScoring;
+    else if (strcmp(argv[index], "bernoulli") == 0)
+        model = BernoulliScoring;
+    else {
+        cerr << "ERROR: --scoring-model value " << argv[index] << " is not a known model" << endl;
+        return false;
+    }
+    index++;
+    return true;
+}
+
+// Extracts the result format name. Returns false if it is missing or unknown
+static bool getResultFormat(int argc, char** argv, int& index, ResultFormat& format)
+{
+    if ((index == argc) || isOption(argc, argv, index)) {
+        cerr << "ERROR: --output-format option specified without a value" << endl;
+        return false;
+    }
+    if (strcmp(argv[index], "text") == 0)
+        format = TextResults;
+    else if (strcmp(argv[index], "tsv") == 0)
+        format = TsvResults;
+    else if (strcmp(argv[index], "binary") == 0)
+        format = BinaryResults;
+    else {
+        cerr << "ERROR: --output-format value " << argv[index] << " is not a known format" << endl;
+        return false;
+    }
+    index++;
+    return true;
+}
+
+// Extracts the trace sampling rates. Returns false if they are missing or not valid
+static bool getTraceRates(int argc, char** argv, int& index, vector<double>& rates)
+{
+    if ((index == argc) || isOption(argc, argv, index)) {
+        cerr << "ERROR: --trace-sample option specified without a value" << endl;
+        return false;
+    }
+    if (!EventTracer::parseRates(argv[index], rates)) {
+        cerr << "ERROR: --trace-sample value " << argv[index] << " must be rates from 0 to 1,"
+             << " each for every event or for one as event=rate" << endl;
+        return false;
+    }
+    index++;
+    return true;
+}
+
+/* Extracts a single file name for a given argument. Returns false if it
+    is missing */
+static bool getFileName(int argc, char** argv, int& index, const char* option,
+                        string& fileName, bool& seen)
+{
+    // Declare that file names can not start with '--'
+    if ((index == argc) || isOption(argc, argv, index)) {
+        cerr << "ERROR: " << option << " option specified without file name" << endl;
+        return false;
+    }
+    if (seen)
+        cerr << "WARNING: " << option << " specified twice, previous value ignored" << endl;
+    fileName = string(argv[index]);
+    seen = true;
+    index++;
+    return true;
+}
+
 // Prints usage
 static void usage()
 {
@@ -159,50 +683,305 @@ static void usage()
          << "                 Multiple are allowed" << endl
          << "--classify-docs  Documents to classify based on training data. If a directory is specified, every" << endl
          << "                 file in it will be clssified. Mutiple are allowed" << endl
+         << "                 Not needed with --emit-counts or --evaluate" << endl
          << "Optional flags:" << endl
+         << "--training-counts Counts files from --emit-counts to use as training data, along with or instead" << endl
+         << "                 of --training-dirs. Multiple are allowed" << endl
+         << "--emit-counts    Writes the training word counts to this file and exits without classifying" << endl
+         << "--merge-counts   Merges these counts files into the --emit-counts file and exits. No training" << endl
+         << "                 or classification is done" << endl
+         << "--evaluate       Classifies the documents in these directories, organized by category the same" << endl
+         << "                 as the training directories, and prints precision and recall per category" << endl
+         << "                 instead of the category of each document. Multiple are allowed" << endl
+         << "--cross-validate Splits the training documents into this many folds, classifies each with a" << endl
+         << "                 model trained on the rest, and prints precision and recall per fold and overall" << endl
          << "--stopwords-file File to load stopwords from. Defaults to 'stopwords.txt' in current directory" << endl
+         << "--cache-file     Saves the words of each document in this file, so later runs skip documents" << endl
+         << "                 that have not changed. Created if it does not exist" << endl
+         << "--scoring-model  How documents are scored against each category: multinomial (the default)," << endl
+         << "                 complement, which is better when categories have very different amounts of" << endl
+         << "                 training data, or bernoulli, which only counts if a word appears" << endl
+         << "--output-format  How classification results are printed: text, 'path: category' lines (the" << endl
+         << "                 default), tsv, path and category ID lines after a table of the IDs, or" << endl
+         << "                 binary, a compact record stream described in resultWriter.h" << endl
+         << "--background-write Writes classification results from a separate thread, so formatting" << endl
+         << "                 overlaps writing. Results are still printed after classification ends" << endl
+         << "--known-word-weight Smoothing added to every word count. Defaults to 1, which works well for" << endl
+         << "                 medium sized documents and above" << endl
          << "--trace-info     Traces probability data about documents used by the classifier. Will produce huge" << endl
          << "                 output on any resonable sized document set" << endl
+         << "--read-threads   Threads reading files. Defaults to 4" << endl
+         << "--tokenize-threads Threads splitting files into words. Defaults to 2" << endl
+         << "--stem-threads   Threads converting words to stems. Defaults to 2" << endl
+         << "--score-threads  Threads counting or classifying documents. Defaults to 2" << endl
+         << "--queue-size     Maximum documents waiting between processing stages. Defaults to 32" << endl
+         << "--progress       Prints documents done, throughput and estimated time left to standard" << endl
+         << "                 error every this many seconds" << endl
+         << "--sketch-training Trains with exact counts for only this many of the most common words per" << endl
+         << "                 category, and estimates the rest from a fixed size count-min sketch, so memory" << endl
+         << "                 does not grow with the vocabulary. Multinomial scoring only. Reports to standard" << endl
+         << "                 error about how many documents exact training would classify differently" << endl
+         << "--sketch-error   Share of a category's words that sketch estimates may be too high by." << endl
+         << "                 Defaults to 0.0001" << endl
+         << "--sketch-failure Probability that an estimate is off by more than that. Defaults to 0.001" << endl
+         << "--hash-features  Replaces words with their hash into 2 to this power buckets, at most 24, so" << endl
+         << "                 no words are stored and the model has a fixed size. Each bucket takes 8" << endl
+         << "                 bytes per category, and per score thread in training. Multinomial scoring only" << endl
+         << "--bigrams        Also scores pairs of neighbouring words, keeping pairs seen at least this" << endl
+         << "                 many times in training. Multinomial scoring only. The document cache is not" << endl
+         << "                 used" << endl
+         << "--bigram-limit   Word pairs each score thread may hold in training before dropping the" << endl
+         << "                 rarest ones, so pairs seen fewer than --bigrams times may be undercounted." << endl
+         << "                 Defaults to 1000000" << endl
+         << "--memory-budget  Megabytes of training word counts to hold in memory. Beyond that, counts are" << endl
+         << "                 written to temporary files and merged at the end. Defaults to no limit" << endl
+         << "--workers        Classifies the documents in this many separate processes, each given an" << endl
+         << "                 equal share of them. Training is done once. A document that crashes a" << endl
+         << "                 worker only loses the results of its share, which are listed on standard" << endl
+         << "                 error. Only for --classify-docs" << endl
+         << "--skip-duplicates Skips training documents with the same contents as one already read in" << endl
+         << "                 the same category, and gives documents to classify with the same contents" << endl
+         << "                 as an earlier one its category without scoring them again" << endl
+         << "--pipeline-stats Prints queue usage of each processing stage to standard error. Not with" << endl
+         << "                 --workers" << endl
+         << "--metrics-file   Writes latency percentiles of each document and processing stage, and counts" << endl
+         << "                 of documents, words, unknown words and cache hits, to this file in the" << endl
+         << "                 Prometheus text format when classification finishes" << endl
+         << "--stats          Prints the slowest and largest documents processed, and those with the" << endl
+         << "                 most words, to standard error on exit. Not with --workers" << endl
+         << "--trace-file     Traces what happens to a sample of the documents to this file, in a" << endl
+         << "                 compact binary format. Not with --workers" << endl
+         << "--trace-sample   Share of documents traced, from 0 to 1, for every event or as a comma" << endl
+         << "                 separated list like 0.01,classify=1. Events are read, cache-hit," << endl
+         << "                 duplicate, tokenize, stem, score and classify. Defaults to 0.01" << endl
+         << "--dump-trace     Prints a trace file written by --trace-file as text and exits" << endl
          << "--help           Prints this message and exits" << endl;
 }
 
 };
 
+// Return a count as a string
+static string toString(unsigned short value)
+{
+    ostringstream buffer;
+    buffer << value;
+    return buffer.str();
+}
+
+// Print documents and their categories in the wanted format
+static void printResults(const DocClassifyMap& results, const vector<string>& categories,
+                         const ProgramOptions& options)
+{
+#ifdef _WIN32
+    // Binary results must not have line ends translated
+    if (options._resultFormat == BinaryResults)
+        _setmode(_fileno(stdout), _O_BINARY);
+#endif
+    ResultWriter writer(cout, options._resultFormat, categories, options._backgroundWrite);
+    DocClassifyMap::const_iterator index;
+    for (index = results.begin(); index != results.end(); index++)
+        writer.write(index->first, index->second);
+    writer.finish();
+}
+
+/* Return the options a worker needs to classify documents the same way as
+    this process, other than the training data and its share of documents */
+static void getWorkerOptions(const ProgramOptions& options, vector<string>& workerOptions)
+{
+    const char* modelNames[] = {"multinomial", "complement", "bernoulli"};
+    ostringstream weight;
+    // Enough digits that the worker reads back exactly the same value
+    weight << setprecision(17) << options._scoring._knownWordWeight;
+
+    workerOptions.clear();
+    workerOptions.push_back("--stopwords-file");
+    workerOptions.push_back(options._stopwordsFile);
+    workerOptions.push_back("--scoring-model");
+    workerOptions.push_back(modelNames[options._scoring._model]);
+    workerOptions.push_back("--known-word-weight");
+    workerOptions.push_back(weight.str());
+    if (options._scoring._hashBits > 0) {
+        workerOptions.push_back("--hash-features");
+        workerOptions.push_back(toString(options._scoring._hashBits));
+    }
+
+    const PipelineSettings& settings = options._pipelineSettings;
+    workerOptions.push_back("--read-threads");
+    workerOptions.push_back(toString(settings._readThreads));
+    workerOptions.push_back("--tokenize-threads");
+    workerOptions.push_back(toString(settings._tokenizeThreads));
+    workerOptions.push_back("--stem-threads");
+    workerOptions.push_back(toString(settings._stemThreads));
+    workerOptions.push_back("--score-threads");
+    workerOptions.push_back(toString(settings._scoreThreads));
+    workerOptions.push_back("--queue-size");
+    workerOptions.push_back(toString(settings._queueSize));
+    if (settings._skipDuplicates)
+        workerOptions.push_back("--skip-duplicates");
+    // The parent only trains, so classification progress comes from the workers
+    if (settings._progressInterval > 0) {
+        workerOptions.push_back("--progress");
+        workerOptions.push_back(toString(settings._progressInterval));
+    }
+}
+
 // The driver for the Baysean Classifier
 int main(int argc, char** argv)
 {
     try {
         // Assemble arguments
-        vector<string> trainingDirs;
-        vector<string> classifyFiles;
-        string stopwordsFile;
-        bool traceInfo;
+        ProgramOptions options;
 
-        if (ArgumentParser::parse(argc, argv, trainingDirs, classifyFiles, stopwordsFile,
-                                  traceInfo)) {
+        if (ArgumentParser::parse(argc, argv, options)) {
+            const vector<string>& trainingDirs = options._trainingDirs;
+            const vector<string>& classifyFiles = options._classifyFiles;
 
-            if (traceInfo) {
+            if (options._traceInfo) {
                 // Print training data input
                 vector<string>::const_iterator dirIndex;
                 cout << "Training dirs:";
                 for (dirIndex = trainingDirs.begin(); dirIndex != trainingDirs.end(); dirIndex++)
                     cout << " " << *dirIndex;
-                cout << endl;
-                cout << "Stop words file: " << stopwordsFile << endl;
+                cout << '\n';
+                cout << "Stop words file: " << options._stopwordsFile << '\n';
                 cout << "Files to classify:";
                 for (dirIndex = classifyFiles.begin(); dirIndex != classifyFiles.end(); dirIndex++)
                     cout << " " << *dirIndex;
-                cout << endl;
+                cout << '\n';
+            }
+
+            // Released automatically on exceptions
+            unique_ptr<DocumentCache> cache;
+            if (!options._cacheFile.empty())
+                cache.reset(new DocumentCache(options._cacheFile));
+            unique_ptr<DocumentStats> documentStats;
+            if (options._documentStats) {
+                documentStats.reset(new DocumentStats(DocumentStats::DefaultKeep));
+                options._pipelineSettings._documentStats = documentStats.get();
+            }
+            unique_ptr<ClassifyMetrics> metrics;
+            if (!options._metricsFile.empty())
+                metrics.reset(new ClassifyMetrics);
+            unique_ptr<EventTracer> tracer;
+            if (!options._traceFile.empty()) {
+                tracer.reset(new EventTracer(options._traceFile));
+                int event;
+                for (event = 0; event < TraceEventCount; event++)
+                    tracer->setRate((TraceEvent)event, options._traceRates[event]);
+                options._pipelineSettings._tracer = tracer.get();
             }
 
-            DocumentClassifier classifier(trainingDirs, stopwordsFile, traceInfo);
-            DocClassifyMap results;
-            classifier.classify(classifyFiles, results);
+            if (!options._dumpTrace.empty())
+                EventTracer::dump(options._dumpTrace, cout);
+            else if (options._crossValidateFolds > 0) {
+                Stopwords stopwords(options._stopwordsFile);
+                CrossValidator validator(stopwords, options._pipelineSettings, cache.get(),
+                                         options._scoring);
+                validator.validate(trainingDirs, options._crossValidateFolds, cout);
+            }
+            else if (!options._mergeCounts.empty())
+                // Combine training shards. Streams the files, so no training data is loaded
+                CountsFile::merge(options._mergeCounts, options._emitCounts);
+            else if (!options._emitCounts.empty()) {
+                // Train this shard and save the raw counts for merging later
+                Stopwords stopwords(options._stopwordsFile);
+                CatWordDataFactory trainingDataSource(stopwords, options._traceInfo,
+                                                      options._pipelineSettings, cache.get());
+                trainingDataSource.writeCounts(trainingDirs, options._trainingCounts,
+                                               options._emitCounts);
+            }
+            else if (!options._evaluateDirs.empty()) {
+                // Score against the known categories directly, without a results file
+                DocumentClassifier classifier(trainingDirs, options._trainingCounts,
+                                              options._stopwordsFile, options._traceInfo,
+                                              options._pipelineSettings, cache.get(),
+                                              options._scoring);
+                classifier.setMetrics(metrics.get());
+                if (tracer.get() != NULL)
+                    tracer->addCategories(classifier.getCategories());
+                ClassifyStats stats((vector<string>()));
+                classifier.evaluate(options._evaluateDirs, stats);
+                cout << stats.statsToString();
+                cerr << classifier.sketchStatsToString();
+            }
+            else if (!options._workerList.empty()) {
+                // One share of a --workers run. The model is a counts file or a hashed model
+                vector<string> fileList;
+                ClassifyWorkers::readFileList(options._workerList, fileList);
+                unique_ptr<DocumentClassifier> classifier;
+                if (!options._workerModel.empty())
+                    classifier.reset(new DocumentClassifier(options._workerModel,
+                                                            options._stopwordsFile,
+                                                            options._pipelineSettings,
+                                                            options._scoring));
+                else
+                    classifier.reset(new DocumentClassifier(vector<string>(),
+                                                            options._trainingCounts,
+                                                            options._stopwordsFile, false,
+                                                            options._pipelineSettings, NULL,
+                                                            options._scoring));
+                classifier->setMetrics(metrics.get());
+                DocClassifyMap results;
+                if (!fileList.empty())
+                    classifier->classify(fileList, results);
+                ClassifyWorkers::writeResults(options._workerOutput, results);
+            }
+            else if (options._workers > 1) {
+                Stopwords stopwords(options._stopwordsFile);
+                CatWordDataFactory trainingDataSource(stopwords, false,
+                                                      options._pipelineSettings, NULL);
+                vector<string> workerOptions;
+                getWorkerOptions(options, workerOptions);
+                ClassifyWorkers workers(options._workers, workerOptions);
+                DocClassifyMap results;
+                vector<string> failedFiles;
+                vector<string> categories;
+                if (options._scoring._hashBits > 0) {
+                    // Hashed models are fixed size tables, which workers can share
+                    DocumentClassifier classifier(trainingDirs, options._trainingCounts,
+                                                  options._stopwordsFile, false,
+                                                  options._pipelineSettings, NULL,
+                                                  options._scoring);
+                    workers.classify(classifier, classifyFiles, results, failedFiles,
+                                     categories);
+                }
+                else
+                    workers.classify(trainingDataSource, trainingDirs, options._trainingCounts,
+                                     classifyFiles, results, failedFiles, categories);
+                printResults(results, categories, options);
+                vector<string>::const_iterator failedIndex;
+                for (failedIndex = failedFiles.begin(); failedIndex != failedFiles.end();
+                     failedIndex++)
+                    cerr << "WARNING: " << *failedIndex << " not classified, its worker failed"
+                         << endl;
+            }
+            else {
+                DocumentClassifier classifier(trainingDirs, options._trainingCounts,
+                                              options._stopwordsFile, options._traceInfo,
+                                              options._pipelineSettings, cache.get(),
+                                              options._scoring);
+                classifier.setMetrics(metrics.get());
+                if (tracer.get() != NULL)
+                    tracer->addCategories(classifier.getCategories());
+                DocClassifyMap results;
+                classifier.classify(classifyFiles, results);
 
-            // Print out documents and categories
-            DocClassifyMap::const_iterator index;
-            for (index = results.begin(); index != results.end(); index++)
-                cout << index->first << ": " << index->second << endl;
+                printResults(results, classifier.getCategories(), options);
+                cerr << classifier.sketchStatsToString();
+            }
+
+            if (cache.get() != NULL)
+                cache->save();
+            if (metrics.get() != NULL)
+                metrics->writeFile(options._metricsFile);
+            if (documentStats.get() != NULL)
+                cerr << documentStats->statsToString();
+            if (tracer.get() != NULL) {
+                tracer->finish();
+                if (tracer->getDropped() > 0)
+                    cerr << "WARNING: " << tracer->getDropped() << " trace events dropped,"
+                         << " the trace buffer was full" << endl;
+            }
         } // Arguments are valid
     }
     catch (exception& e) {
@@ -0,0 +1,185 @@
+#ifndef BOUNDED_QUEUE_H
+#define BOUNDED_QUEUE_H
+
+/* This file is part of BayseanClassifier. It classifies documents into
+    categories based on the classic Baysean classification algorithm.
+
+    Copyright (C) 2016   Ezra Erb
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License version 3 as published
+    by the Free Software Foundation.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+    I'd appreciate a note if you find this program useful or make
+    updates. Please contact me through LinkedIn (my profile also has
+    a link to the code depository)
+*/
+#include <vector>
+#include <mutex>
+#include <condition_variable>
+#include <algorithm>
+
+using std::vector;
+
+// Statistics about how full a queue was while it was used
+struct QueueStats
+{
+    QueueStats() : _capacity(0), _pushCount(0), _maxDepth(0), _depthTotal(0),
+                   _fullWaits(0), _emptyWaits(0) {}
+
+    // Use default copy constructor, copy operator and destructor
+
+    size_t _capacity;
+    unsigned long long _pushCount;
+    size_t _maxDepth;
+
+    // Sum of the depth seen by each push, used to find the average
+    unsigned long long _depthTotal;
+
+    // Times a producer waited because the queue was full (backpressure)
+    unsigned long long _fullWaits;
+
+    // Times a consumer waited because the queue was empty
+    unsigned long long _emptyWaits;
+};
+
+/* This class is a fixed size queue between threads. Any number of threads
+    may add or remove items. A thread adding to a full queue waits until
+    there is room, which slows a fast stage to the speed of the stage after it
+    instead of letting the work between them grow without limit.
+
+    Items are exchanged with swap() rather than copied, so buffers inside
+    them get reused instead of allocated for every item */
+template <class T>
+class BoundedQueue
+{
+public:
+    explicit BoundedQueue(size_t capacity);
+
+    // Use default destructor
+
+    /* Add an item, waiting for room if needed. The passed item is swapped
+        with an unused one. Returns false if the queue was closed */
+    bool push(T& item);
+
+    /* Remove the oldest item into the passed one, waiting for one if needed.
+        Returns false if the queue is closed and no items remain */
+    bool pop(T& item);
+
+    // No more items will be added. Waiting threads are released
+    void close();
+
+    // Stop the queue immediately, discarding any items
+    void abort();
+
+    QueueStats getStats() const;
+
+private:
+    vector<T> _items;
+    size_t _head;  // Oldest item
+    size_t _count;
+    bool _closed;
+    QueueStats _stats;
+
+    mutable std::mutex _lock;
+    std::condition_variable _notFull;
+    std::condition_variable _notEmpty;
+
+    // Make non-copyable, threads refer to it
+    BoundedQueue(const BoundedQueue& other);
+    BoundedQueue& operator=(const BoundedQueue& other);
+};
+
+template <class T>
+BoundedQueue<T>::BoundedQueue(size_t capacity)
+    : _items(capacity > 0 ? capacity : 1), _head(0), _count(0), _closed(false)
+{
+    _stats._capacity = _items.size();
+}
+
+// Add an item, waiting for room if needed
+template <class T>
+bool BoundedQueue<T>::push(T& item)
+{
+    std::unique_lock<std::mutex> guard(_lock);
+    if ((_count >= _items.size()) && (!_closed)) {
+        _stats._fullWaits++;
+        while ((_count >= _items.size()) && (!_closed))
+            _notFull.wait(guard);
+    }
+    if (_closed)
+        return false;
+    using std::swap;
+    swap(_items[(_head + _count) % _items.size()], item);
+    _count++;
+    _stats._pushCount++;
+    _stats._depthTotal += _count;
+    if (_count > _stats._maxDepth)
+        _stats._maxDepth = _count;
+    guard.unlock();
+    _notEmpty.notify_one();
+    return true;
+}
+
+// Remove the oldest item, waiting for one if needed
+template <class T>
+bool BoundedQueue<T>::pop(T& item)
+{
+    std::unique_lock<std::mutex> guard(_lock);
+    if ((_count == 0) && (!_closed)) {
+        _stats._emptyWaits++;
+        while ((_count == 0) && (!_closed))
+            _notEmpty.wait(guard);
+    }
+    if (_count == 0) // Closed and drained
+        return false;
+    using std::swap;
+    swap(item, _items[_head]);
+    _head = (_head + 1) % _items.size();
+    _count--;
+    guard.unlock();
+    _notFull.notify_one();
+    return true;
+}
+
+// No more items will be added. Waiting threads are released
+template <class T>
+void BoundedQueue<T>::close()
+{
+    {
+        std::lock_guard<std::mutex> guard(_lock);
+        _closed = true;
+    }
+    _notFull.notify_all();
+    _notEmpty.notify_all();
+}
+
+// Stop the queue immediately, discarding any items
+template <class T>
+void BoundedQueue<T>::abort()
+{
+    {
+        std::lock_guard<std::mutex> guard(_lock);
+        _closed = true;
+        _count = 0;
+    }
+    _notFull.notify_all();
+    _notEmpty.notify_all();
+}
+
+template <class T>
+QueueStats BoundedQueue<T>::getStats() const
+{
+    std::lock_guard<std::mutex> guard(_lock);
+    return _stats;
+}
+
+#endif // BOUNDED_QUEUE_H
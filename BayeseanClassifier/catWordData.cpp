@@ -34,9 +34,9 @@ void CatWordData::addDocument(const DocumentWordMap& docData)
 {
     // Merge word data first, to handle the unlikely case it throws
     _wordData.mergeMap(docData);
-    _docCount++;
-    _wordCount += docData.size(); // Number of different words
-    _totalWordCount += docData.getTotalWordCount();
+    addCountChecked(_docCount, 1);
+    addCountChecked(_wordCount, docData.size()); // Number of different words
+    addCountChecked(_totalWordCount, docData.getTotalWordCount());
 }
 
 // Merge other category data into this data
@@ -44,7 +44,17 @@ void CatWordData::mergeData(const CatWordData& other)
 {
     // Merge word data first, to handle the unlikely case it throws
     _wordData.mergeMap(other._wordData);
-    _docCount += other._docCount;
-    _wordCount += other._wordCount;
-    _totalWordCount += other._totalWordCount;
+    _bigramData.mergeTable(other._bigramData);
+    addCountChecked(_docCount, other._docCount);
+    addCountChecked(_wordCount, other._wordCount);
+    addCountChecked(_totalWordCount, other._totalWordCount);
+}
+
+// Remove a document previously added to the category results
+void CatWordData::removeDocument(const DocumentWordMap& docData)
+{
+    _wordData.subtractMap(docData);
+    subtractCountChecked(_docCount, 1);
+    subtractCountChecked(_wordCount, docData.size());
+    subtractCountChecked(_totalWordCount, docData.getTotalWordCount());
 }
@@ -28,36 +28,63 @@
 class CatWordData
 {
 private:
-    unsigned short _docCount; // Number of documents in category
-    unsigned int _wordCount; // Number of different words in category documents
-    unsigned int _totalWordCount; // Overall number of words in documents
-    DocumentWordMap _wordData; // Counts of individual words
+    /* Totals are 64 bits so training sets of any realistic size can not
+        overflow them */
+    unsigned long long _docCount; // Number of documents in category
+    unsigned long long _wordCount; // Number of different words in category documents
+    unsigned long long _totalWordCount; // Overall number of words in documents
+    CategoryWordMap _wordData; // Counts of individual words
+
+    // Counts of pairs of neighbouring words, only if counted in training
+    CategoryBigrams _bigramData;
 
 public:
     CatWordData();
 
     // Use default copy constructor, assignment operator, and destructor
 
-    // Add a new document to the category results
+    // Add a new document to the category results. Throws if a count overflows
     void addDocument(const DocumentWordMap& docData);
 
-    // Merge other category data into this data
+    // Merge other category data into this data. Throws if a count overflows
     void mergeData(const CatWordData& other);
 
+    /* Remove a document previously added to the category results. Throws if
+        it was not */
+    void removeDocument(const DocumentWordMap& docData);
+
+    /* Add category totals and word counts found elsewhere, such as a
+        counts file. Throws if a count overflows */
+    void addTotals(unsigned long long docCount, unsigned long long wordCount,
+                   unsigned long long totalWordCount);
+    void addWordCount(const string& word, unsigned long long count);
+
+    // Add the word pairs of a document added with addDocument()
+    void addBigrams(const DocumentBigrams& bigrams);
+
+    // Remove every word pair not in the passed table
+    void keepBigrams(const CategoryBigrams& keys);
+
+    // Remove every word pair seen fewer than the passed times
+    void removeRareBigrams(unsigned long long minimumCount);
+
     // Reset all infomation in the class
     void clear();
 
     // Number of documents in category
-    unsigned short getDocCount() const;
+    unsigned long long getDocCount() const;
 
     // Number of different words in category documents
-    unsigned int getWordCount() const;
+    unsigned long long getWordCount() const;
 
     // Overall number of words in documents
-    unsigned int getTotalWordCount() const;
+    unsigned long long getTotalWordCount() const;
 
     // Counts of individual words
-    const DocumentWordMap& getWordData() const;
+    const CategoryWordMap& getWordData() const;
+
+    // Counts of word pairs
+    const CategoryBigrams& getBigramData() const;
 };
 
 // Reset all infomation in the class
@@ -67,30 +94,70 @@ inline void CatWordData::clear()
     _wordCount = 0;
     _totalWordCount = 0;
     _wordData.clear();
+    _bigramData.clear();
+}
+
+// Add category totals found elsewhere, such as a counts file
+inline void CatWordData::addTotals(unsigned long long docCount, unsigned long long wordCount,
+                                   unsigned long long totalWordCount)
+{
+    addCountChecked(_docCount, docCount);
+    addCountChecked(_wordCount, wordCount);
+    addCountChecked(_totalWordCount, totalWordCount);
+}
+
+// Add word counts found elsewhere, such as a counts file
+inline void CatWordData::addWordCount(const string& word, unsigned long long count)
+{
+    _wordData.addWordCount(word, count);
+}
+
+// Add the word pairs of a document added with addDocument()
+inline void CatWordData::addBigrams(const DocumentBigrams& bigrams)
+{
+    _bigramData.mergeTable(bigrams);
+}
+
+// Remove every word pair not in the passed table
+inline void CatWordData::keepBigrams(const CategoryBigrams& keys)
+{
+    _bigramData.keepOnly(keys);
+}
+
+// Remove every word pair seen fewer than the passed times
+inline void CatWordData::removeRareBigrams(unsigned long long minimumCount)
+{
+    _bigramData.removeBelow(minimumCount);
 }
 
 // Number of documents in category
-inline unsigned short CatWordData::getDocCount() const
+inline unsigned long long CatWordData::getDocCount() const
 {
     return _docCount;
 }
 
 // Number of different words in category documents
-inline unsigned int CatWordData::getWordCount() const
+inline unsigned long long CatWordData::getWordCount() const
 {
     return _wordCount;
 }
 
 // Overall number of words in documents
-inline unsigned int CatWordData::getTotalWordCount() const
+inline unsigned long long CatWordData::getTotalWordCount() const
 {
     return _totalWordCount;
 }
 
 // Counts of individual words
-inline const DocumentWordMap& CatWordData::getWordData() const
+inline const CategoryWordMap& CatWordData::getWordData() const
 {
     return _wordData;
 }
 
+// Counts of word pairs
+inline const CategoryBigrams& CatWordData::getBigramData() const
+{
+    return _bigramData;
+}
+
 #endif // CAT_WORD_DATA_H
@@ -25,24 +25,249 @@
 #include <fstream>
 #include <iostream>
 #include <vector>
+#include <algorithm>
 #include "stopwords.h"
 #include "documentWordMapFactory.h"
 #include "CatWordDataFactory.h"
 #include "baseException.h"
 #include "fileFinder.h"
+#include "documentPipeline.h"
+#include "countsFile.h"
+#include "countsSpill.h"
+#include "duplicateFinder.h"
 
 using namespace std;
 
 /* This class takes a directory tree of documents sorted by category, and
     converts them into data about each category */
 
-// Construct with stopwords to filter out. Does not take ownership
-CatWordDataFactory::CatWordDataFactory(const Stopwords& stopwords, bool traceInfo)
-    : _docProcessor(stopwords), _traceInfo(traceInfo)
+/* Rough memory used by each word of a category: the map node, the string
+    and the count. Stems are short enough to fit in the string itself */
+static const unsigned long long WordEntryBytes = 80;
+
+/* Counts documents into category data as they leave the document pipeline.
+    Each score thread counts into its own results, which are merged at the end,
+    so no locking is needed. If given somewhere to spill, each thread writes
+    its results out whenever they grow past its share of what is left of the
+    memory budget after results already held.
+    Word pairs can not be spilled, so each thread instead drops its rarest
+    pairs whenever it holds more than the pair limit */
+class TrainingSink : public DocumentSink
+{
+public:
+    TrainingSink(unsigned short threadCount, bool traceInfo, CountsSpill* spill,
+                 const PipelineSettings& settings, DuplicateFinder& duplicates,
+                 unsigned long long heldBytes)
+        : _threadInfo(threadCount > 0 ? threadCount : 1), _traceInfo(traceInfo), _lastCategory(),
+          _spill(spill), _threadBytes(_threadInfo.size(), 0),
+          _threadBudget((settings._memoryBudget - min(heldBytes, settings._memoryBudget)) /
+                        _threadInfo.size()),
+          _bigramMinCount(settings._bigramMinCount),
+          _bigramLimit(settings._bigramMinCount > 1 ? settings._bigramLimit : 0),
+          _threadPairs(_threadInfo.size(), 0), _pruneAt(_threadInfo.size(), _bigramLimit),
+          _pruneBelow(_threadInfo.size(), 2), _timesDropped(_threadInfo.size(), 0),
+          _duplicates(duplicates)
+        {}
+
+    // Count a document into its category
+    virtual void process(ProcessedDocument& document, unsigned short threadIndex)
+    {
+        string category(CatWordDataFactory::getCategory(document._fileName));
+        if (_traceInfo) {
+            // Tracing runs on one thread in file order, so category changes can be seen
+            if (category != _lastCategory)
+                cout << category << '\n';
+            _lastCategory = category;
+            cout << document._fileName << '\n';
+            cout << document._wordMap.allMapData() << '\n';
+        }
+        CatWordData& data = _threadInfo[threadIndex][category];
+        size_t wordsBefore = data.getWordData().size();
+        data.addDocument(document._wordMap);
+        if (!document._bigrams.empty()) {
+            size_t pairsBefore = data.getBigramData().size();
+            data.addBigrams(document._bigrams);
+            _threadPairs[threadIndex] += data.getBigramData().size() - pairsBefore;
+            if ((_bigramLimit > 0) && (_threadPairs[threadIndex] > _pruneAt[threadIndex]))
+                dropRarePairs(threadIndex);
+        }
+        if (_spill != NULL) {
+            _threadBytes[threadIndex] += (data.getWordData().size() - wordsBefore) * WordEntryBytes;
+            if (_threadBytes[threadIndex] > _threadBudget) {
+                _spill->spill(_threadInfo[threadIndex]);
+                _threadBytes[threadIndex] = 0;
+            }
+        }
+    }
+
+    /* Copies only count within a category, so a document posted to several
+        categories still trains each of them */
+    virtual bool isDuplicate(const string& fileName, size_t position,
+                             unsigned long long contentHash)
+    {
+        size_t original;
+        return _duplicates.add(CatWordDataFactory::getCategory(fileName), contentHash, position,
+                               original);
+    }
+
+    // True if any thread dropped word pairs to stay under the limit
+    bool droppedPairs() const
+    {
+        return (size_t)count(_timesDropped.begin(), _timesDropped.end(), 0U) < _timesDropped.size();
+    }
+
+    /* Merge the results of all threads into the passed map. If any results
+        were spilled, the rest are spilled as well, leaving the map empty */
+    void getResults(InfoByCategory& info)
+    {
+        info.clear();
+        if ((_spill != NULL) && (!_spill->empty())) {
+            vector<InfoByCategory>::iterator spillIndex;
+            for (spillIndex = _threadInfo.begin(); spillIndex != _threadInfo.end(); spillIndex++)
+                if (!spillIndex->empty())
+                    _spill->spill(*spillIndex);
+            return;
+        }
+        vector<InfoByCategory>::const_iterator threadIndex;
+        for (threadIndex = _threadInfo.begin(); threadIndex != _threadInfo.end(); threadIndex++) {
+            InfoByCategory::const_iterator catIndex;
+            for (catIndex = threadIndex->begin(); catIndex != threadIndex->end(); catIndex++)
+                info[catIndex->first].mergeData(catIndex->second);
+        }
+    }
+
+private:
+    vector<InfoByCategory> _threadInfo;
+    bool _traceInfo;
+    string _lastCategory;
+
+    // Where to spill results over the budget, if anywhere
+    CountsSpill* _spill;
+    vector<unsigned long long> _threadBytes;
+    unsigned long long _threadBudget;
+
+    /* Word pairs held by each thread, the count that triggers dropping the
+        rare ones, the count a pair needs to survive, and how often pairs were
+        dropped. Zero limit for none */
+    unsigned long long _bigramMinCount;
+    unsigned long long _bigramLimit;
+    vector<unsigned long long> _threadPairs;
+    vector<unsigned long long> _pruneAt;
+    vector<unsigned long long> _pruneBelow;
+    vector<unsigned int> _timesDropped;
+
+    // Documents seen so far, which may be from earlier directories
+    DuplicateFinder& _duplicates;
+
+    /* Drop the pairs of a thread seen fewer than its survival count, raising
+        that count until at most half the limit remain. It never passes the
+        minimum kept in the model, since pairs seen that often are kept anyway.
+        Most pairs are only ever seen once, so the first pass frees the most.
+        A dropped pair that turns up again starts counting from zero */
+    void dropRarePairs(unsigned short threadIndex)
+    {
+        while (true) {
+            unsigned long long pairs = 0;
+            InfoByCategory::iterator catIndex;
+            for (catIndex = _threadInfo[threadIndex].begin();
+                 catIndex != _threadInfo[threadIndex].end(); catIndex++) {
+                catIndex->second.removeRareBigrams(_pruneBelow[threadIndex]);
+                pairs += catIndex->second.getBigramData().size();
+            }
+            _threadPairs[threadIndex] = pairs;
+            if ((pairs <= _bigramLimit / 2) || (_pruneBelow[threadIndex] >= _bigramMinCount))
+                break;
+            _pruneBelow[threadIndex]++;
+        }
+        _timesDropped[threadIndex]++;
+
+        // If the pairs left can not be dropped, wait until they double again
+        _pruneAt[threadIndex] = max(_bigramLimit, _threadPairs[threadIndex] * 2);
+    }
+};
+
+/* Counts documents into fixed size category data, approximate or hashed, as
+    they leave the document pipeline. As for training, each score thread has
+    its own results. New categories are created with the passed settings */
+template <class CategoryData, class Settings>
+class TableTrainingSink : public DocumentSink
+{
+public:
+    typedef map<string, CategoryData> DataByCategory;
+
+    TableTrainingSink(unsigned short threadCount, const Settings& settings, bool traceInfo)
+        : _threadData(threadCount > 0 ? threadCount : 1), _settings(settings),
+          _traceInfo(traceInfo), _duplicates()
+        {}
+
+    // Count a document into its category
+    virtual void process(ProcessedDocument& document, unsigned short threadIndex)
+    {
+        string category(CatWordDataFactory::getCategory(document._fileName));
+        if (_traceInfo)
+            cout << document._fileName << '\n';
+        DataByCategory& data = _threadData[threadIndex];
+        typename DataByCategory::iterator entry = data.lower_bound(category);
+        if ((entry == data.end()) || (entry->first != category))
+            entry = data.insert(entry, make_pair(category, CategoryData(_settings)));
+        entry->second.addDocument(document._wordMap);
+    }
+
+    // As for TrainingSink, copies only count within a category
+    virtual bool isDuplicate(const string& fileName, size_t position,
+                             unsigned long long contentHash)
+    {
+        size_t original;
+        return _duplicates.add(CatWordDataFactory::getCategory(fileName), contentHash, position,
+                               original);
+    }
+
+    // Merge the results of all threads into the passed map
+    void getResults(DataByCategory& data) const
+    {
+        typename vector<DataByCategory>::const_iterator threadIndex;
+        for (threadIndex = _threadData.begin(); threadIndex != _threadData.end(); threadIndex++) {
+            typename DataByCategory::const_iterator catIndex;
+            for (catIndex = threadIndex->begin(); catIndex != threadIndex->end(); catIndex++) {
+                typename DataByCategory::iterator entry = data.find(catIndex->first);
+                if (entry == data.end())
+                    data.insert(*catIndex);
+                else
+                    entry->second.mergeData(catIndex->second);
+            }
+        }
+    }
+
+private:
+    vector<DataByCategory> _threadData;
+    Settings _settings;
+    bool _traceInfo;
+
+    // All directories are trained in one run, so the sink keeps its own
+    DuplicateFinder _duplicates;
+};
+
+/* Construct with stopwords to filter out, and optionally a cache of document
+    word data. Does not take ownership of either */
+CatWordDataFactory::CatWordDataFactory(const Stopwords& stopwords, bool traceInfo,
+                                       const PipelineSettings& pipelineSettings,
+                                       DocumentCache* cache)
+    : _docProcessor(stopwords), _traceInfo(traceInfo), _pipelineSettings(pipelineSettings),
+      _cache(cache)
     {}
 
 // Generate information about the words in a set of documents
 void CatWordDataFactory::generateInfo(const string& filesRoot, InfoByCategory& info) const
+{
+    DuplicateFinder duplicates;
+    trainDirectory(filesRoot, info, NULL, duplicates);
+}
+
+/* Generate information about the words in a set of documents, spilling
+    results over the memory budget if given somewhere to spill them */
+void CatWordDataFactory::trainDirectory(const string& filesRoot, InfoByCategory& info,
+                                        CountsSpill* spill, DuplicateFinder& duplicates,
+                                        unsigned long long heldBytes) const
 {
     info.clear();
 
@@ -51,75 +276,174 @@ void CatWordDataFactory::generateInfo(const string& filesRoot, InfoByCategory& i
     vector<string> fileList;
     FileFinder::findFiles(filesRoot, fileList, 2, 2);
 
-    string category;
-    CatWordData results;
-    DocumentWordMap data;
-
-    vector<string>::const_iterator index;
-    for (index = fileList.begin(); index != fileList.end(); index++) {
-        /* With the required directoy setup, the last directory above
-            the file name is the category. Find it in the path. If not
-            found, its an error */
-        unsigned int secondLastSlash = string::npos;
-        unsigned int lastSlash = index->find_last_of("/\\");
-        if ((lastSlash != string::npos) && (lastSlash != 0))
-            secondLastSlash = index->find_last_of("/\\", lastSlash - 1);
-        if ((secondLastSlash == string::npos) ||
-            (lastSlash - secondLastSlash <= 1)) {
-            // Serious problem, file fetch did not set paths properly
-            stringstream errorMessage;
-            errorMessage << "ERROR: could not extact category from file path " << *index;
-            THROW_BASE_EXCEPTION(errorMessage.str().c_str());
-        }
+    /* Run the files through the document pipeline. Tracing needs the documents
+        in order to group them by category */
+    TrainingSink sink(_pipelineSettings._scoreThreads, _traceInfo, spill, _pipelineSettings,
+                      duplicates, heldBytes);
+    DocumentPipeline pipeline(_docProcessor, _pipelineSettings, "Training", _cache);
+    pipeline.run(fileList, sink, _traceInfo);
+    sink.getResults(info);
+    if (sink.droppedPairs())
+        cerr << "WARNING: word pairs seen fewer than " << _pipelineSettings._bigramMinCount
+             << " times in " << filesRoot << " were dropped to stay under --bigram-limit, so"
+             << " counts of pairs seen about that often are approximate" << endl;
+}
 
-        // NOTE: The extra 1 to avoid the slash before the category
-        string currCategory(index->substr(secondLastSlash + 1, lastSlash - secondLastSlash - 1));
+/* Remove word pairs seen fewer than the minimum times over all categories,
+    and return the pairs that remain */
+void CatWordDataFactory::pruneBigrams(InfoByCategory& info, unsigned long long minimumCount,
+                                      CategoryBigrams& vocabulary)
+{
+    vocabulary.clear();
+    InfoByCategory::iterator catIndex;
+    for (catIndex = info.begin(); catIndex != info.end(); catIndex++)
+        vocabulary.mergeTable(catIndex->second.getBigramData());
+    vocabulary.removeBelow(minimumCount);
+    for (catIndex = info.begin(); catIndex != info.end(); catIndex++)
+        catIndex->second.keepBigrams(vocabulary);
+}
 
-        if ((index == fileList.begin()) || (category != currCategory)) {
-            // Start of a new category
-            if (index != fileList.begin()) // Have existing categoy to finish processing
-                info.insert(make_pair(category, results));
-            results.clear();
-            category = currCategory;
-            if (_traceInfo)
-                cout << category << endl;
-        } // Change of category
+// Generate approximate information about the words in multiple sets of documents
+void CatWordDataFactory::generateSketches(const vector<string>& filesRoot,
+                                          const SketchSettings& settings,
+                                          SketchesByCategory& sketches) const
+{
+    generateTables(filesRoot, settings, "Sketch training", sketches);
+}
 
-        if (_traceInfo)
-            cout << *index << endl;
-        data.clear(); // Ensure previous results do not carry over
-        _docProcessor.getWordMap(*index, data);
-        if (_traceInfo)
-            cout << data.allMapData() << endl;
-        results.addDocument(data);
-    } // Loop on returned files
-    // Process final categoy
-    if (fileList.size() > 0)
-        info.insert(make_pair(category, results));
+// Generate hashed information about the words in multiple sets of documents
+void CatWordDataFactory::generateHashed(const vector<string>& filesRoot,
+                                        unsigned short hashBits,
+                                        HashedByCategory& hashed) const
+{
+    generateTables(filesRoot, hashBits, "Hashed training", hashed);
+}
+
+/* Generate fixed size information about the words in multiple sets of
+    documents, created from the passed settings */
+template <class CategoryData, class Settings>
+void CatWordDataFactory::generateTables(const vector<string>& filesRoot,
+                                        const Settings& settings, const string& name,
+                                        map<string, CategoryData>& data) const
+{
+    data.clear();
+    vector<string> fileList;
+    FileFinder::findFiles(filesRoot, fileList, 2, 2);
+
+    TableTrainingSink<CategoryData, Settings> sink(_pipelineSettings._scoreThreads, settings,
+                                                   _traceInfo);
+    DocumentPipeline pipeline(_docProcessor, _pipelineSettings, name, _cache);
+    pipeline.run(fileList, sink, _traceInfo);
+    sink.getResults(data);
+}
+
+/* Extract the category from the path of a training document, which is
+    the directory it is in */
+string CatWordDataFactory::getCategory(const string& filePath)
+{
+    /* With the required directoy setup, the last directory above
+        the file name is the category. Find it in the path. If not
+        found, its an error */
+    size_t secondLastSlash = string::npos;
+    size_t lastSlash = filePath.find_last_of("/\\");
+    if ((lastSlash != string::npos) && (lastSlash != 0))
+        secondLastSlash = filePath.find_last_of("/\\", lastSlash - 1);
+    if ((secondLastSlash == string::npos) ||
+        (lastSlash - secondLastSlash <= 1)) {
+        // Serious problem, file fetch did not set paths properly
+        stringstream errorMessage;
+        errorMessage << "ERROR: could not extact category from file path " << filePath;
+        THROW_BASE_EXCEPTION(errorMessage.str().c_str());
+    }
+
+    // NOTE: The extra 1 to avoid the slash before the category
+    return filePath.substr(secondLastSlash + 1, lastSlash - secondLastSlash - 1);
 }
 
 // Generate information about the words in multiple sets of documents
 void CatWordDataFactory::generateInfo(const vector<string>& filesRoot, InfoByCategory& info) const
 {
+    CountsSpill spill;
+    trainDirectories(filesRoot, info, spill);
+    try {
+        // Anything spilled is merged back, so only the final counts are in memory
+        if (!spill.empty())
+            spill.collect(info);
+    }
+    catch (...) {
+        // Ensure consistent state on exception
+        info.clear();
+        throw;
+    }
+}
+
+/* Generate information about the words in multiple sets of documents,
+    plus those in counts files, and write it to a counts file. Within the
+    memory budget, the results never need to all be in memory at once */
+void CatWordDataFactory::writeCounts(const vector<string>& filesRoot,
+                                     const vector<string>& countsFiles,
+                                     const string& outputFile) const
+{
+    CountsSpill spill;
+    InfoByCategory info;
+    trainDirectories(filesRoot, info, spill);
+    if (spill.empty()) {
+        vector<string>::const_iterator countsIndex;
+        for (countsIndex = countsFiles.begin(); countsIndex != countsFiles.end(); countsIndex++)
+            CountsFile::read(*countsIndex, info);
+        CountsFile::write(outputFile, info);
+    }
+    else
+        spill.merge(countsFiles, outputFile);
+}
+
+/* Generate information about the words in multiple sets of documents. Once
+    anything has been spilled, the results are spilled as well and the map is
+    left empty */
+void CatWordDataFactory::trainDirectories(const vector<string>& filesRoot, InfoByCategory& info,
+                                          CountsSpill& spill) const
+{
+    CountsSpill* budgetSpill = (_pipelineSettings._memoryBudget > 0) ? &spill : NULL;
     info.clear();
     InfoByCategory newInfo;
+    // Mirrors are often in separate directories, so copies are found across all of them
+    DuplicateFinder duplicates;
+    // Approximate bytes held by the results of earlier directories
+    unsigned long long heldBytes = 0;
     vector<string>::const_iterator dirIndex;
     try {
         for (dirIndex = filesRoot.begin(); dirIndex != filesRoot.end(); dirIndex++) {
-            generateInfo(*dirIndex, newInfo);
+            trainDirectory(*dirIndex, newInfo, budgetSpill, duplicates, heldBytes);
 
             // Merge into overall results
-            InfoByCategory::const_iterator catIndex;
+            InfoByCategory::iterator catIndex;
             for (catIndex = newInfo.begin(); catIndex != newInfo.end(); catIndex++) {
                 // Look up category in this map. If found, merge data, otherwise insert
                 InfoByCategory::iterator entry = info.lower_bound(catIndex->first);
                 if (entry != info.end() && (entry->first == catIndex->first)) // Already present
                     entry->second.mergeData(catIndex->second);
                 else
-                    // lower_bound returned where the new word should be inserted
-                    info.insert(entry, *catIndex);
+                    /* lower_bound returned where the new word should be inserted.
+                        Swap the data in rather than copying it */
+                    swap(info.insert(entry, make_pair(catIndex->first, CatWordData()))->second,
+                         catIndex->second);
             }
             // Don't need to clear newInfo, data load routine handles it
+
+            if (budgetSpill == NULL)
+                continue;
+            heldBytes = 0;
+            for (catIndex = info.begin(); catIndex != info.end(); catIndex++)
+                heldBytes += catIndex->second.getWordData().size() * WordEntryBytes;
+
+            /* Results from earlier directories go out once later ones spill, or
+                once they hold over half the budget, so the next directory
+                still has room to count in */
+            if ((!info.empty()) &&
+                ((!spill.empty()) || (heldBytes > _pipelineSettings._memoryBudget / 2))) {
+                spill.spill(info);
+                heldBytes = 0;
+            }
         }
     } // Try block
     catch (...) {
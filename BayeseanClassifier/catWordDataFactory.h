@@ -26,7 +26,12 @@
 #include <map>
 #include <vector>
 #include "catWordData.h"
+#include "sketchedWordData.h"
+#include "hashedWordData.h"
 #include "documentWordMapFactory.h"
+#include "documentPipeline.h"
+#include "documentCache.h"
+#include "duplicateFinder.h"
 
 using std::map;
 using std::string;
@@ -43,6 +48,10 @@ using std::string;
 */
 
 typedef map<string, CatWordData> InfoByCategory;
+typedef map<string, SketchedWordData> SketchesByCategory;
+typedef map<string, HashedWordData> HashedByCategory;
+
+class CountsSpill;
 
 class CatWordDataFactory
 {
@@ -52,12 +61,37 @@ private:
     // Trace how files are processed
     bool _traceInfo;
 
+    // Threads and queues used to process the training documents
+    PipelineSettings _pipelineSettings;
+
+    // Saved word data from earlier runs, if any
+    DocumentCache* _cache;
+
     // Process a single category directory of documents
     void processCategory(const string& filesRoot, const string& category,
                          InfoByCategory& info) const;
 
+    /* Generate information about the words in one or more sets of documents.
+        If the memory budget is set, results over it are spilled, and once
+        anything has been all the rest are too, leaving the map empty. When
+        skipping duplicates, copies of documents already in the finder are
+        skipped. Bytes already held by earlier results count against the
+        budget */
+    void trainDirectory(const string& filesRoot, InfoByCategory& info, CountsSpill* spill,
+                        DuplicateFinder& duplicates, unsigned long long heldBytes = 0) const;
+    void trainDirectories(const vector<string>& filesRoot, InfoByCategory& info,
+                          CountsSpill& spill) const;
+
+    /* Generate fixed size information about the words in multiple sets of
+        documents, created from the passed settings */
+    template <class CategoryData, class Settings>
+    void generateTables(const vector<string>& filesRoot, const Settings& settings,
+                        const string& name, map<string, CategoryData>& data) const;
+
 public:
-    CatWordDataFactory(const Stopwords& stopwords, bool traceInfo);
+    CatWordDataFactory(const Stopwords& stopwords, bool traceInfo,
+                       const PipelineSettings& pipelineSettings = PipelineSettings(),
+                       DocumentCache* cache = NULL);
 
     // Use default copy constructor, destructor, and assignment operator
 
@@ -67,6 +101,34 @@ public:
     // Generate information about the words in multiple sets of documents
     void generateInfo(const vector<string>& filesRoot, InfoByCategory& info) const;
 
+    /* Generate information about the words in multiple sets of documents,
+        plus those in counts files, and write it to a counts file. Spilled
+        results are merged straight into the file, never into memory */
+    void writeCounts(const vector<string>& filesRoot, const vector<string>& countsFiles,
+                     const string& outputFile) const;
+
+    /* Generate approximate information about the words in multiple sets of
+        documents, which uses fixed memory per category however many
+        different words they have */
+    void generateSketches(const vector<string>& filesRoot, const SketchSettings& settings,
+                          SketchesByCategory& sketches) const;
+
+    /* Generate information about the words in multiple sets of documents,
+        with words replaced by their hash into 2 to the power of the passed
+        bits buckets. No words are kept */
+    void generateHashed(const vector<string>& filesRoot, unsigned short hashBits,
+                        HashedByCategory& hashed) const;
+
+    /* Remove word pairs seen fewer than the minimum times over all
+        categories from the training data, so the number kept is bounded.
+        Returns the pairs that remain */
+    static void pruneBigrams(InfoByCategory& info, unsigned long long minimumCount,
+                             CategoryBigrams& vocabulary);
+
+    /* Extract the category from the path of a training document, which is
+        the directory it is in. Throws if the path has no such directory */
+    static string getCategory(const string& filePath);
+
     // Utility method to print of data by category
     static string infoByCategoryToString(const InfoByCategory& info);
 };
@@ -22,6 +22,7 @@
 #include <string>
 #include <map>
 #include <cmath> // For log()
+#include <vector>
 #include <sstream>
 
 #include "documentWordMapFactory.h"
@@ -42,18 +43,17 @@ using namespace std;
     will cause numeric underflow. Taking the natural log of the algorithm
     calculation solves this problem */
 
-/* Constructor. Requires data about the words in documents
-    in this category, the overall number of documents, and
-    a tuning parameter used to handle unknwon words */
-Classifier::Classifier(const CatWordData& trainingData,
-                       unsigned short totalDocCount,
-                       double knownWordWeight)
-{
-    /* Document probability: number of documents in category divided by total.
-        number of documents. Note cast to double so divide is done at high
-        precision */
-    _docProbability = log((double)trainingData.getDocCount() / (double)totalDocCount);
+const bool MultinomialPolicy::NeedsAllCategories;
+const bool ComplementPolicy::NeedsAllCategories;
+const bool BernoulliPolicy::NeedsAllCategories;
 
+// Calculate the word probabilities for multinomial scoring
+void MultinomialPolicy::buildWeights(const CatWordData& trainingData,
+                                     const CatWordData& /* allCategories */,
+                                     double knownWordWeight, double& /* docProbability */,
+                                     map<string, double>& wordProbability,
+                                     double& unknownWordProbability)
+{
     /* Total word count adjusted by the word weight. Note the cast to ensure the
         calculation is done as doubles */
     double adjustedWordCount = (double)trainingData.getTotalWordCount() +
@@ -61,59 +61,335 @@ Classifier::Classifier(const CatWordData& trainingData,
 
     /* Probability for each word. Number in document set adjusted by the known word
         weight divided by the adjusted number of words in the documents */
-    const DocumentWordMap& wordData = trainingData.getWordData();
-    DocumentWordMap::const_iterator index;
+    const CategoryWordMap& wordData = trainingData.getWordData();
+    CategoryWordMap::const_iterator index;
     for (index = wordData.begin(); index != wordData.end(); index++) {
-        double wordProbability = log(((double)index->second + knownWordWeight) /
-                                     adjustedWordCount);
-        _wordProbability.insert(make_pair(index->first, wordProbability));
+        double probability = log(((double)index->second + knownWordWeight) /
+                                 adjustedWordCount);
+        wordProbability.insert(wordProbability.end(), make_pair(index->first, probability));
     }
 
     /* Probability of an unknown word is the same as a known word with a frequency
         of zero */
-    _unknownWordProbability = log(knownWordWeight / adjustedWordCount);
+    unknownWordProbability = log(knownWordWeight / adjustedWordCount);
 }
 
-/* Given data about the words in a document, return the scaled log probability
-    that it belongs to this category */
-double Classifier::getCategoryProbability(const DocumentWordMap& document) const
+// Calculate the word probabilities for complement scoring
+void ComplementPolicy::buildWeights(const CatWordData& trainingData,
+                                    const CatWordData& allCategories,
+                                    double knownWordWeight, double& /* docProbability */,
+                                    map<string, double>& wordProbability,
+                                    double& unknownWordProbability)
 {
-    /* This method implements the classic Baysean algorithm for calculating the probability
-        a given document is in the class. Its calculated using logarythms to avoid numeric
-        underflow. The wanted probability is the sum of the log probability of the category
-        plus the log probability that each word in the document signals it is in the category.
+    /* Count words in every other category, by taking this one out of the
+        totals. Both maps are in word order, so walk them together */
+    const CategoryWordMap& allWords = allCategories.getWordData();
+    const CategoryWordMap& categoryWords = trainingData.getWordData();
+    CategoryWordMap::const_iterator categoryIndex = categoryWords.begin();
+    CategoryWordMap::const_iterator index;
+    vector<unsigned long long> complementCounts;
+    complementCounts.reserve(allWords.size());
+    unsigned long long complementWordCount = 0;
+    for (index = allWords.begin(); index != allWords.end(); index++) {
+        unsigned long long count = index->second;
+        if ((categoryIndex != categoryWords.end()) && (categoryIndex->first == index->first)) {
+            count -= categoryIndex->second;
+            categoryIndex++;
+        }
+        complementCounts.push_back(count);
+        if (count > 0)
+            complementWordCount++;
+    }
+    double adjustedWordCount = ((double)allCategories.getTotalWordCount() -
+                                (double)trainingData.getTotalWordCount()) +
+        ((double)complementWordCount * knownWordWeight);
+
+    /* A word is evidence against the category in proportion to how likely it
+        is in the others. Words seen only in this category get the lowest
+        probability, so the most support */
+    size_t wordIndex = 0;
+    for (index = allWords.begin(); index != allWords.end(); index++, wordIndex++) {
+        double probability = -log(((double)complementCounts[wordIndex] + knownWordWeight) /
+                                  adjustedWordCount);
+        wordProbability.insert(wordProbability.end(), make_pair(index->first, probability));
+    }
+    unknownWordProbability = -log(knownWordWeight / adjustedWordCount);
+}
+
+// Calculate the word probabilities for Bernoulli scoring
+void BernoulliPolicy::buildWeights(const CatWordData& trainingData,
+                                   const CatWordData& allCategories,
+                                   double knownWordWeight, double& docProbability,
+                                   map<string, double>& wordProbability,
+                                   double& unknownWordProbability)
+{
+    /* Every known word is scored as present or absent. Scoring all the absent
+        ones per document would be slow, so instead every word is counted as
+        absent up front, in the document probability, and each word that is
+        present swaps its absent probability for its present one */
+    const CategoryWordMap& allWords = allCategories.getWordData();
+    const CategoryWordMap& categoryWords = trainingData.getWordData();
+    double docCount = (double)trainingData.getDocCount();
+    CategoryWordMap::const_iterator categoryIndex = categoryWords.begin();
+    CategoryWordMap::const_iterator index;
+    for (index = allWords.begin(); index != allWords.end(); index++) {
+        double wordDocs = 0.0;
+        if ((categoryIndex != categoryWords.end()) && (categoryIndex->first == index->first)) {
+            // Can't be in more documents than it appears in, or than there are
+            wordDocs = (double)categoryIndex->second;
+            if (wordDocs > docCount)
+                wordDocs = docCount;
+            categoryIndex++;
+        }
+        double present = (wordDocs + knownWordWeight) / (docCount + (2.0 * knownWordWeight));
+        double absentLog = log(1.0 - present);
+        docProbability += absentLog;
+        wordProbability.insert(wordProbability.end(),
+                               make_pair(index->first, log(present) - absentLog));
+    }
+
+    // Words never seen in training say nothing about any category
+    unknownWordProbability = 0.0;
+}
 
-        Technically, to get the probability need to subtract the log probability that each word
-        appears in ANY category, called the evidence. This value is the same for every category
-        this document could belong to, so it makes no difference for classification. Leaving it
-        out makes the code faster */
+/* Constructor. Requires data about the words in documents in this category,
+    the overall number of documents, and a tuning parameter used to handle
+    unknown words */
+SketchClassifier::SketchClassifier(const SketchedWordData& trainingData,
+                                   unsigned long long totalDocCount, double knownWordWeight)
+    : _docProbability(log((double)trainingData.getDocCount() / (double)totalDocCount)),
+      _wordProbability(), _sketch(trainingData.getSketch()),
+      _errorBound(trainingData.getSketch().getErrorBound()),
+      _expectedError(trainingData.getSketch().getExpectedError()), _knownWordWeight(knownWordWeight),
+      // The totals are exact, so this matches multinomial scoring
+      _logAdjustedWordCount(log((double)trainingData.getTotalWordCount() +
+                                ((double)trainingData.getWordCount() * knownWordWeight)))
+{
+    /* A tracked count is too high by at most its error, and is used unless
+        the sketch estimate is lower, which is also never too low */
+    const SketchedWordData::HeavyHitterMap& heavyHitters = trainingData.getHeavyHitters();
+    SketchedWordData::HeavyHitterMap::const_iterator index;
+    for (index = heavyHitters.begin(); index != heavyHitters.end(); index++) {
+        unsigned long long estimate = _sketch.estimate(index->first);
+        unsigned long long lowest = 0;
+        if (estimate > _errorBound)
+            lowest = estimate - _errorBound;
+        if (index->second._count - index->second._error > lowest)
+            lowest = index->second._count - index->second._error;
+        if (index->second._count < estimate)
+            estimate = index->second._count;
+        _wordProbability.insert(_wordProbability.end(),
+                                make_pair(index->first,
+                                          make_pair(getWordProbability((double)estimate),
+                                                    getWordProbability((double)lowest))));
+    }
+}
+
+/* Score a document, also finding the lowest score it could have with exact
+    counts, and the score with each estimate lowered by its expected error.
+    Tracked words are nearly exact, so they count the same in the last */
+template <class Document>
+double SketchClassifier::scoreWords(const Document& document, double& lowest,
+                                    double& corrected) const
+{
     double probability = _docProbability;
+    lowest = _docProbability;
+    corrected = _docProbability;
 
-    DocumentWordMap::const_iterator index;
-    map<string, double>::const_iterator wordIndex;
+    typename Document::const_iterator index;
+    map<string, pair<double, double> >::const_iterator wordIndex;
     for (index = document.begin(); index != document.end(); index++) {
         wordIndex = _wordProbability.find(index->first);
-        if (wordIndex == _wordProbability.end())
-            // Unknown word
-            probability += (_unknownWordProbability * index->second);
-        else
-            // Add the probability per times the word appears
-            probability += (wordIndex->second * index->second);
+        if (wordIndex != _wordProbability.end()) {
+            probability += wordIndex->second.first * index->second;
+            lowest += wordIndex->second.second * index->second;
+            corrected += wordIndex->second.first * index->second;
+        }
+        else {
+            unsigned long long estimate = _sketch.estimate(index->first);
+            probability += getWordProbability((double)estimate) * index->second;
+            lowest += getWordProbability((estimate > _errorBound) ?
+                                         (double)(estimate - _errorBound) : 0.0) * index->second;
+            corrected += getWordProbability(((double)estimate > _expectedError) ?
+                                            (double)estimate - _expectedError : 0.0) *
+                index->second;
+        }
     }
     return probability;
 }
 
+// Given data about the words in a document, return the scaled log probability
+double SketchClassifier::getCategoryProbability(const DocumentWordMap& document) const
+{
+    double lowest, corrected;
+    return scoreWords(document, lowest, corrected);
+}
+
+// As above, for a document counted into a reusable table
+double SketchClassifier::getCategoryProbability(const DocumentWordTable& document) const
+{
+    double lowest, corrected;
+    return scoreWords(document, lowest, corrected);
+}
+
+/* Given data about the words in a document, return the scaled log probability,
+    the lowest it could be with exact counts, and the score with each estimate
+    lowered by its expected error */
+double SketchClassifier::getCategoryProbability(const DocumentWordMap& document,
+                                                double& lowest, double& corrected) const
+{
+    return scoreWords(document, lowest, corrected);
+}
+
 /* Return a string containing the probability data in this class,
     used for debugging.
     WARNING: Likely to be very long */
-string Classifier::classifierToString() const
+string SketchClassifier::classifierToString() const
 {
     ostringstream buffer;
     buffer << "_docProability:" << _docProbability << " _unknownWordProbability:"
-            << _unknownWordProbability << "Words:";
+            << getWordProbability(0.0) << " _errorBound:" << _errorBound << "Words:";
 
-    map<string, double>::const_iterator index;
+    map<string, pair<double, double> >::const_iterator index;
     for (index = _wordProbability.begin(); index != _wordProbability.end(); index++)
-        buffer << " " << index->first << ": " << index->second;
+        buffer << " " << index->first << ": " << index->second.first;
+    return buffer.str();
+}
+
+/* Constructor. Requires data about the words in documents in this category,
+    the overall number of documents, and a tuning parameter used to handle
+    unknown words */
+HashedClassifier::HashedClassifier(const HashedWordData& trainingData,
+                                   unsigned long long totalDocCount, double knownWordWeight)
+    : _docProbability(log((double)trainingData.getDocCount() / (double)totalDocCount)),
+      _ownedBuckets(), _bucketProbability(NULL), _bucketCount(0), _emptyBucketProbability(0.0)
+{
+    // Same as multinomial scoring, with buckets in place of words
+    double adjustedWordCount = (double)trainingData.getTotalWordCount() +
+        ((double)trainingData.getWordCount() * knownWordWeight);
+    const vector<unsigned long long>& buckets = trainingData.getBucketCounts();
+    vector<double>* probabilities = new vector<double>();
+    _ownedBuckets.reset(probabilities);
+    probabilities->reserve(buckets.size());
+    vector<unsigned long long>::const_iterator index;
+    for (index = buckets.begin(); index != buckets.end(); index++)
+        probabilities->push_back(log(((double)*index + knownWordWeight) / adjustedWordCount));
+    _bucketProbability = probabilities->empty() ? NULL : &(*probabilities)[0];
+    _bucketCount = probabilities->size();
+    _emptyBucketProbability = log(knownWordWeight / adjustedWordCount);
+}
+
+/* Constructor from probabilities found earlier, which are not copied and must
+    outlive the classifier */
+HashedClassifier::HashedClassifier(double docProbability, double emptyBucketProbability,
+                                   const double* bucketProbability, size_t bucketCount)
+    : _docProbability(docProbability), _ownedBuckets(), _bucketProbability(bucketProbability),
+      _bucketCount(bucketCount), _emptyBucketProbability(emptyBucketProbability)
+{}
+
+// Score a document held either as a map or as a table
+template <class Document>
+double HashedClassifier::scoreWords(const Document& document) const
+{
+    double probability = _docProbability;
+    typename Document::const_iterator index;
+    for (index = document.begin(); index != document.end(); index++)
+        probability += _bucketProbability[HashedWordData::getBucket(index->first, _bucketCount)] *
+            index->second;
+    return probability;
+}
+
+// Given data about the words in a document, return the scaled log probability
+double HashedClassifier::getCategoryProbability(const DocumentWordMap& document) const
+{
+    return scoreWords(document);
+}
+
+// As above, for a document counted into a reusable table
+double HashedClassifier::getCategoryProbability(const DocumentWordTable& document) const
+{
+    return scoreWords(document);
+}
+
+double HashedClassifier::getDocProbability() const
+{
+    return _docProbability;
+}
+
+double HashedClassifier::getEmptyBucketProbability() const
+{
+    return _emptyBucketProbability;
+}
+
+const double* HashedClassifier::getBucketProbabilities() const
+{
+    return _bucketProbability;
+}
+
+size_t HashedClassifier::getBucketCount() const
+{
+    return _bucketCount;
+}
+
+/* Return a string containing the probability data in this class,
+    used for debugging. Empty buckets are left out
+    WARNING: Likely to be very long */
+string HashedClassifier::classifierToString() const
+{
+    ostringstream buffer;
+    buffer << "_docProability:" << _docProbability << " _unknownWordProbability:"
+            << _emptyBucketProbability << " Buckets: " << _bucketCount << "Words:";
+
+    size_t index;
+    for (index = 0; index < _bucketCount; index++)
+        if (_bucketProbability[index] != _emptyBucketProbability)
+            buffer << " " << index << ": " << _bucketProbability[index];
+    return buffer.str();
+}
+
+/* Constructor. Requires data about the documents in this category, the
+    number of different pairs kept over all categories, and a tuning parameter
+    used to handle pairs not seen in this category */
+BigramClassifier::BigramClassifier(const CatWordData& trainingData, size_t vocabularySize,
+                                   double knownWordWeight)
+    : _bigramProbability(), _unknownBigramProbability(0.0)
+{
+    // Same as multinomial scoring of words, over the pairs kept
+    const CategoryBigrams& bigrams = trainingData.getBigramData();
+    double adjustedPairCount = (double)bigrams.getTotal() +
+        ((double)vocabularySize * knownWordWeight);
+    CategoryBigrams::const_iterator index;
+    for (index = bigrams.begin(); index != bigrams.end(); index++)
+        _bigramProbability.setValue(index->first, log(((double)index->second + knownWordWeight) /
+                                                      adjustedPairCount));
+    _unknownBigramProbability = log(knownWordWeight / adjustedPairCount);
+}
+
+// Given the pairs of a document, return their scaled log probability
+double BigramClassifier::getBigramProbability(const DocumentBigrams& bigrams) const
+{
+    double probability = 0.0;
+    DocumentBigrams::const_iterator index;
+    for (index = bigrams.begin(); index != bigrams.end(); index++) {
+        const double* pairProbability = _bigramProbability.find(index->first);
+        if (pairProbability != NULL)
+            probability += *pairProbability * index->second;
+        else
+            probability += _unknownBigramProbability * index->second;
+    }
+    return probability;
+}
+
+/* Return a string containing the probability data in this class,
+    used for debugging
+    WARNING: Likely to be very long */
+string BigramClassifier::classifierToString() const
+{
+    ostringstream buffer;
+    buffer << "_unknownBigramProbability:" << _unknownBigramProbability << " Pairs:";
+
+    BigramTable<double>::const_iterator index;
+    for (index = _bigramProbability.begin(); index != _bigramProbability.end(); index++)
+        buffer << " " << hex << index->first << dec << ": " << index->second;
     return buffer.str();
 }
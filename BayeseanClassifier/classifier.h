@@ -24,11 +24,114 @@
 */
 #include <string>
 #include <map>
+#include <sstream>
+#include <vector>
+#include <cmath> // For log()
+#include <memory>
 #include "documentWordMapFactory.h"
 #include "catWordData.h"
+#include "sketchedWordData.h"
+#include "hashedWordData.h"
 
 using std::map;
 using std::string;
+using std::vector;
+
+// Ways to score documents against a category, selected at run time
+enum ScoringModelType { MultinomialScoring, ComplementScoring, BernoulliScoring };
+
+// How documents are scored against each category
+struct ScoringSettings
+{
+    ScoringSettings() : _model(MultinomialScoring), _knownWordWeight(1.0), _sketch(),
+                        _hashBits(0), _bigramMinCount(0) {}
+
+    // Use default copy constructor, copy operator and destructor
+
+    ScoringModelType _model;
+
+    /* Added to the count of every word when estimating its probability, so
+        words never seen in a category don't make it impossible. A known word
+        weight of 1 works well for medium sized documents and above */
+    double _knownWordWeight;
+
+    // Train with approximate counts for all but the most common words
+    SketchSettings _sketch;
+
+    /* Replace words with their hash into 2 to the power of this many
+        buckets, so no words are stored. Zero to keep the words */
+    unsigned short _hashBits;
+
+    /* Also score pairs of neighbouring words, keeping those seen at least
+        this many times in training. Zero to score single words only */
+    unsigned long long _bigramMinCount;
+};
+
+/* Scoring policies for Classifier. Each one calculates the log probability
+    data for a category up front, and says how each word of a document adds
+    to its score. They only have static methods, so the classifier compiles
+    a separate scoring loop for each one, with the word score inlined.
+
+    All policies work from the same training counts. Policies that need the
+    counts of the other categories are given the totals over all of them */
+
+/* Classic multinomial Naive Bayes. The probability of a word is its share of
+    all the words in the category, and each time it appears in a document
+    adds its log probability to the score */
+struct MultinomialPolicy
+{
+    static const bool NeedsAllCategories = false;
+
+    static void buildWeights(const CatWordData& trainingData, const CatWordData& allCategories,
+                             double knownWordWeight, double& docProbability,
+                             map<string, double>& wordProbability,
+                             double& unknownWordProbability);
+
+    static double scoreWord(double wordProbability, unsigned int count)
+    {
+        return wordProbability * count;
+    }
+};
+
+/* Complement Naive Bayes. Word probabilities come from the documents in all
+    OTHER categories, which gives far more data per estimate when categories
+    are small or uneven in size. A word common elsewhere is evidence against
+    the category, so its log probability is subtracted */
+struct ComplementPolicy
+{
+    static const bool NeedsAllCategories = true;
+
+    static void buildWeights(const CatWordData& trainingData, const CatWordData& allCategories,
+                             double knownWordWeight, double& docProbability,
+                             map<string, double>& wordProbability,
+                             double& unknownWordProbability);
+
+    static double scoreWord(double wordProbability, unsigned int count)
+    {
+        return wordProbability * count;
+    }
+};
+
+/* Bernoulli Naive Bayes. Scores whether each known word is present in a
+    document, not how many times, and counts words missing from the document
+    against categories where they are common. The training counts hold word
+    occurrences, not the number of documents holding each word, so that is
+    estimated as the smaller of the word's count and the category's document
+    count. Words never seen in training are ignored */
+struct BernoulliPolicy
+{
+    static const bool NeedsAllCategories = true;
+
+    static void buildWeights(const CatWordData& trainingData, const CatWordData& allCategories,
+                             double knownWordWeight, double& docProbability,
+                             map<string, double>& wordProbability,
+                             double& unknownWordProbability);
+
+    static double scoreWord(double wordProbability, unsigned int /* count */)
+    {
+        return wordProbability;
+    }
+};
 
 /* This class calculates the likelyhood that a given
     document is part of its category, given the probability
@@ -38,11 +141,13 @@ using std::string;
     probability algorithm. It has known limitations, but is resonably
     accurate on general document sets and fast. This class calculates
     needed algorithm data up front and caches it for additional speed.
+    The scoring policy selects which variant of the algorithm is used.
 
     With the size of the documents, calculating with actual probabilities
     will cause numeric underflow. Taking the natural log of the algorithm
     calculation solves this problem */
-class Classifier
+template <class ScoringPolicy>
+class BasicClassifier
 {
 private:
     /* Log probability that a document chosen at random from
@@ -57,12 +162,17 @@ private:
         document in this category */
     double _unknownWordProbability;
 
+    // Score a document held either as a map or as a table
+    template <class Document>
+    double scoreWords(const Document& document) const;
+
 public:
     /* Constructor. Requires data bout the words in documents
-        in this category, the overall number of documents, and
-        a tuning parameter used to handle unknwon words */
-    Classifier(const CatWordData& trainingData, unsigned short totalDocCount,
-               double knownWordWeight);
+        in this category, the same over all categories for policies that
+        need it, the overall number of documents, and a tuning parameter
+        used to handle unknwon words */
+    BasicClassifier(const CatWordData& trainingData, const CatWordData& allCategories,
+                    unsigned long long totalDocCount, double knownWordWeight);
 
     // Use default copy constructo, assignment operator, and destructor
 
@@ -70,12 +180,257 @@ public:
         probability that it belongs to this category */
     double getCategoryProbability(const DocumentWordMap& document) const;
 
+    // As above, for a document counted into a reusable table
+    double getCategoryProbability(const DocumentWordTable& document) const;
+
+    // Return true if the classifier has a probability for the word
+    bool isKnownWord(const string& word) const
+    {
+        return _wordProbability.find(word) != _wordProbability.end();
+    }
+
     /* Return a string containing the probability data in this class,
         used for debugging
         WARNING: Likely to be very long */
     string classifierToString() const;
 };
 
+typedef BasicClassifier<MultinomialPolicy> Classifier;
+typedef BasicClassifier<ComplementPolicy> ComplementClassifier;
+typedef BasicClassifier<BernoulliPolicy> BernoulliClassifier;
+
 typedef map<string, Classifier> CategoryClassifiers;
+typedef map<string, ComplementClassifier> ComplementClassifiers;
+typedef map<string, BernoulliClassifier> BernoulliClassifiers;
+
+/* Constructor. Requires data about the words in documents
+    in this category, the overall number of documents, and
+    a tuning parameter used to handle unknwon words */
+template <class ScoringPolicy>
+BasicClassifier<ScoringPolicy>::BasicClassifier(const CatWordData& trainingData,
+                                                const CatWordData& allCategories,
+                                                unsigned long long totalDocCount,
+                                                double knownWordWeight)
+{
+    /* Document probability: number of documents in category divided by total.
+        number of documents. Note cast to double so divide is done at high
+        precision */
+    _docProbability = std::log((double)trainingData.getDocCount() / (double)totalDocCount);
+
+    ScoringPolicy::buildWeights(trainingData, allCategories, knownWordWeight, _docProbability,
+                                _wordProbability, _unknownWordProbability);
+}
+
+/* Given data about the words in a document, return the scaled log probability
+    that it belongs to this category */
+template <class ScoringPolicy>
+template <class Document>
+double BasicClassifier<ScoringPolicy>::scoreWords(const Document& document) const
+{
+    /* This method implements the classic Baysean algorithm for calculating the probability
+        a given document is in the class. Its calculated using logarythms to avoid numeric
+        underflow. The wanted probability is the sum of the log probability of the category
+        plus the log probability that each word in the document signals it is in the category.
+
+        Technically, to get the probability need to subtract the log probability that each word
+        appears in ANY category, called the evidence. This value is the same for every category
+        this document could belong to, so it makes no difference for classification. Leaving it
+        out makes the code faster */
+    double probability = _docProbability;
+
+    typename Document::const_iterator index;
+    map<string, double>::const_iterator wordIndex;
+    for (index = document.begin(); index != document.end(); index++) {
+        wordIndex = _wordProbability.find(index->first);
+        if (wordIndex == _wordProbability.end())
+            // Unknown word
+            probability += ScoringPolicy::scoreWord(_unknownWordProbability, index->second);
+        else
+            // Add the probability per times the word appears
+            probability += ScoringPolicy::scoreWord(wordIndex->second, index->second);
+    }
+    return probability;
+}
+
+/* Given data about the words in a document, return the scaled log probability
+    that it belongs to this category */
+template <class ScoringPolicy>
+double BasicClassifier<ScoringPolicy>::getCategoryProbability(const DocumentWordMap& document) const
+{
+    return scoreWords(document);
+}
+
+// As above, for a document counted into a reusable table
+template <class ScoringPolicy>
+double BasicClassifier<ScoringPolicy>::getCategoryProbability(const DocumentWordTable& document)
+    const
+{
+    return scoreWords(document);
+}
+
+/* Return a string containing the probability data in this class,
+    used for debugging.
+    WARNING: Likely to be very long */
+template <class ScoringPolicy>
+string BasicClassifier<ScoringPolicy>::classifierToString() const
+{
+    std::ostringstream buffer;
+    buffer << "_docProability:" << _docProbability << " _unknownWordProbability:"
+            << _unknownWordProbability << "Words:";
+
+    map<string, double>::const_iterator index;
+    for (index = _wordProbability.begin(); index != _wordProbability.end(); index++)
+        buffer << " " << index->first << ": " << index->second;
+    return buffer.str();
+}
+
+/* Multinomial classifier for a category trained with approximate word
+    counts. Words with tracked counts get their probability up front, as in
+    Classifier; the probability of every other word comes from its estimated
+    count when it is scored. Since estimates are never too low, scores are
+    never too low either, so this also finds the lowest score the document
+    could have had with exact counts */
+class SketchClassifier
+{
+public:
+    /* Constructor. Requires data about the words in documents in this
+        category, the overall number of documents, and a tuning parameter
+        used to handle unknown words */
+    SketchClassifier(const SketchedWordData& trainingData, unsigned long long totalDocCount,
+                     double knownWordWeight);
+
+    // Use default copy constructor, assignment operator, and destructor
+
+    /* Given data about the words in a document, return the scaled log
+        probability that it belongs to this category */
+    double getCategoryProbability(const DocumentWordMap& document) const;
+
+    // As above, for a document counted into a reusable table
+    double getCategoryProbability(const DocumentWordTable& document) const;
+
+    /* As above, also returning the lowest it could be with exact counts, and
+        the score with each estimate lowered by its expected error */
+    double getCategoryProbability(const DocumentWordMap& document, double& lowest,
+                                  double& corrected) const;
+
+    /* Return a string containing the probability data in this class,
+        used for debugging
+        WARNING: Likely to be very long */
+    string classifierToString() const;
+
+private:
+    double _docProbability;
+
+    // Log probability of each tracked word, and the lowest it could be
+    map<string, std::pair<double, double> > _wordProbability;
+
+    CountMinSketch _sketch;
+    unsigned long long _errorBound;
+    double _expectedError;
+    double _knownWordWeight;
+    double _logAdjustedWordCount;
+
+    // Log probability of a word seen this many times
+    double getWordProbability(double count) const
+    {
+        return std::log(count + _knownWordWeight) - _logAdjustedWordCount;
+    }
+
+    // Score a document held either as a map or as a table
+    template <class Document>
+    double scoreWords(const Document& document, double& lowest, double& corrected) const;
+};
+
+typedef map<string, SketchClassifier> SketchClassifiers;
+
+/* Multinomial classifier for a category trained with hashed words. The
+    probability of each bucket is found up front, so scoring a word is a hash
+    and a table lookup, and the classifier size is set by the number of
+    buckets, not the vocabulary */
+class HashedClassifier
+{
+public:
+    /* Constructor. Requires data about the words in documents in this
+        category, the overall number of documents, and a tuning parameter
+        used to handle unknown words */
+    HashedClassifier(const HashedWordData& trainingData, unsigned long long totalDocCount,
+                     double knownWordWeight);
+
+    /* Constructor from probabilities found earlier, such as in a mapped model
+        file. The bucket probabilities are not copied, so must outlive every
+        copy of the classifier */
+    HashedClassifier(double docProbability, double emptyBucketProbability,
+                     const double* bucketProbability, size_t bucketCount);
+
+    // Use default copy constructor, assignment operator, and destructor
+
+    /* Given data about the words in a document, return the scaled log
+        probability that it belongs to this category */
+    double getCategoryProbability(const DocumentWordMap& document) const;
+
+    // As above, for a document counted into a reusable table
+    double getCategoryProbability(const DocumentWordTable& document) const;
+
+    // The probabilities, for saving the classifier
+    double getDocProbability() const;
+    double getEmptyBucketProbability() const;
+    const double* getBucketProbabilities() const;
+    size_t getBucketCount() const;
+
+    /* Return a string containing the probability data in this class,
+        used for debugging
+        WARNING: Likely to be very long */
+    string classifierToString() const;
+
+private:
+    double _docProbability;
+
+    /* Log probability of the words in each bucket. When trained here, the
+        classifier owns them, shared between copies so the pointer stays valid */
+    std::shared_ptr<const vector<double> > _ownedBuckets;
+    const double* _bucketProbability;
+    size_t _bucketCount;
+
+    // Log probability of a bucket no training word fell into
+    double _emptyBucketProbability;
+
+    // Score a document held either as a map or as a table
+    template <class Document>
+    double scoreWords(const Document& document) const;
+};
+
+typedef map<string, HashedClassifier> HashedClassifiers;
+
+/* Multinomial scores for the pairs of neighbouring words in a document, for
+    a category. Pairs are a separate set of features from single words, with
+    their own probabilities, and the score is added to that of the words.
+    Only pairs kept in training over all categories are scored, so every
+    category scores the same pairs */
+class BigramClassifier
+{
+public:
+    /* Constructor. Requires data about the documents in this category, the
+        number of different pairs kept over all categories, and a tuning
+        parameter used to handle pairs not seen in this category */
+    BigramClassifier(const CatWordData& trainingData, size_t vocabularySize,
+                     double knownWordWeight);
+
+    // Use default copy constructor, assignment operator, and destructor
+
+    /* Given the pairs of a document, all of which were kept in training,
+        return their scaled log probability for this category */
+    double getBigramProbability(const DocumentBigrams& bigrams) const;
+
+    /* Return a string containing the probability data in this class,
+        used for debugging
+        WARNING: Likely to be very long */
+    string classifierToString() const;
+
+private:
+    BigramTable<double> _bigramProbability;
+    double _unknownBigramProbability;
+};
+
+typedef map<string, BigramClassifier> BigramClassifiers;
 
 #endif // CLASSIFIER_H
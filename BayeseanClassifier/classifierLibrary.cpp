@@ -0,0 +1,221 @@
+/* This file is part of BayseanClassifier. It classifies documents into
+    categories based on the classic Baysean classification algorithm.
+
+    Copyright (C) 2016   Ezra Erb
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License version 3 as published
+    by the Free Software Foundation.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+    I'd appreciate a note if you find this program useful or make
+    updates. Please contact me through LinkedIn (my profile also has
+    a link to the code depository)
+*/
+#include <string>
+#include <vector>
+#include <sstream>
+#include <exception>
+#include <cstring>
+
+#include "classifierLibrary.h"
+#include "documentClassifier.h"
+#include "classifyMetrics.h"
+#include "baseException.h"
+
+using namespace std;
+
+// The model behind the C handle. Classifying only reads it, so it can be shared
+struct BcModel
+{
+    BcModel(const vector<string>& trainingDirs, const vector<string>& trainingCounts,
+            const string& stopwordsFile, const ScoringSettings& scoring)
+        : _classifier(trainingDirs, trainingCounts, stopwordsFile, false, PipelineSettings(),
+                      NULL, scoring), _metrics()
+        {}
+
+    DocumentClassifier _classifier;
+
+    // Only recorded into once enabled
+    ClassifyMetrics _metrics;
+};
+
+// A context is the classifier's own, under a name C can use
+struct BcContext
+{
+    ClassifyContext _context;
+};
+
+// Copy an error message into the caller's buffer, truncating if needed
+static void setError(const char* message, char* errorBuffer, size_t errorBufferSize)
+{
+    if ((errorBuffer == NULL) || (errorBufferSize == 0))
+        return;
+    strncpy(errorBuffer, message, errorBufferSize - 1);
+    errorBuffer[errorBufferSize - 1] = '\0';
+}
+
+// Convert an array of C strings into a vector
+static void getStrings(const char* const* values, size_t count, vector<string>& result)
+{
+    result.clear();
+    if ((values == NULL) && (count > 0))
+        THROW_BASE_EXCEPTION("Error, a list of training files is missing but its count is not zero");
+    size_t index;
+    for (index = 0; index < count; index++) {
+        if (values[index] == NULL)
+            THROW_BASE_EXCEPTION("Error, a list of training files contains a missing name");
+        result.push_back(string(values[index]));
+    }
+}
+
+// Train a model from directories of documents and counts files
+BcModel* bcCreateModel(const char* const* trainingDirs, size_t trainingDirCount,
+                       const char* const* trainingCounts, size_t trainingCountsCount,
+                       const char* stopwordsFile, int scoringModel, double knownWordWeight,
+                       char* errorBuffer, size_t errorBufferSize)
+{
+    try {
+        ScoringSettings scoring;
+        switch (scoringModel) {
+        case BC_SCORING_MULTINOMIAL:
+            scoring._model = MultinomialScoring;
+            break;
+        case BC_SCORING_COMPLEMENT:
+            scoring._model = ComplementScoring;
+            break;
+        case BC_SCORING_BERNOULLI:
+            scoring._model = BernoulliScoring;
+            break;
+        default: {
+                stringstream errorMessage;
+                errorMessage << "Error, unknown scoring model " << scoringModel;
+                THROW_BASE_EXCEPTION(errorMessage.str().c_str());
+            }
+        }
+        // Written this way so NaN fails as well
+        if (!(knownWordWeight > 0.0))
+            THROW_BASE_EXCEPTION("Error, known word weight must be greater than zero");
+        scoring._knownWordWeight = knownWordWeight;
+
+        vector<string> dirs, counts;
+        getStrings(trainingDirs, trainingDirCount, dirs);
+        getStrings(trainingCounts, trainingCountsCount, counts);
+        return new BcModel(dirs, counts, (stopwordsFile != NULL) ? stopwordsFile : "stopwords.txt",
+                           scoring);
+    }
+    catch (exception& e) {
+        setError(e.what(), errorBuffer, errorBufferSize);
+    }
+    catch (...) {
+        setError("Error, unknown failure creating model", errorBuffer, errorBufferSize);
+    }
+    return NULL;
+}
+
+// Release a model
+void bcFreeModel(BcModel* model)
+{
+    delete model;
+}
+
+// Number of categories in a model
+size_t bcCategoryCount(const BcModel* model)
+{
+    return (model != NULL) ? model->_classifier.getCategories().size() : 0;
+}
+
+// Name of a category, in the same order as the scores returned
+const char* bcCategoryName(const BcModel* model, size_t category)
+{
+    if ((model == NULL) || (category >= model->_classifier.getCategories().size()))
+        return NULL;
+    return model->_classifier.getCategories()[category].c_str();
+}
+
+// Start recording latencies and counts of every document the model classifies
+void bcEnableMetrics(BcModel* model)
+{
+    if (model != NULL)
+        model->_classifier.setMetrics(&model->_metrics);
+}
+
+// Write the metrics of a model in the Prometheus text format
+size_t bcMetricsText(const BcModel* model, char* buffer, size_t bufferSize)
+{
+    string text;
+    try {
+        if (model != NULL)
+            text = model->_metrics.toPrometheus();
+    }
+    catch (...) {
+        // Out of memory. Report nothing rather than let the exception out
+        text.clear();
+    }
+    if ((buffer != NULL) && (bufferSize > 0)) {
+        size_t copied = text.length() < bufferSize ? text.length() : bufferSize - 1;
+        memcpy(buffer, text.data(), copied);
+        buffer[copied] = '\0';
+    }
+    return text.length();
+}
+
+// Create a context for classifying documents
+BcContext* bcCreateContext(char* errorBuffer, size_t errorBufferSize)
+{
+    try {
+        return new BcContext;
+    }
+    catch (exception& e) {
+        setError(e.what(), errorBuffer, errorBufferSize);
+    }
+    return NULL;
+}
+
+// Release a context
+void bcFreeContext(BcContext* context)
+{
+    delete context;
+}
+
+/* Classify a document held in memory. Only the context is written to, so
+    any number may run at once on the same model */
+int bcClassifyBuffer(const BcModel* model, BcContext* context, const char* data, size_t length,
+                     double* scores, size_t scoreCount, size_t* bestCategory,
+                     char* errorBuffer, size_t errorBufferSize)
+{
+    try {
+        if ((model == NULL) || (context == NULL))
+            THROW_BASE_EXCEPTION("Error, no model or context passed");
+        if ((data == NULL) && (length > 0))
+            THROW_BASE_EXCEPTION("Error, no document data passed");
+        const DocumentClassifier& classifier = model->_classifier;
+        if ((scores != NULL) && (scoreCount < classifier.getCategories().size()))
+            THROW_BASE_EXCEPTION("Error, score array is smaller than the number of categories");
+
+        size_t best = classifier.classifyBuffer(data, length, context->_context);
+        if (scores != NULL) {
+            const vector<double>& categoryScores = context->_context.getScores();
+            size_t index;
+            for (index = 0; index < categoryScores.size(); index++)
+                scores[index] = categoryScores[index];
+        }
+        if (bestCategory != NULL)
+            *bestCategory = best;
+        return 0;
+    }
+    catch (exception& e) {
+        setError(e.what(), errorBuffer, errorBufferSize);
+    }
+    catch (...) {
+        setError("Error, unknown failure classifying document", errorBuffer, errorBufferSize);
+    }
+    return 1;
+}
@@ -0,0 +1,112 @@
+#ifndef CLASSIFIER_LIBRARY_H
+#define CLASSIFIER_LIBRARY_H
+
+/* This file is part of BayseanClassifier. It classifies documents into
+    categories based on the classic Baysean classification algorithm.
+
+    Copyright (C) 2016   Ezra Erb
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License version 3 as published
+    by the Free Software Foundation.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+    I'd appreciate a note if you find this program useful or make
+    updates. Please contact me through LinkedIn (my profile also has
+    a link to the code depository)
+*/
+/* C interface to the classifier, for programs that embed it as a library
+    and classify documents they already hold in memory. A model is trained
+    once and is never changed after, so any number of threads can use it at
+    the same time. Each thread classifies with its own context, which holds
+    the working buffers and is reused from one document to the next.
+
+    Functions that can fail return zero on success and non-zero on failure,
+    and copy a description of the failure into the passed error buffer,
+    which may be NULL. No exceptions cross this interface */
+#include <stddef.h>
+
+#if defined(_WIN32) && defined(BAYESEAN_CLASSIFIER_EXPORTS)
+#define BC_API __declspec(dllexport)
+#elif defined(_WIN32) && defined(BAYESEAN_CLASSIFIER_DLL)
+#define BC_API __declspec(dllimport)
+#else
+#define BC_API
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Trained model. Only used through the functions below
+typedef struct BcModel BcModel;
+
+// Working data of one thread classifying documents
+typedef struct BcContext BcContext;
+
+// How documents are scored, matching --scoring-model
+enum BcScoringModel
+{
+    BC_SCORING_MULTINOMIAL = 0,
+    BC_SCORING_COMPLEMENT = 1,
+    BC_SCORING_BERNOULLI = 2
+};
+
+/* Train a model from directories of documents organized by category and
+    from counts files, either of which may be empty. Returns NULL on failure */
+BC_API BcModel* bcCreateModel(const char* const* trainingDirs, size_t trainingDirCount,
+                              const char* const* trainingCounts, size_t trainingCountsCount,
+                              const char* stopwordsFile, int scoringModel,
+                              double knownWordWeight, char* errorBuffer,
+                              size_t errorBufferSize);
+
+// Release a model. Must not be in use by any other thread
+BC_API void bcFreeModel(BcModel* model);
+
+// Number of categories in a model
+BC_API size_t bcCategoryCount(const BcModel* model);
+
+/* Name of a category, in the same order as the scores returned. NULL if
+    the position is out of range. Valid until the model is freed */
+BC_API const char* bcCategoryName(const BcModel* model, size_t category);
+
+/* Create a context for classifying documents. Returns NULL on failure. A
+    context may be used with any model, but only by one thread at a time */
+BC_API BcContext* bcCreateContext(char* errorBuffer, size_t errorBufferSize);
+
+// Release a context
+BC_API void bcFreeContext(BcContext* context);
+
+/* Start recording latencies and counts of every document the model
+    classifies, for bcMetricsText. Must be called before any thread
+    classifies with the model */
+BC_API void bcEnableMetrics(BcModel* model);
+
+/* Write the metrics of a model in the Prometheus text format, for a service
+    to serve to its scraper. The text is truncated to fit the buffer, which
+    may be NULL if the size is zero, and is always null terminated. Returns
+    the length of the whole text, so a larger buffer can be passed if it did
+    not fit. Safe to call while other threads classify */
+BC_API size_t bcMetricsText(const BcModel* model, char* buffer, size_t bufferSize);
+
+/* Classify a document held in memory. Fills in the scaled log probability
+    of each category, which must have room for bcCategoryCount() values, and
+    the position of the most likely category. Either may be NULL if not
+    wanted. Safe to call from many threads on the same model, each with its
+    own context */
+BC_API int bcClassifyBuffer(const BcModel* model, BcContext* context, const char* data,
+                            size_t length, double* scores, size_t scoreCount,
+                            size_t* bestCategory, char* errorBuffer, size_t errorBufferSize);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // CLASSIFIER_LIBRARY_H
@@ -0,0 +1,142 @@
+/* This file is part of BayseanClassifier. It classifies documents into
+    categories based on the classic Baysean classification algorithm.
+
+    Copyright (C) 2016   Ezra Erb
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License version 3 as published
+    by the Free Software Foundation.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+    I'd appreciate a note if you find this program useful or make
+    updates. Please contact me through LinkedIn (my profile also has
+    a link to the code depository)
+*/
+#include <string>
+#include <sstream>
+#include <fstream>
+#include <iomanip>
+#include <cstdio>
+#include <atomic>
+#include "classifyMetrics.h"
+#include "baseException.h"
+
+using namespace std;
+
+// Percentiles reported for every latency, as the Prometheus quantile label
+static const double Quantiles[] = {0.5, 0.9, 0.99, 0.999};
+static const char* QuantileLabels[] = {"0.5", "0.9", "0.99", "0.999"};
+static const int QuantileCount = 4;
+
+static const char* StageNames[] = {"read", "tokenize", "stem", "score"};
+
+ClassifyMetrics::ClassifyMetrics()
+    : _documents(0), _words(0), _unknownWords(0), _cacheHits(0), _cacheMisses(0)
+{}
+
+// Record one document classified
+void ClassifyMetrics::addDocument(double seconds, unsigned long long words)
+{
+    _documentLatency.record(seconds);
+    _documents.fetch_add(1, memory_order_relaxed);
+    _words.fetch_add(words, memory_order_relaxed);
+}
+
+/* Write the samples of a histogram as a Prometheus summary. Labels go
+    before the quantile label, and are empty or end with a comma */
+static void writeSummary(ostream& output, const string& name, const string& labels,
+                         const LatencyHistogram& histogram)
+{
+    int index;
+    for (index = 0; index < QuantileCount; index++)
+        output << name << "{" << labels << "quantile=\"" << QuantileLabels[index] << "\"} "
+               << histogram.getPercentile(Quantiles[index]) << "\n";
+    // Drop the trailing comma for the totals
+    string totalLabels;
+    if (!labels.empty())
+        totalLabels = "{" + labels.substr(0, labels.length() - 1) + "}";
+    output << name << "_sum" << totalLabels << " " << histogram.getSum() << "\n";
+    output << name << "_count" << totalLabels << " " << histogram.getCount() << "\n";
+}
+
+// Write the header and single sample of a counter or gauge
+static void writeValue(ostream& output, const char* name, const char* type, const char* help,
+                       double value)
+{
+    output << "# HELP " << name << " " << help << "\n";
+    output << "# TYPE " << name << " " << type << "\n";
+    output << name << " " << value << "\n";
+}
+
+// Return all metrics in the Prometheus text exposition format
+string ClassifyMetrics::toPrometheus() const
+{
+    ostringstream buffer;
+    // Enough digits for exact counts and microsecond times
+    buffer << setprecision(15);
+
+    buffer << "# HELP bayesean_document_seconds Time to classify one document over all stages\n"
+           << "# TYPE bayesean_document_seconds summary\n";
+    writeSummary(buffer, "bayesean_document_seconds", "", _documentLatency);
+
+    buffer << "# HELP bayesean_stage_seconds Time one document spent in a processing stage\n"
+           << "# TYPE bayesean_stage_seconds summary\n";
+    int stage;
+    for (stage = 0; stage < StageCount; stage++)
+        writeSummary(buffer, "bayesean_stage_seconds",
+                     string("stage=\"") + StageNames[stage] + "\",", _stageLatency[stage]);
+
+    unsigned long long words = _words.load(memory_order_relaxed);
+    unsigned long long unknownWords = _unknownWords.load(memory_order_relaxed);
+    unsigned long long cacheHits = _cacheHits.load(memory_order_relaxed);
+    unsigned long long cacheMisses = _cacheMisses.load(memory_order_relaxed);
+    writeValue(buffer, "bayesean_documents_total", "counter", "Documents classified",
+               (double)_documents.load(memory_order_relaxed));
+    writeValue(buffer, "bayesean_words_total", "counter",
+               "Words of documents classified, after removing stopwords", (double)words);
+    writeValue(buffer, "bayesean_unknown_words_total", "counter",
+               "Words of documents classified that were not seen in training",
+               (double)unknownWords);
+    writeValue(buffer, "bayesean_unknown_word_ratio", "gauge",
+               "Share of words classified that were not seen in training",
+               words > 0 ? (double)unknownWords / (double)words : 0.0);
+    writeValue(buffer, "bayesean_cache_hits_total", "counter",
+               "Documents found unchanged in the document cache", (double)cacheHits);
+    writeValue(buffer, "bayesean_cache_misses_total", "counter",
+               "Documents not found in the document cache, or changed", (double)cacheMisses);
+    writeValue(buffer, "bayesean_cache_hit_ratio", "gauge",
+               "Share of document cache lookups that found the document",
+               cacheHits + cacheMisses > 0 ?
+                   (double)cacheHits / (double)(cacheHits + cacheMisses) : 0.0);
+    return buffer.str();
+}
+
+// Write the metrics to a file, replacing it in one step
+void ClassifyMetrics::writeFile(const string& fileName) const
+{
+    string report(toPrometheus());
+    string newFileName(fileName + ".new");
+    ofstream file(newFileName.c_str(), ios_base::out | ios_base::binary | ios_base::trunc);
+    bool written = file.is_open();
+    if (written) {
+        file.write(report.data(), report.length());
+        file.close();
+        written = !file.fail();
+    }
+    // Rename will not replace an existing file on Windows, so remove it first
+    if (written)
+        remove(fileName.c_str());
+    if ((!written) || (rename(newFileName.c_str(), fileName.c_str()) != 0)) {
+        remove(newFileName.c_str());
+        stringstream errorMessage;
+        errorMessage << "Error, could not write metrics file " << fileName;
+        THROW_BASE_EXCEPTION(errorMessage.str().c_str());
+    }
+}
@@ -0,0 +1,97 @@
+#ifndef CLASSIFY_METRICS_H
+#define CLASSIFY_METRICS_H
+
+/* This file is part of BayseanClassifier. It classifies documents into
+    categories based on the classic Baysean classification algorithm.
+
+    Copyright (C) 2016   Ezra Erb
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License version 3 as published
+    by the Free Software Foundation.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+    I'd appreciate a note if you find this program useful or make
+    updates. Please contact me through LinkedIn (my profile also has
+    a link to the code depository)
+*/
+#include <string>
+#include <atomic>
+#include "latencyHistogram.h"
+
+using std::string;
+
+/* This class collects the numbers needed to watch classification against
+    service level objectives: latency percentiles for each document and for
+    each processing stage, and counts of documents, words, unknown words and
+    document cache lookups. They are reported in the Prometheus text format,
+    so a service embedding the classifier can serve them to a Prometheus
+    scraper, and batch runs can leave them for its text file collector.
+
+    Everything is recorded with atomic counters, so any number of threads
+    can record at once and a report can be made at any time */
+class ClassifyMetrics
+{
+public:
+    // Processing stages, matching those of DocumentPipeline
+    enum Stage { ReadStage, TokenizeStage, StemStage, ScoreStage, StageCount };
+
+    ClassifyMetrics();
+
+    // Use default destructor
+
+    // Record the time one document spent in a stage
+    void addStageTime(Stage stage, double seconds)
+    {
+        _stageLatency[stage].record(seconds);
+    }
+
+    /* Record one document classified, with its time over all stages and its
+        number of words */
+    void addDocument(double seconds, unsigned long long words);
+
+    // Record words of a document that were not seen in training
+    void addUnknownWords(unsigned long long words)
+    {
+        _unknownWords.fetch_add(words, std::memory_order_relaxed);
+    }
+
+    // Record a document cache lookup
+    void addCacheLookup(bool hit)
+    {
+        if (hit)
+            _cacheHits.fetch_add(1, std::memory_order_relaxed);
+        else
+            _cacheMisses.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    // Return all metrics in the Prometheus text exposition format
+    string toPrometheus() const;
+
+    /* Write the metrics to a file. The file is replaced in one step, so a
+        collector reading it never sees part of a report */
+    void writeFile(const string& fileName) const;
+
+private:
+    LatencyHistogram _documentLatency;
+    LatencyHistogram _stageLatency[StageCount];
+
+    std::atomic<unsigned long long> _documents;
+    std::atomic<unsigned long long> _words;
+    std::atomic<unsigned long long> _unknownWords;
+    std::atomic<unsigned long long> _cacheHits;
+    std::atomic<unsigned long long> _cacheMisses;
+
+    // Make non-copyable, atomics can not be copied
+    ClassifyMetrics(const ClassifyMetrics& other);
+    ClassifyMetrics& operator=(const ClassifyMetrics& other);
+};
+
+#endif // CLASSIFY_METRICS_H
@@ -0,0 +1,104 @@
+/* This file is part of BayseanClassifier. It classifies documents into
+    categories based on the classic Baysean classification algorithm.
+
+    Copyright (C) 2016   Ezra Erb
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License version 3 as published
+    by the Free Software Foundation.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+    I'd appreciate a note if you find this program useful or make
+    updates. Please contact me through LinkedIn (my profile also has
+    a link to the code depository)
+*/
+#include <string>
+#include <vector>
+#include <sstream>
+
+#include "classifyStats.h"
+#include "baseException.h"
+
+using namespace std;
+
+const size_t ClassifyStats::OtherCategory;
+
+// Construct with the names of the categories, in ID order
+ClassifyStats::ClassifyStats(const vector<string>& categories)
+    : _categories(categories), _stats(categories.size())
+{}
+
+// Record the result of classifying one document
+void ClassifyStats::addResult(size_t expectedCategory, size_t actualCategory)
+{
+    if ((expectedCategory >= _stats.size()) ||
+        ((actualCategory >= _stats.size()) && (actualCategory != OtherCategory))) {
+        // Serious problem, the caller mixed up category lists
+        stringstream errorMessage;
+        errorMessage << "Internal error: category ID out of range recording results";
+        THROW_BASE_EXCEPTION(errorMessage.str().c_str());
+    }
+    if (expectedCategory == actualCategory)
+        _stats[expectedCategory]._correct++;
+    else {
+        _stats[expectedCategory]._misclassToOther++;
+        if (actualCategory != OtherCategory)
+            _stats[actualCategory]._misclassToThis++;
+    }
+}
+
+// Add the results in another set of statistics for the same categories
+void ClassifyStats::merge(const ClassifyStats& other)
+{
+    if (other._categories != _categories) {
+        stringstream errorMessage;
+        errorMessage << "Internal error: merging results for different categories";
+        THROW_BASE_EXCEPTION(errorMessage.str().c_str());
+    }
+    size_t index;
+    for (index = 0; index < _stats.size(); index++) {
+        _stats[index]._correct += other._stats[index]._correct;
+        _stats[index]._misclassToThis += other._stats[index]._misclassToThis;
+        _stats[index]._misclassToOther += other._stats[index]._misclassToOther;
+    }
+}
+
+// Return the results per category as text
+string ClassifyStats::statsToString() const
+{
+    ostringstream buffer;
+    size_t index;
+    for (index = 0; index < _stats.size(); index++) {
+        const CatStats& stats = _stats[index];
+        if ((stats._correct == 0) && (stats._misclassToThis == 0) && (stats._misclassToOther == 0))
+            continue;
+        buffer << _categories[index] << ": _correct: " << stats._correct
+               << " _misclassToThis: " << stats._misclassToThis
+               << " _misclassToOther: " << stats._misclassToOther << endl;
+
+        // If ALL documents were classified in error for a category, precision or recall is zero
+        double precision = 0.0;
+        if (stats._correct + stats._misclassToThis != 0)
+            precision = ((double)stats._correct /
+                         ((double)stats._correct + (double)stats._misclassToThis));
+        double recall = 0.0;
+        if (stats._correct + stats._misclassToOther != 0)
+            recall = ((double)stats._correct /
+                      ((double)stats._correct + (double)stats._misclassToOther));
+        double fmeasure = 0.0;
+        // Avoid a divide by zero for truly horrible classifiers
+        if (precision + recall)
+            fmeasure = precision * recall * 2 / (precision + recall);
+
+        buffer << _categories[index] << ": " << "Balance F measure: " << fmeasure
+               << " precision: " << precision << " recall: " << recall << endl;
+    }
+    return buffer.str();
+}
@@ -0,0 +1,91 @@
+#ifndef CLASSIFY_STATS_H
+#define CLASSIFY_STATS_H
+
+/* This file is part of BayseanClassifier. It classifies documents into
+    categories based on the classic Baysean classification algorithm.
+
+    Copyright (C) 2016   Ezra Erb
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License version 3 as published
+    by the Free Software Foundation.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+    I'd appreciate a note if you find this program useful or make
+    updates. Please contact me through LinkedIn (my profile also has
+    a link to the code depository)
+*/
+#include <string>
+#include <vector>
+
+using std::string;
+using std::vector;
+
+// Classification results for one category
+struct CatStats {
+    CatStats() : _correct(0), _misclassToThis(0), _misclassToOther(0) {}
+
+    // Use default copy constructor, copy operator and destructor
+
+    // Documents correctly classified in this category
+    unsigned long long _correct;
+
+    // Documents for some other category classified in this one
+    unsigned long long _misclassToThis;
+
+    // Documents for this category classifed in some other one
+    unsigned long long _misclassToOther;
+};
+
+/* This class measures the accuracy of classification when the correct
+    category of each document is known. Categories are identified by their
+    position in the list given at construction, so recording a result is
+    just an array update.
+
+    When evaluating a classification algorithm, people care about two things,
+    precision and recall. Precision is the percentage of documents classified
+    for a given category that actually belong there. Recall is the percentage
+    of documents in a category that were classified there. These are normaly
+    combined into a statistic called the balanced F-mesaure: F = 2PR/(P+R) */
+class ClassifyStats
+{
+public:
+    /* Passed as the actual category for a document classified into a category
+        not in the list. It counts against the expected category only */
+    static const size_t OtherCategory = (size_t)-1;
+
+    // Construct with the names of the categories, in ID order
+    explicit ClassifyStats(const vector<string>& categories);
+
+    // Use default copy constructor, assignment operator, and destructor
+
+    // Record the result of classifying one document
+    void addResult(size_t expectedCategory, size_t actualCategory);
+
+    // Add the results in another set of statistics for the same categories
+    void merge(const ClassifyStats& other);
+
+    /* Return the results per category as text. Only categories that had
+        documents in them or classified to them are included */
+    string statsToString() const;
+
+    const vector<string>& getCategories() const;
+
+private:
+    vector<string> _categories;
+    vector<CatStats> _stats;
+};
+
+inline const vector<string>& ClassifyStats::getCategories() const
+{
+    return _categories;
+}
+
+#endif // CLASSIFY_STATS_H
@@ -0,0 +1,304 @@
+/* This file is part of BayseanClassifier. It classifies documents into
+    categories based on the classic Baysean classification algorithm.
+
+    Copyright (C) 2016   Ezra Erb
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License version 3 as published
+    by the Free Software Foundation.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+    I'd appreciate a note if you find this program useful or make
+    updates. Please contact me through LinkedIn (my profile also has
+    a link to the code depository)
+*/
+#include <string>
+#include <vector>
+#include <fstream>
+#include <sstream>
+#include <cstdio>
+
+#include "classifyWorkers.h"
+#include "countsFile.h"
+#include "fileFinder.h"
+#include "baseException.h"
+#include "windows.h"
+
+using namespace std;
+
+/* This class splits classification of a large list of documents across
+    worker processes.
+
+    The list file has one document path per line. The results file starts
+    with the number of results, then has one line per document, with its path
+    and category separated by a tab. Neither can appear in a Windows path */
+
+const char* const ClassifyWorkers::ListOption = "--worker-list";
+const char* const ClassifyWorkers::OutputOption = "--worker-output";
+const char* const ClassifyWorkers::ModelOption = "--worker-model";
+
+// Construct with the number of workers and the options each one needs
+ClassifyWorkers::ClassifyWorkers(unsigned short workerCount, const vector<string>& workerOptions)
+    : _workerCount(workerCount > 0 ? workerCount : 1), _workerOptions(workerOptions), _files()
+{}
+
+// Deletes the temporary files
+ClassifyWorkers::~ClassifyWorkers()
+{
+    vector<string>::const_iterator index;
+    for (index = _files.begin(); index != _files.end(); index++)
+        remove(index->c_str());
+}
+
+// Create a temporary file, recorded so it gets deleted
+string ClassifyWorkers::newTempFile()
+{
+    string fileName(FileFinder::createTempFile());
+    _files.push_back(fileName);
+    return fileName;
+}
+
+/* Train on the passed directories and counts files, and classify the
+    documents in a set of files or directories */
+void ClassifyWorkers::classify(const CatWordDataFactory& trainingDataSource,
+                               const vector<string>& trainingDirs,
+                               const vector<string>& trainingCounts,
+                               const vector<string>& classifyList, DocClassifyMap& results,
+                               vector<string>& failedFiles, vector<string>& categories)
+{
+    results.clear();
+    failedFiles.clear();
+    categories.clear();
+
+    vector<string> fileList;
+    findDocuments(classifyList, fileList);
+
+    // A single counts file is already the model. Anything else is trained here once
+    string countsFile;
+    if (trainingDirs.empty() && (trainingCounts.size() == 1))
+        countsFile = trainingCounts.front();
+    else {
+        countsFile = newTempFile();
+        trainingDataSource.writeCounts(trainingDirs, trainingCounts, countsFile);
+    }
+    // The same model every worker loads, so the same categories
+    CountsFile::readCategories(countsFile, categories);
+
+    runWorkers(string("--training-counts ") + quoteArgument(countsFile), fileList, results,
+               failedFiles);
+}
+
+/* Classify the documents in a set of files or directories with a classifier
+    trained with hashed words */
+void ClassifyWorkers::classify(const DocumentClassifier& classifier,
+                               const vector<string>& classifyList, DocClassifyMap& results,
+                               vector<string>& failedFiles, vector<string>& categories)
+{
+    results.clear();
+    failedFiles.clear();
+    categories = classifier.getCategories();
+
+    vector<string> fileList;
+    findDocuments(classifyList, fileList);
+
+    // Every worker maps this same file, so they share one copy of the model
+    string modelFile(newTempFile());
+    classifier.writeHashedModel(modelFile);
+    runWorkers(string(ModelOption) + " " + quoteArgument(modelFile), fileList, results,
+               failedFiles);
+}
+
+// Find the documents to classify. Throws if any entry has none
+void ClassifyWorkers::findDocuments(const vector<string>& classifyList, vector<string>& fileList)
+{
+    vector<string>::const_iterator listIndex;
+    for (listIndex = classifyList.begin(); listIndex != classifyList.end(); listIndex++) {
+        size_t startSize = fileList.size();
+        FileFinder::findFiles(*listIndex, fileList);
+        if (fileList.size() == startSize) {
+            stringstream errorMessage;
+            errorMessage << "ERROR, directory or file to classify " << *listIndex
+                         << " contains no files";
+            THROW_BASE_EXCEPTION(errorMessage.str().c_str());
+        }
+    }
+}
+
+/* Run workers over equal slices of the documents, each loading the model
+    given by the passed option */
+void ClassifyWorkers::runWorkers(const string& modelOption, const vector<string>& fileList,
+                                 DocClassifyMap& results, vector<string>& failedFiles)
+{
+    char programName[MAX_PATH];
+    DWORD nameLength = GetModuleFileName(NULL, programName, MAX_PATH);
+    if ((nameLength == 0) || (nameLength >= MAX_PATH))
+        THROW_BASE_EXCEPTION("Error, could not find the program to run workers with");
+    string baseCommand(quoteArgument(programName));
+    vector<string>::const_iterator optionIndex;
+    for (optionIndex = _workerOptions.begin(); optionIndex != _workerOptions.end(); optionIndex++)
+        baseCommand += " " + quoteArgument(*optionIndex);
+    baseCommand += " " + modelOption;
+
+    /* Give each worker a contiguous slice, so documents in the same
+        directory tend to stay together */
+    size_t sliceSize = (fileList.size() + _workerCount - 1) / _workerCount;
+    vector<size_t> sliceStarts;
+    vector<string> listFiles;
+    vector<string> outputFiles;
+    vector<void*> processes;
+    size_t start;
+    for (start = 0; start < fileList.size(); start += sliceSize) {
+        size_t end = (start + sliceSize < fileList.size()) ? start + sliceSize : fileList.size();
+        string listFile(newTempFile());
+        ofstream list(listFile.c_str(), ios_base::out | ios_base::trunc);
+        size_t index;
+        for (index = start; index < end; index++)
+            list << fileList[index] << '\n';
+        list.close();
+        if (list.fail()) {
+            stringstream errorMessage;
+            errorMessage << "Error, could not write worker document list " << listFile;
+            THROW_BASE_EXCEPTION(errorMessage.str().c_str());
+        }
+        listFiles.push_back(listFile);
+        outputFiles.push_back(newTempFile());
+        sliceStarts.push_back(start);
+    }
+
+    /* Start every worker before waiting for any. A worker that can't be
+        started fails its slice the same as one that crashes, so workers already
+        running are always waited for */
+    size_t worker;
+    for (worker = 0; worker < sliceStarts.size(); worker++)
+        processes.push_back(startWorker(baseCommand + " " + ListOption + " " +
+                                        quoteArgument(listFiles[worker]) + " " + OutputOption +
+                                        " " + quoteArgument(outputFiles[worker])));
+    for (worker = 0; worker < processes.size(); worker++) {
+        bool succeeded = (processes[worker] != NULL) && waitForWorker(processes[worker]);
+        DocClassifyMap workerResults;
+        if (succeeded)
+            succeeded = readResults(outputFiles[worker], workerResults);
+        size_t end = (sliceStarts[worker] + sliceSize < fileList.size()) ?
+            sliceStarts[worker] + sliceSize : fileList.size();
+        size_t index;
+        for (index = sliceStarts[worker]; index < end; index++) {
+            DocClassifyMap::const_iterator found = workerResults.find(fileList[index]);
+            if (succeeded && (found != workerResults.end()))
+                results[found->first] = found->second;
+            else
+                failedFiles.push_back(fileList[index]);
+        }
+    }
+}
+
+// In a worker, read the documents to classify
+void ClassifyWorkers::readFileList(const string& fileName, vector<string>& fileList)
+{
+    fileList.clear();
+    ifstream list(fileName.c_str());
+    if (!list.is_open()) {
+        stringstream errorMessage;
+        errorMessage << "Error, worker document list " << fileName << " could not be opened";
+        THROW_BASE_EXCEPTION(errorMessage.str().c_str());
+    }
+    string line;
+    while (getline(list, line))
+        if (!line.empty())
+            fileList.push_back(line);
+}
+
+// In a worker, write the results
+void ClassifyWorkers::writeResults(const string& fileName, const DocClassifyMap& results)
+{
+    ofstream output(fileName.c_str(), ios_base::out | ios_base::trunc);
+    output << results.size() << '\n';
+    DocClassifyMap::const_iterator index;
+    for (index = results.begin(); index != results.end(); index++)
+        output << index->first << '\t' << index->second << '\n';
+    output.close();
+    if (output.fail()) {
+        stringstream errorMessage;
+        errorMessage << "Error, could not write worker results " << fileName;
+        THROW_BASE_EXCEPTION(errorMessage.str().c_str());
+    }
+}
+
+// Read the results of a worker. Returns false if they are missing or incomplete
+bool ClassifyWorkers::readResults(const string& fileName, DocClassifyMap& results)
+{
+    results.clear();
+    ifstream input(fileName.c_str());
+    size_t count = 0;
+    string line;
+    if ((!getline(input, line)) || (!(istringstream(line) >> count)))
+        return false;
+    while (getline(input, line)) {
+        size_t tab = line.find('\t');
+        if (tab == string::npos)
+            return false;
+        results[line.substr(0, tab)] = line.substr(tab + 1);
+    }
+    // A worker that died while writing leaves fewer lines than it promised
+    return results.size() == count;
+}
+
+/* Quote an argument so a worker's command line splits it back unchanged,
+    following the rules of the C runtime: backslashes are literal unless they
+    come before a quote, where each must be doubled */
+string ClassifyWorkers::quoteArgument(const string& argument)
+{
+    string result("\"");
+    size_t backslashes = 0;
+    string::const_iterator index;
+    for (index = argument.begin(); index != argument.end(); index++) {
+        if (*index == '\\') {
+            backslashes++;
+            continue;
+        }
+        if (*index == '"')
+            result.append(backslashes * 2 + 1, '\\');
+        else
+            result.append(backslashes, '\\');
+        result.push_back(*index);
+        backslashes = 0;
+    }
+    // The closing quote follows, so trailing backslashes must be doubled too
+    result.append(backslashes * 2, '\\');
+    result.push_back('"');
+    return result;
+}
+
+// Start a worker process. Returns NULL if it could not be started
+void* ClassifyWorkers::startWorker(const string& commandLine)
+{
+    STARTUPINFO startup;
+    PROCESS_INFORMATION process;
+    ZeroMemory(&startup, sizeof(startup));
+    startup.cb = sizeof(startup);
+    ZeroMemory(&process, sizeof(process));
+
+    // The command line may be changed by the call, so it needs its own copy
+    vector<char> command(commandLine.begin(), commandLine.end());
+    command.push_back('\0');
+    if (!CreateProcess(NULL, &command[0], NULL, NULL, FALSE, 0, NULL, NULL, &startup, &process))
+        return NULL;
+    CloseHandle(process.hThread);
+    return process.hProcess;
+}
+
+// Wait for a worker process to finish. Returns false if it failed
+bool ClassifyWorkers::waitForWorker(void* process)
+{
+    DWORD exitCode = 1;
+    bool finished = (WaitForSingleObject(process, INFINITE) == WAIT_OBJECT_0) &&
+        GetExitCodeProcess(process, &exitCode);
+    CloseHandle(process);
+    return finished && (exitCode == 0);
+}
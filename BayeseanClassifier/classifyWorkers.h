@@ -0,0 +1,120 @@
+#ifndef CLASSIFY_WORKERS_H
+#define CLASSIFY_WORKERS_H
+
+/* This file is part of BayseanClassifier. It classifies documents into
+    categories based on the classic Baysean classification algorithm.
+
+    Copyright (C) 2016   Ezra Erb
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License version 3 as published
+    by the Free Software Foundation.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+    I'd appreciate a note if you find this program useful or make
+    updates. Please contact me through LinkedIn (my profile also has
+    a link to the code depository)
+*/
+#include <string>
+#include <vector>
+#include "documentClassifier.h"
+#include "catWordDataFactory.h"
+
+using std::string;
+using std::vector;
+
+/* This class splits classification of a large list of documents across
+    worker processes, each running this program on its own slice of the list.
+    A document that crashes the program then only loses the results of its
+    worker's slice, and the rest of the job completes. Results are merged into
+    one map, so the output is the same as classifying in a single process.
+
+    The model is trained once and written to a counts file that every worker
+    loads, so the training documents are only read once. A model of hashed
+    words is instead written as a model file that workers map read only, so
+    they also share the memory holding it. Documents and results
+    are passed through temporary files, which are deleted when the object is
+    destroyed. Starting processes is OS specific, so this class encapsulates
+    the details. Currently only a Windows implementation is available */
+class ClassifyWorkers
+{
+public:
+    /* Construct with the number of workers, and the options each needs to
+        build its classifier the same way, other than the training data */
+    ClassifyWorkers(unsigned short workerCount, const vector<string>& workerOptions);
+
+    // Deletes the temporary files
+    ~ClassifyWorkers();
+
+    /* Train on the passed directories and counts files, and classify the
+        documents in a set of files or directories. Documents of a worker
+        that failed are left out of the results and listed in failedFiles.
+        Categories gets every category the model can choose, in name order
+        like DocumentClassifier::getCategories() */
+    void classify(const CatWordDataFactory& trainingDataSource,
+                  const vector<string>& trainingDirs, const vector<string>& trainingCounts,
+                  const vector<string>& classifyList, DocClassifyMap& results,
+                  vector<string>& failedFiles, vector<string>& categories);
+
+    /* As above, with a classifier already trained with hashed words. It is
+        written to a model file that every worker maps read only, so workers
+        share one copy of the model instead of each loading its own */
+    void classify(const DocumentClassifier& classifier, const vector<string>& classifyList,
+                  DocClassifyMap& results, vector<string>& failedFiles,
+                  vector<string>& categories);
+
+    // Options that run the program as a worker, followed by a file name
+    static const char* const ListOption;
+    static const char* const OutputOption;
+    static const char* const ModelOption;
+
+    // In a worker, read the documents to classify. Throws if it can not be read
+    static void readFileList(const string& fileName, vector<string>& fileList);
+
+    // In a worker, write the results. Throws if they can not be written
+    static void writeResults(const string& fileName, const DocClassifyMap& results);
+
+private:
+    unsigned short _workerCount;
+    vector<string> _workerOptions;
+
+    // Temporary files to delete
+    vector<string> _files;
+
+    // Create a temporary file, recorded so it gets deleted
+    string newTempFile();
+
+    // Find the documents to classify. Throws if any entry has none
+    static void findDocuments(const vector<string>& classifyList, vector<string>& fileList);
+
+    /* Run workers over equal slices of the documents, each loading the model
+        given by the passed option, and merge their results */
+    void runWorkers(const string& modelOption, const vector<string>& fileList,
+                    DocClassifyMap& results, vector<string>& failedFiles);
+
+    /* Read the results of a worker. Returns false if they are missing or
+        incomplete, which means it failed */
+    static bool readResults(const string& fileName, DocClassifyMap& results);
+
+    // Quote an argument so a worker's command line splits it back unchanged
+    static string quoteArgument(const string& argument);
+
+    // Start a worker process. Returns NULL if it could not be started
+    static void* startWorker(const string& commandLine);
+
+    // Wait for a worker process to finish. Returns false if it failed
+    static bool waitForWorker(void* process);
+
+    // Make non-copyable, owns the files
+    ClassifyWorkers(const ClassifyWorkers& other);
+    ClassifyWorkers& operator=(const ClassifyWorkers& other);
+};
+
+#endif // CLASSIFY_WORKERS_H
@@ -0,0 +1,127 @@
+/* This file is part of BayseanClassifier. It classifies documents into
+    categories based on the classic Baysean classification algorithm.
+
+    Copyright (C) 2016   Ezra Erb
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License version 3 as published
+    by the Free Software Foundation.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+    I'd appreciate a note if you find this program useful or make
+    updates. Please contact me through LinkedIn (my profile also has
+    a link to the code depository)
+*/
+#include <cstddef>
+#include <cstring>
+#include "contentHash.h"
+
+using namespace std;
+
+static const unsigned long long Prime1 = 0x9E3779B185EBCA87ULL;
+static const unsigned long long Prime2 = 0xC2B2AE3D27D4EB4FULL;
+static const unsigned long long Prime3 = 0x165667B19E3779F9ULL;
+static const unsigned long long Prime4 = 0x85EBCA77C2B2AE63ULL;
+static const unsigned long long Prime5 = 0x27D4EB2F165667C5ULL;
+
+static inline unsigned long long rotateLeft(unsigned long long value, int bits)
+{
+    return (value << bits) | (value >> (64 - bits));
+}
+
+/* Unaligned reads. XXH64 is defined on little endian values, which is what
+    every platform this runs on uses */
+static inline unsigned long long read64(const char* data)
+{
+    unsigned long long value;
+    memcpy(&value, data, sizeof(value));
+    return value;
+}
+
+static inline unsigned long long read32(const char* data)
+{
+    unsigned int value;
+    memcpy(&value, data, sizeof(value));
+    return value;
+}
+
+// Mix eight bytes of input into a lane
+static inline unsigned long long mixLane(unsigned long long lane, unsigned long long input)
+{
+    lane += input * Prime2;
+    lane = rotateLeft(lane, 31);
+    return lane * Prime1;
+}
+
+// Fold a finished lane into the hash
+static inline unsigned long long mergeLane(unsigned long long hash, unsigned long long lane)
+{
+    hash ^= mixLane(0, lane);
+    return (hash * Prime1) + Prime4;
+}
+
+// Hash the contents of a document, to find exact copies
+unsigned long long hashContent(const char* data, size_t length)
+{
+    const char* position = data;
+    const char* end = data + length;
+    unsigned long long hash;
+
+    if (length >= 32) {
+        // Four lanes with no dependence on each other, so they run in parallel
+        unsigned long long lane1 = Prime1 + Prime2;
+        unsigned long long lane2 = Prime2;
+        unsigned long long lane3 = 0;
+        unsigned long long lane4 = 0 - Prime1;
+        const char* lastStripe = end - 32;
+        do {
+            lane1 = mixLane(lane1, read64(position));
+            lane2 = mixLane(lane2, read64(position + 8));
+            lane3 = mixLane(lane3, read64(position + 16));
+            lane4 = mixLane(lane4, read64(position + 24));
+            position += 32;
+        } while (position <= lastStripe);
+
+        hash = rotateLeft(lane1, 1) + rotateLeft(lane2, 7) + rotateLeft(lane3, 12) +
+            rotateLeft(lane4, 18);
+        hash = mergeLane(hash, lane1);
+        hash = mergeLane(hash, lane2);
+        hash = mergeLane(hash, lane3);
+        hash = mergeLane(hash, lane4);
+    }
+    else
+        hash = Prime5;
+    hash += length;
+
+    // The rest, less than a stripe
+    while (position + 8 <= end) {
+        hash ^= mixLane(0, read64(position));
+        hash = (rotateLeft(hash, 27) * Prime1) + Prime4;
+        position += 8;
+    }
+    if (position + 4 <= end) {
+        hash ^= read32(position) * Prime1;
+        hash = (rotateLeft(hash, 23) * Prime2) + Prime3;
+        position += 4;
+    }
+    while (position < end) {
+        hash ^= (unsigned long long)(unsigned char)*position * Prime5;
+        hash = rotateLeft(hash, 11) * Prime1;
+        position++;
+    }
+
+    // Spread every input bit over the whole result
+    hash ^= hash >> 33;
+    hash *= Prime2;
+    hash ^= hash >> 29;
+    hash *= Prime3;
+    hash ^= hash >> 32;
+    return hash;
+}
@@ -0,0 +1,34 @@
+#ifndef CONTENT_HASH_H
+#define CONTENT_HASH_H
+
+/* This file is part of BayseanClassifier. It classifies documents into
+    categories based on the classic Baysean classification algorithm.
+
+    Copyright (C) 2016   Ezra Erb
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License version 3 as published
+    by the Free Software Foundation.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+    I'd appreciate a note if you find this program useful or make
+    updates. Please contact me through LinkedIn (my profile also has
+    a link to the code depository)
+*/
+#include <cstddef>
+
+/* Hash the contents of a document, to find exact copies. Uses the XXH64
+    algorithm, which reads eight bytes at a time in four independent lanes,
+    so it runs at close to memory speed, many times faster than hashing a
+    byte at a time as hashWord does. The result matches other XXH64
+    implementations with a seed of zero */
+unsigned long long hashContent(const char* data, size_t length);
+
+#endif // CONTENT_HASH_H
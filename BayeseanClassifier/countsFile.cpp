@@ -0,0 +1,429 @@
+/* This file is part of BayseanClassifier. It classifies documents into
+    categories based on the classic Baysean classification algorithm.
+
+    Copyright (C) 2016   Ezra Erb
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License version 3 as published
+    by the Free Software Foundation.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+    I'd appreciate a note if you find this program useful or make
+    updates. Please contact me through LinkedIn (my profile also has
+    a link to the code depository)
+*/
+#include <string>
+#include <vector>
+#include <queue>
+#include <functional>
+#include <fstream>
+#include <sstream>
+#include <map>
+
+#include "countsFile.h"
+#include "catWordData.h"
+#include "catWordDataFactory.h"
+#include "varintCoding.h"
+#include "baseException.h"
+
+using namespace std;
+
+/* These classes store the raw word counts from training in a compact binary
+    file, so training can be split into shards and merged afterward */
+
+static const char CountsMagic[] = "BCNT";
+static const unsigned long long CountsVersion = 1;
+
+// No real word or category comes close to this, so longer ones mean corruption
+static const unsigned long long MaxStringLength = 1 << 20;
+
+// Create the file. Throws if it can not be created
+CountsFileWriter::CountsFileWriter(const string& fileName)
+    : _fileName(fileName), _lastWord()
+{
+    _file.open(fileName.c_str(), ios_base::out | ios_base::binary | ios_base::trunc);
+    if (!_file.is_open()) {
+        stringstream errorMessage;
+        errorMessage << "Error, counts file " << fileName << " could not be created";
+        THROW_BASE_EXCEPTION(errorMessage.str().c_str());
+    }
+    _file.write(CountsMagic, 4);
+    writeNumber(CountsVersion);
+}
+
+// Closes the file if close() was not called
+CountsFileWriter::~CountsFileWriter()
+{
+    if (_file.is_open())
+        _file.close();
+}
+
+// Start a new category
+void CountsFileWriter::beginCategory(const string& category, const CountsHeader& header)
+{
+    _file.put('C');
+    writeString(category.data(), category.length());
+    writeNumber(header._docCount);
+    writeNumber(header._wordCount);
+    writeNumber(header._totalWordCount);
+    _lastWord.clear();
+}
+
+// Add a word to the current category
+void CountsFileWriter::addWord(const string& word, unsigned long long count)
+{
+    if (word <= _lastWord) {
+        // Serious problem, the caller did not give the words in order
+        stringstream errorMessage;
+        errorMessage << "Internal error: word " << word << " written to counts file out of order";
+        THROW_BASE_EXCEPTION(errorMessage.str().c_str());
+    }
+    // Only store the part of the word that differs from the previous one
+    size_t shared = 0;
+    while ((shared < word.length()) && (shared < _lastWord.length()) &&
+           (word[shared] == _lastWord[shared]))
+        shared++;
+    writeNumber(shared);
+    writeString(word.data() + shared, word.length() - shared);
+    writeNumber(count);
+    _lastWord = word;
+}
+
+void CountsFileWriter::endCategory()
+{
+    // A word with nothing after the shared part can't happen, so marks the end
+    writeNumber(0);
+    writeNumber(0);
+}
+
+// Finish the file. Throws if it could not be written
+void CountsFileWriter::close()
+{
+    _file.put('E');
+    _file.close();
+    if (_file.fail()) {
+        stringstream errorMessage;
+        errorMessage << "Error, could not write counts file " << _fileName;
+        THROW_BASE_EXCEPTION(errorMessage.str().c_str());
+    }
+}
+
+// Numbers are variable length integers, as in the other binary files
+void CountsFileWriter::writeNumber(unsigned long long value)
+{
+    char bytes[MaxNumberBytes];
+    _file.write(bytes, encodeNumber(value, bytes));
+}
+
+void CountsFileWriter::writeString(const char* data, size_t length)
+{
+    writeNumber(length);
+    _file.write(data, length);
+}
+
+// Open the file. Throws if it can not be opened or is not a counts file
+CountsFileReader::CountsFileReader(const string& fileName)
+    : _fileName(fileName), _lastCategory(), _lastWord(), _inCategory(false), _atEnd(false)
+{
+    _file.open(fileName.c_str(), ios_base::in | ios_base::binary);
+    if (!_file.is_open()) {
+        stringstream errorMessage;
+        errorMessage << "Error, counts file " << fileName << " could not be opened";
+        THROW_BASE_EXCEPTION(errorMessage.str().c_str());
+    }
+    char magic[4];
+    _file.read(magic, 4);
+    if ((_file.gcount() != 4) || (string(magic, 4) != string(CountsMagic, 4))) {
+        stringstream errorMessage;
+        errorMessage << "Error, " << fileName << " is not a counts file";
+        THROW_BASE_EXCEPTION(errorMessage.str().c_str());
+    }
+    if (readNumber() != CountsVersion) {
+        stringstream errorMessage;
+        errorMessage << "Error, counts file " << fileName << " has an unsupported format version";
+        THROW_BASE_EXCEPTION(errorMessage.str().c_str());
+    }
+}
+
+// Read the next category. Returns false at the end of the file
+bool CountsFileReader::nextCategory(string& category, CountsHeader& header)
+{
+    // Skip whatever remains of the previous category
+    string word;
+    unsigned long long count;
+    while (_inCategory)
+        nextWord(word, count);
+    if (_atEnd)
+        return false;
+
+    char tag = readByte();
+    if (tag == 'E') {
+        _atEnd = true;
+        return false;
+    }
+    if (tag != 'C')
+        corrupt();
+
+    unsigned long long length = readNumber();
+    if (length > MaxStringLength)
+        corrupt();
+    category.resize((size_t)length);
+    if (length > 0)
+        _file.read(&category[0], length);
+    if ((unsigned long long)_file.gcount() != length)
+        corrupt();
+    // Merging depends on the order, so enforce it
+    if (category <= _lastCategory)
+        corrupt();
+    _lastCategory = category;
+    header._docCount = readNumber();
+    header._wordCount = readNumber();
+    header._totalWordCount = readNumber();
+    _lastWord.clear();
+    _inCategory = true;
+    return true;
+}
+
+// Read the next word of the current category. Returns false at its end
+bool CountsFileReader::nextWord(string& word, unsigned long long& count)
+{
+    if (!_inCategory)
+        return false;
+    unsigned long long shared = readNumber();
+    unsigned long long length = readNumber();
+    if (length == 0) {
+        _inCategory = false;
+        return false;
+    }
+    if ((shared > _lastWord.length()) || (length > MaxStringLength))
+        corrupt();
+    word.assign(_lastWord, 0, (size_t)shared);
+    word.resize((size_t)(shared + length));
+    _file.read(&word[(size_t)shared], length);
+    if ((unsigned long long)_file.gcount() != length)
+        corrupt();
+    // Merging depends on the order, so enforce it
+    if (word <= _lastWord)
+        corrupt();
+    count = readNumber();
+    _lastWord = word;
+    return true;
+}
+
+unsigned long long CountsFileReader::readNumber()
+{
+    unsigned long long value = 0;
+    int shift = 0;
+    while (true) {
+        unsigned char byte = (unsigned char)readByte();
+        if (shift > 63)
+            corrupt();
+        value |= (unsigned long long)(byte & 0x7F) << shift;
+        if (!(byte & 0x80))
+            break;
+        shift += 7;
+    }
+    return value;
+}
+
+char CountsFileReader::readByte()
+{
+    int byte = _file.get();
+    if (byte == EOF)
+        corrupt();
+    return (char)byte;
+}
+
+// Report a file that ends early or has bad data
+void CountsFileReader::corrupt() const
+{
+    stringstream errorMessage;
+    errorMessage << "Error, counts file " << _fileName << " is truncated or corrupt";
+    THROW_BASE_EXCEPTION(errorMessage.str().c_str());
+}
+
+// Write training data to a counts file
+void CountsFile::write(const string& fileName, const InfoByCategory& info)
+{
+    CountsFileWriter writer(fileName);
+    InfoByCategory::const_iterator catIndex;
+    for (catIndex = info.begin(); catIndex != info.end(); catIndex++) {
+        CountsHeader header;
+        header._docCount = catIndex->second.getDocCount();
+        header._wordCount = catIndex->second.getWordCount();
+        header._totalWordCount = catIndex->second.getTotalWordCount();
+        writer.beginCategory(catIndex->first, header);
+
+        const CategoryWordMap& words = catIndex->second.getWordData();
+        CategoryWordMap::const_iterator wordIndex;
+        for (wordIndex = words.begin(); wordIndex != words.end(); wordIndex++)
+            writer.addWord(wordIndex->first, wordIndex->second);
+        writer.endCategory();
+    }
+    writer.close();
+}
+
+// Read a counts file, merging its data into the passed training data
+void CountsFile::read(const string& fileName, InfoByCategory& info)
+{
+    CountsFileReader reader(fileName);
+    string category;
+    CountsHeader header;
+    string word;
+    unsigned long long count;
+    while (reader.nextCategory(category, header)) {
+        CatWordData data;
+        data.addTotals(header._docCount, header._wordCount, header._totalWordCount);
+        while (reader.nextWord(word, count))
+            data.addWordCount(word, count);
+        info[category].mergeData(data);
+    }
+}
+
+// Return the categories of a counts file that have documents, in name order
+void CountsFile::readCategories(const string& fileName, vector<string>& categories)
+{
+    // A category can appear more than once in a file that was never merged
+    map<string, unsigned long long> docCounts;
+    CountsFileReader reader(fileName);
+    string category;
+    CountsHeader header;
+    while (reader.nextCategory(category, header))
+        docCounts[category] += header._docCount;
+    categories.clear();
+    map<string, unsigned long long>::const_iterator index;
+    for (index = docCounts.begin(); index != docCounts.end(); index++)
+        if (index->second > 0)
+            categories.push_back(index->first);
+}
+
+/* Read a counts file into fixed size training data. Categories not already
+    in the data are created from the passed settings */
+template <class CategoryData, class Settings>
+static void readTables(const string& fileName, const Settings& settings,
+                       map<string, CategoryData>& data)
+{
+    CountsFileReader reader(fileName);
+    string category;
+    CountsHeader header;
+    string word;
+    unsigned long long count;
+    while (reader.nextCategory(category, header)) {
+        // Words go straight into the table, so the file is never all in memory
+        typename map<string, CategoryData>::iterator entry = data.lower_bound(category);
+        if ((entry == data.end()) || (entry->first != category))
+            entry = data.insert(entry, make_pair(category, CategoryData(settings)));
+        entry->second.addTotals(header._docCount, header._wordCount, header._totalWordCount);
+        while (reader.nextWord(word, count))
+            entry->second.addWordCount(word, count);
+    }
+}
+
+// Read a counts file into approximate training data
+void CountsFile::read(const string& fileName, const SketchSettings& settings,
+                      SketchesByCategory& sketches)
+{
+    readTables(fileName, settings, sketches);
+}
+
+// Read a counts file into hashed training data
+void CountsFile::read(const string& fileName, unsigned short hashBits, HashedByCategory& hashed)
+{
+    readTables(fileName, hashBits, hashed);
+}
+
+/* Merge many counts files into one. The files are read in step, so
+    memory use does not depend on their size */
+void CountsFile::merge(const vector<string>& inputFiles, const string& outputFile)
+{
+    if (inputFiles.empty()) {
+        stringstream errorMessage;
+        errorMessage << "Error, no counts files to merge";
+        THROW_BASE_EXCEPTION(errorMessage.str().c_str());
+    }
+
+    vector<CountsFileReader*> readers;
+    try {
+        vector<string>::const_iterator fileIndex;
+        for (fileIndex = inputFiles.begin(); fileIndex != inputFiles.end(); fileIndex++)
+            readers.push_back(new CountsFileReader(*fileIndex));
+
+        // Current category of each file, if it has one left
+        vector<string> categories(readers.size());
+        vector<CountsHeader> headers(readers.size());
+        vector<bool> hasCategory(readers.size());
+        size_t index;
+        for (index = 0; index < readers.size(); index++)
+            hasCategory[index] = readers[index]->nextCategory(categories[index], headers[index]);
+
+        CountsFileWriter writer(outputFile);
+        while (true) {
+            // Categories are in order in every file, so the smallest goes next
+            const string* smallest = NULL;
+            for (index = 0; index < readers.size(); index++)
+                if (hasCategory[index] && ((smallest == NULL) || (categories[index] < *smallest)))
+                    smallest = &categories[index];
+            if (smallest == NULL)
+                break;
+            string category(*smallest);
+
+            CountsHeader total;
+            vector<size_t> members;
+            for (index = 0; index < readers.size(); index++)
+                if (hasCategory[index] && (categories[index] == category)) {
+                    members.push_back(index);
+                    addCountChecked(total._docCount, headers[index]._docCount);
+                    addCountChecked(total._wordCount, headers[index]._wordCount);
+                    addCountChecked(total._totalWordCount, headers[index]._totalWordCount);
+                }
+            writer.beginCategory(category, total);
+
+            /* Merge the words of every file with this category. The heap holds
+                the next word of each file, so the smallest is always on top */
+            typedef pair<string, size_t> HeapEntry;
+            priority_queue<HeapEntry, vector<HeapEntry>, greater<HeapEntry> > heap;
+            vector<unsigned long long> counts(readers.size());
+            string word;
+            vector<size_t>::const_iterator memberIndex;
+            for (memberIndex = members.begin(); memberIndex != members.end(); memberIndex++)
+                if (readers[*memberIndex]->nextWord(word, counts[*memberIndex]))
+                    heap.push(make_pair(word, *memberIndex));
+
+            while (!heap.empty()) {
+                string mergeWord(heap.top().first);
+                unsigned long long count = 0;
+                while ((!heap.empty()) && (heap.top().first == mergeWord)) {
+                    size_t member = heap.top().second;
+                    heap.pop();
+                    addCountChecked(count, counts[member]);
+                    if (readers[member]->nextWord(word, counts[member]))
+                        heap.push(make_pair(word, member));
+                }
+                writer.addWord(mergeWord, count);
+            }
+            writer.endCategory();
+
+            for (memberIndex = members.begin(); memberIndex != members.end(); memberIndex++)
+                hasCategory[*memberIndex] = readers[*memberIndex]->nextCategory(
+                    categories[*memberIndex], headers[*memberIndex]);
+        } // While categories to merge
+        writer.close();
+    }
+    catch (...) {
+        // Ensure files always released
+        vector<CountsFileReader*>::iterator readerIndex;
+        for (readerIndex = readers.begin(); readerIndex != readers.end(); readerIndex++)
+            delete *readerIndex;
+        throw;
+    }
+    vector<CountsFileReader*>::iterator readerIndex;
+    for (readerIndex = readers.begin(); readerIndex != readers.end(); readerIndex++)
+        delete *readerIndex;
+}
@@ -0,0 +1,163 @@
+#ifndef COUNTS_FILE_H
+#define COUNTS_FILE_H
+
+/* This file is part of BayseanClassifier. It classifies documents into
+    categories based on the classic Baysean classification algorithm.
+
+    Copyright (C) 2016   Ezra Erb
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License version 3 as published
+    by the Free Software Foundation.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+    I'd appreciate a note if you find this program useful or make
+    updates. Please contact me through LinkedIn (my profile also has
+    a link to the code depository)
+*/
+#include <string>
+#include <vector>
+#include <fstream>
+#include "catWordDataFactory.h"
+
+using std::string;
+using std::vector;
+using std::ifstream;
+using std::ofstream;
+
+/* These classes store the raw word counts from training in a compact binary
+    file. Training can then be split into shards, each run on a different
+    machine, and the shards merged afterward.
+
+    The file holds categories in name order, and the words within each
+    category in word order. Since both are sorted, files can be merged by
+    reading them in step, without holding any of them in memory. Numbers are
+    stored as variable length integers, and each word only stores the part
+    that differs from the word before it:
+        magic "BCNT", format version
+        for each category:
+            'C', name, document count, word count, total word count
+            for each word: length shared with the previous word, length of
+                the rest of the word, the rest of the word, count
+            a zero length word ends the category
+        'E' ends the file */
+
+// Category totals as stored in a counts file
+struct CountsHeader
+{
+    CountsHeader() : _docCount(0), _wordCount(0), _totalWordCount(0) {}
+
+    // Use default copy constructor, copy operator and destructor
+
+    unsigned long long _docCount;
+    unsigned long long _wordCount;
+    unsigned long long _totalWordCount;
+};
+
+// Writes a counts file one category and word at a time
+class CountsFileWriter
+{
+public:
+    // Create the file. Throws if it can not be created
+    explicit CountsFileWriter(const string& fileName);
+
+    // Closes the file if close() was not called
+    ~CountsFileWriter();
+
+    /* Start a new category. Categories must be written in name order, and
+        the previous one must have been ended */
+    void beginCategory(const string& category, const CountsHeader& header);
+
+    // Add a word to the current category. Words must be written in order
+    void addWord(const string& word, unsigned long long count);
+
+    void endCategory();
+
+    // Finish the file. Throws if it could not be written
+    void close();
+
+private:
+    string _fileName;
+    ofstream _file;
+    string _lastWord;
+
+    void writeNumber(unsigned long long value);
+    void writeString(const char* data, size_t length);
+
+    // Make non-copyable, owns the file
+    CountsFileWriter(const CountsFileWriter& other);
+    CountsFileWriter& operator=(const CountsFileWriter& other);
+};
+
+// Reads a counts file one category and word at a time
+class CountsFileReader
+{
+public:
+    // Open the file. Throws if it can not be opened or is not a counts file
+    explicit CountsFileReader(const string& fileName);
+
+    // Use default destructor
+
+    /* Read the next category. Returns false at the end of the file. Any
+        words not read from the previous category are skipped */
+    bool nextCategory(string& category, CountsHeader& header);
+
+    // Read the next word of the current category. Returns false at its end
+    bool nextWord(string& word, unsigned long long& count);
+
+private:
+    string _fileName;
+    ifstream _file;
+    string _lastCategory;
+    string _lastWord;
+    bool _inCategory;
+    bool _atEnd;
+
+    unsigned long long readNumber();
+    char readByte();
+
+    // Report a file that ends early or has bad data
+    void corrupt() const;
+
+    // Make non-copyable, owns the file
+    CountsFileReader(const CountsFileReader& other);
+    CountsFileReader& operator=(const CountsFileReader& other);
+};
+
+// Operations on whole counts files
+class CountsFile
+{
+public:
+    // Write training data to a counts file
+    static void write(const string& fileName, const InfoByCategory& info);
+
+    // Read a counts file, merging its data into the passed training data
+    static void read(const string& fileName, InfoByCategory& info);
+
+    /* Read a counts file into approximate training data. Categories not
+        already in the data are added with the passed settings */
+    static void read(const string& fileName, const SketchSettings& settings,
+                     SketchesByCategory& sketches);
+
+    /* Read a counts file into hashed training data. Categories not already
+        in the data are added with the passed number of hash bits */
+    static void read(const string& fileName, unsigned short hashBits, HashedByCategory& hashed);
+
+    /* Return the categories of a counts file that have documents, in name
+        order, which are the categories a classifier trained on it chooses
+        from. Words are skipped, not loaded */
+    static void readCategories(const string& fileName, vector<string>& categories);
+
+    /* Merge many counts files into one. The files are read in step, so
+        memory use does not depend on their size */
+    static void merge(const vector<string>& inputFiles, const string& outputFile);
+};
+
+#endif // COUNTS_FILE_H
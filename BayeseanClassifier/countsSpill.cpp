@@ -0,0 +1,99 @@
+/* This file is part of BayseanClassifier. It classifies documents into
+    categories based on the classic Baysean classification algorithm.
+
+    Copyright (C) 2016   Ezra Erb
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License version 3 as published
+    by the Free Software Foundation.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+    I'd appreciate a note if you find this program useful or make
+    updates. Please contact me through LinkedIn (my profile also has
+    a link to the code depository)
+*/
+#include <string>
+#include <vector>
+#include <cstdio>
+#include <mutex>
+
+#include "countsSpill.h"
+#include "countsFile.h"
+#include "fileFinder.h"
+
+using namespace std;
+
+const size_t CountsSpill::MaxMergeFiles;
+
+CountsSpill::CountsSpill()
+    : _files()
+{}
+
+// Deletes the temporary files
+CountsSpill::~CountsSpill()
+{
+    vector<string>::const_iterator index;
+    for (index = _files.begin(); index != _files.end(); index++)
+        remove(index->c_str());
+}
+
+// Create a temporary file, recorded first so it gets deleted even if writing fails
+string CountsSpill::newTempFile()
+{
+    string fileName(FileFinder::createTempFile());
+    lock_guard<mutex> guard(_lock);
+    _files.push_back(fileName);
+    return fileName;
+}
+
+// Write the counts to a new temporary file and clear them
+void CountsSpill::spill(InfoByCategory& info)
+{
+    CountsFile::write(newTempFile(), info);
+    info.clear();
+}
+
+// True if nothing has been spilled
+bool CountsSpill::empty() const
+{
+    lock_guard<mutex> guard(_lock);
+    return _files.empty();
+}
+
+// Merge the spilled counts and any other counts files into one counts file
+void CountsSpill::merge(const vector<string>& otherFiles, const string& outputFile)
+{
+    vector<string> inputs(_files);
+    inputs.insert(inputs.end(), otherFiles.begin(), otherFiles.end());
+    mergeFiles(inputs, outputFile);
+}
+
+// Merge the spilled counts into the passed training data
+void CountsSpill::collect(InfoByCategory& info)
+{
+    vector<string> inputs(_files);
+    string fileName(newTempFile());
+    mergeFiles(inputs, fileName);
+    CountsFile::read(fileName, info);
+}
+
+// Merge counts files into one
+void CountsSpill::mergeFiles(vector<string>& inputs, const string& outputFile)
+{
+    // Merge large sets in groups, so the number of open files stays limited
+    while (inputs.size() > MaxMergeFiles) {
+        vector<string> group(inputs.begin(), inputs.begin() + MaxMergeFiles);
+        string fileName(newTempFile());
+        CountsFile::merge(group, fileName);
+        inputs.erase(inputs.begin(), inputs.begin() + MaxMergeFiles);
+        inputs.push_back(fileName);
+    }
+    CountsFile::merge(inputs, outputFile);
+}
@@ -0,0 +1,81 @@
+#ifndef COUNTS_SPILL_H
+#define COUNTS_SPILL_H
+
+/* This file is part of BayseanClassifier. It classifies documents into
+    categories based on the classic Baysean classification algorithm.
+
+    Copyright (C) 2016   Ezra Erb
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License version 3 as published
+    by the Free Software Foundation.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+    I'd appreciate a note if you find this program useful or make
+    updates. Please contact me through LinkedIn (my profile also has
+    a link to the code depository)
+*/
+#include <string>
+#include <vector>
+#include <mutex>
+#include "catWordDataFactory.h"
+
+using std::string;
+using std::vector;
+
+/* This class keeps training within a memory budget. When the counts held in
+    memory grow too large, they are written to a temporary counts file and
+    dropped. Since counts files are sorted, all of them are then combined by
+    the same merge used for training shards, which reads them in step, so
+    only the final result is ever held in memory.
+
+    The temporary files are deleted when the object is destroyed. Spilling
+    is safe to call from multiple threads */
+class CountsSpill
+{
+public:
+    CountsSpill();
+
+    // Deletes the temporary files
+    ~CountsSpill();
+
+    // Write the counts to a new temporary file and clear them
+    void spill(InfoByCategory& info);
+
+    // True if nothing has been spilled
+    bool empty() const;
+
+    /* Merge the spilled counts and any other counts files into one counts
+        file. The spilled counts must not change while this runs */
+    void merge(const vector<string>& otherFiles, const string& outputFile);
+
+    /* Merge the spilled counts into the passed training data, which must
+        already be empty */
+    void collect(InfoByCategory& info);
+
+private:
+    // Files open at once during a merge, kept well under the C runtime limit
+    static const size_t MaxMergeFiles = 64;
+
+    vector<string> _files;
+    mutable std::mutex _lock;
+
+    // Create a temporary file, recorded so it gets deleted
+    string newTempFile();
+
+    // Merge counts files into one. The list is used as work space
+    void mergeFiles(vector<string>& inputs, const string& outputFile);
+
+    // Make non-copyable, owns the files
+    CountsSpill(const CountsSpill& other);
+    CountsSpill& operator=(const CountsSpill& other);
+};
+
+#endif // COUNTS_SPILL_H
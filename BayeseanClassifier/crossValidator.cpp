@@ -0,0 +1,177 @@
+/* This file is part of BayseanClassifier. It classifies documents into
+    categories based on the classic Baysean classification algorithm.
+
+    Copyright (C) 2016   Ezra Erb
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License version 3 as published
+    by the Free Software Foundation.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+    I'd appreciate a note if you find this program useful or make
+    updates. Please contact me through LinkedIn (my profile also has
+    a link to the code depository)
+*/
+#include <string>
+#include <vector>
+#include <map>
+#include <set>
+#include <sstream>
+#include <ostream>
+
+#include "crossValidator.h"
+#include "catWordDataFactory.h"
+#include "classifier.h"
+#include "classifyStats.h"
+#include "documentClassifier.h"
+#include "documentPipeline.h"
+#include "fileFinder.h"
+#include "baseException.h"
+
+using namespace std;
+
+/* Keeps the word data of every document leaving the document pipeline.
+    Each document has its own slot, so threads never write the same data */
+class DocumentCollector : public DocumentSink
+{
+public:
+    explicit DocumentCollector(vector<DocumentWordMap>& documents)
+        : _documents(documents)
+        {}
+
+    virtual void process(ProcessedDocument& document, unsigned short /* threadIndex */)
+    {
+        _documents[document._index].swap(document._wordMap);
+    }
+
+private:
+    vector<DocumentWordMap>& _documents;
+};
+
+/* Train the classifiers for one fold with the passed scoring policy and
+    classify the fold's documents */
+template <class ScoringPolicy>
+static void scoreFold(const InfoByCategory& totals, double knownWordWeight,
+                      const vector<DocumentWordMap>& documents,
+                      const vector<size_t>& docCategory, const vector<unsigned short>& docFold,
+                      unsigned short fold, map<string, size_t>& categoryIds,
+                      ClassifyStats& foldStats)
+{
+    map<string, BasicClassifier<ScoringPolicy> > classifiers;
+    DocumentClassifier::buildClassifiers(totals, knownWordWeight, classifiers);
+
+    size_t index;
+    for (index = 0; index < documents.size(); index++)
+        if (docFold[index] == fold) {
+            string category(DocumentClassifier::bestCategory(classifiers, documents[index],
+                                                             false));
+            foldStats.addResult(docCategory[index], categoryIds[category]);
+        }
+}
+
+// Construct with the stopwords and pipeline setup used to process documents
+CrossValidator::CrossValidator(const Stopwords& stopwords,
+                               const PipelineSettings& pipelineSettings,
+                               DocumentCache* cache,
+                               const ScoringSettings& scoring)
+    : _docProcessor(stopwords), _pipelineSettings(pipelineSettings), _cache(cache),
+      _scoring(scoring)
+{}
+
+// Cross validate the documents in the training directories
+void CrossValidator::validate(const vector<string>& trainingDirs, unsigned short folds,
+                              ostream& output) const
+{
+    if (folds < 2) {
+        stringstream errorMessage;
+        errorMessage << "Error, cross validation needs at least two folds";
+        THROW_BASE_EXCEPTION(errorMessage.str().c_str());
+    }
+
+    // Documents are on level 2 of the training directories, as for training
+    vector<string> fileList;
+    FileFinder::findFiles(trainingDirs, fileList, 2, 2);
+    if (fileList.size() < folds) {
+        stringstream errorMessage;
+        errorMessage << "Error, " << fileList.size() << " documents found, too few for "
+                     << folds << " folds";
+        THROW_BASE_EXCEPTION(errorMessage.str().c_str());
+    }
+
+    // Number the categories in name order, matching the order of the classifiers
+    set<string> categoryNames;
+    vector<string>::const_iterator fileIndex;
+    for (fileIndex = fileList.begin(); fileIndex != fileList.end(); fileIndex++)
+        categoryNames.insert(CatWordDataFactory::getCategory(*fileIndex));
+    vector<string> categories(categoryNames.begin(), categoryNames.end());
+    map<string, size_t> categoryIds;
+    size_t index;
+    for (index = 0; index < categories.size(); index++)
+        categoryIds[categories[index]] = index;
+
+    /* Assign documents to folds round robin within each category, so each
+        fold has the same mix of categories */
+    vector<size_t> docCategory(fileList.size());
+    vector<unsigned short> docFold(fileList.size());
+    vector<unsigned long long> categorySeen(categories.size(), 0);
+    for (index = 0; index < fileList.size(); index++) {
+        docCategory[index] = categoryIds[CatWordDataFactory::getCategory(fileList[index])];
+        docFold[index] = (unsigned short)(categorySeen[docCategory[index]] % folds);
+        categorySeen[docCategory[index]]++;
+    }
+
+    // Tokenize every document once, and keep the results
+    vector<DocumentWordMap> documents(fileList.size());
+    DocumentCollector collector(documents);
+    DocumentPipeline pipeline(_docProcessor, _pipelineSettings, "Cross validation",
+                              _cache);
+    pipeline.run(fileList, collector, false);
+
+    InfoByCategory totals;
+    for (index = 0; index < documents.size(); index++)
+        totals[categories[docCategory[index]]].addDocument(documents[index]);
+
+    ClassifyStats allFolds(categories);
+    unsigned short fold;
+    for (fold = 0; fold < folds; fold++) {
+        /* Back the fold's documents out of the totals, which leaves the counts
+            for training on every other fold. They are added back afterward,
+            which saves copying the totals for every fold */
+        for (index = 0; index < documents.size(); index++)
+            if (docFold[index] == fold)
+                totals[categories[docCategory[index]]].removeDocument(documents[index]);
+
+        ClassifyStats foldStats(categories);
+        switch (_scoring._model) {
+        case ComplementScoring:
+            scoreFold<ComplementPolicy>(totals, _scoring._knownWordWeight, documents,
+                                        docCategory, docFold, fold, categoryIds, foldStats);
+            break;
+        case BernoulliScoring:
+            scoreFold<BernoulliPolicy>(totals, _scoring._knownWordWeight, documents,
+                                       docCategory, docFold, fold, categoryIds, foldStats);
+            break;
+        default:
+            scoreFold<MultinomialPolicy>(totals, _scoring._knownWordWeight, documents,
+                                         docCategory, docFold, fold, categoryIds, foldStats);
+            break;
+        }
+
+        for (index = 0; index < documents.size(); index++)
+            if (docFold[index] == fold)
+                totals[categories[docCategory[index]]].addDocument(documents[index]);
+
+        output << "Fold " << (fold + 1) << " of " << folds << ":" << endl
+               << foldStats.statsToString();
+        allFolds.merge(foldStats);
+    } // For each fold
+
+    output << "All folds:" << endl << allFolds.statsToString();
+}
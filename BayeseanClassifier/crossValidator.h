@@ -0,0 +1,77 @@
+#ifndef CROSS_VALIDATOR_H
+#define CROSS_VALIDATOR_H
+
+/* This file is part of BayseanClassifier. It classifies documents into
+    categories based on the classic Baysean classification algorithm.
+
+    Copyright (C) 2016   Ezra Erb
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License version 3 as published
+    by the Free Software Foundation.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+    I'd appreciate a note if you find this program useful or make
+    updates. Please contact me through LinkedIn (my profile also has
+    a link to the code depository)
+*/
+#include <string>
+#include <vector>
+#include <ostream>
+#include "documentWordMapFactory.h"
+#include "classifier.h"
+#include "documentPipeline.h"
+#include "documentCache.h"
+#include "stopwords.h"
+
+using std::string;
+using std::vector;
+using std::ostream;
+
+/* This class measures the accuracy of the classifier with k-fold cross
+    validation. The training documents are split into k folds. Each fold in
+    turn is classified by a model trained on all the others, and the results
+    are compared to the categories the documents are filed under.
+
+    Doing this by hand means tokenizing every document and training from
+    scratch k times. Instead, this class tokenizes every document once and
+    counts them all into one set of category totals. The model for each fold
+    is those totals with the fold's own documents subtracted, which gives
+    exactly the counts that training on the other folds would. The held out
+    documents are then scored from their saved word data.
+
+    Documents are assigned to folds round robin within each category, so
+    every fold has the same mix of categories as the whole set */
+class CrossValidator
+{
+public:
+    /* Construct with the stopwords and pipeline setup used to process
+        documents, optionally a cache of document word data, and how documents
+        are scored. Does not take ownership of the stopwords or cache */
+    CrossValidator(const Stopwords& stopwords, const PipelineSettings& pipelineSettings,
+                   DocumentCache* cache = NULL,
+                   const ScoringSettings& scoring = ScoringSettings());
+
+    // Use default destructor
+
+    /* Cross validate the documents in the training directories, which have
+        the same layout as for training. Results for each fold and for all
+        folds together are written to the output */
+    void validate(const vector<string>& trainingDirs, unsigned short folds,
+                  ostream& output) const;
+
+private:
+    const DocumentWordMapFactory _docProcessor;
+    PipelineSettings _pipelineSettings;
+    DocumentCache* _cache;
+    ScoringSettings _scoring;
+};
+
+#endif // CROSS_VALIDATOR_H
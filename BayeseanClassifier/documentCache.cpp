@@ -0,0 +1,254 @@
+/* This file is part of BayseanClassifier. It classifies documents into
+    categories based on the classic Baysean classification algorithm.
+
+    Copyright (C) 2016   Ezra Erb
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License version 3 as published
+    by the Free Software Foundation.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+    I'd appreciate a note if you find this program useful or make
+    updates. Please contact me through LinkedIn (my profile also has
+    a link to the code depository)
+*/
+#include <string>
+#include <vector>
+#include <map>
+#include <algorithm>
+#include <fstream>
+#include <sstream>
+#include <iostream>
+#include <cstdio>
+#include <mutex>
+
+#include "documentCache.h"
+#include "documentReader.h"
+#include "fileFinder.h"
+#include "varintCoding.h"
+#include "baseException.h"
+
+using namespace std;
+
+/* This class saves the word data of documents between runs, so unchanged
+    documents don't need to be read and tokenized again.
+
+    File format, with all numbers as variable length integers:
+        magic "BCDC", format version, key
+        number of words, then each word as length and letters
+        number of documents, then for each: path length and path, size,
+        modification time, content hash, length of word data, word data
+    Word data is the number of words, then for each the gap from the previous
+    word number and the count */
+
+static const char CacheMagic[] = "BCDC";
+static const unsigned long long CacheVersion = 2;
+
+static const char CacheCorrupt[] = "Error, document cache is truncated or corrupt";
+
+// Load the cache from the passed file
+DocumentCache::DocumentCache(const string& fileName)
+    : _fileName(fileName), _key(0), _modified(false), _hits(0), _misses(0)
+{
+    FileStamp stamp;
+    if (!FileFinder::getFileStamp(fileName, stamp))
+        return; // First run, nothing cached yet
+    try {
+        string data;
+        DocumentReader::readFile(fileName, data);
+        load(data);
+    }
+    catch (exception& e) {
+        // A bad cache only costs time, so carry on without it
+        cerr << "WARNING: document cache " << fileName << " ignored: " << e.what() << endl;
+        clear();
+    }
+}
+
+// Load the cache file. Throws if it is corrupt
+void DocumentCache::load(const string& data)
+{
+    if ((data.length() < 4) || (data.compare(0, 4, CacheMagic) != 0))
+        THROW_BASE_EXCEPTION("Error, file is not a document cache");
+    size_t pos = 4;
+    if (parseNumber(data, pos, CacheCorrupt) != CacheVersion)
+        THROW_BASE_EXCEPTION("Error, document cache has an unsupported format version");
+    _key = parseNumber(data, pos, CacheCorrupt);
+
+    unsigned long long wordCount = parseNumber(data, pos, CacheCorrupt);
+    // Every word takes at least one byte, so a larger count is corrupt
+    if (wordCount > data.length())
+        THROW_BASE_EXCEPTION(CacheCorrupt);
+    _words.resize((size_t)wordCount);
+    size_t index;
+    for (index = 0; index < _words.size(); index++) {
+        parseString(data, pos, _words[index], CacheCorrupt);
+        _wordNumbers[_words[index]] = (unsigned int)index;
+    }
+
+    unsigned long long entryCount = parseNumber(data, pos, CacheCorrupt);
+    string fileName;
+    unsigned long long entry;
+    for (entry = 0; entry < entryCount; entry++) {
+        parseString(data, pos, fileName, CacheCorrupt);
+        Entry& newEntry = _entries[fileName];
+        newEntry._stamp._size = parseNumber(data, pos, CacheCorrupt);
+        newEntry._stamp._modifiedTime = parseNumber(data, pos, CacheCorrupt);
+        newEntry._contentHash = parseNumber(data, pos, CacheCorrupt);
+        parseString(data, pos, newEntry._words, CacheCorrupt);
+    }
+}
+
+// Drop all entries and words
+void DocumentCache::clear()
+{
+    _entries.clear();
+    _words.clear();
+    _wordNumbers.clear();
+}
+
+// Set the key for how documents are converted to word data
+void DocumentCache::setKey(unsigned long long key)
+{
+    lock_guard<mutex> guard(_lock);
+    if (key != _key) {
+        // Everything was produced a different way, so none of it can be used
+        if (!_entries.empty())
+            clear();
+        _key = key;
+        _modified = true;
+    }
+}
+
+// Find the word data and content hash of a document
+bool DocumentCache::lookup(const string& fileName, const FileStamp& stamp,
+                           DocumentWordMap& wordMap, unsigned long long& contentHash)
+{
+    lock_guard<mutex> guard(_lock);
+    map<string, Entry>::const_iterator entry = _entries.find(fileName);
+    if ((entry == _entries.end()) || (!(entry->second._stamp == stamp))) {
+        _misses++;
+        return false;
+    }
+
+    const string& data = entry->second._words;
+    size_t pos = 0;
+    unsigned long long wordNumber = 0;
+    unsigned long long count = parseNumber(data, pos, CacheCorrupt);
+    wordMap.clear();
+    unsigned long long index;
+    for (index = 0; index < count; index++) {
+        wordNumber += parseNumber(data, pos, CacheCorrupt);
+        unsigned long long wordCount = parseNumber(data, pos, CacheCorrupt);
+        if ((wordNumber >= _words.size()) || ((unsigned int)wordCount != wordCount))
+            THROW_BASE_EXCEPTION(CacheCorrupt);
+        wordMap.addWordCount(_words[(size_t)wordNumber], (unsigned int)wordCount);
+    }
+    contentHash = entry->second._contentHash;
+    _hits++;
+    return true;
+}
+
+// Save the word data for a document
+void DocumentCache::store(const string& fileName, const FileStamp& stamp,
+                          unsigned long long contentHash, const DocumentWordMap& wordMap)
+{
+    lock_guard<mutex> guard(_lock);
+
+    // Convert the words to numbers, adding new ones to the dictionary
+    vector<pair<unsigned int, unsigned int> > numbers;
+    numbers.reserve(wordMap.size());
+    DocumentWordMap::const_iterator index;
+    for (index = wordMap.begin(); index != wordMap.end(); index++) {
+        map<string, unsigned int>::iterator number = _wordNumbers.lower_bound(index->first);
+        if ((number == _wordNumbers.end()) || (number->first != index->first)) {
+            number = _wordNumbers.insert(number, make_pair(index->first,
+                                                           (unsigned int)_words.size()));
+            _words.push_back(index->first);
+        }
+        numbers.push_back(make_pair(number->second, index->second));
+    }
+
+    // Sorting by number makes the gaps small, so they take fewer bytes
+    sort(numbers.begin(), numbers.end());
+    Entry& entry = _entries[fileName];
+    entry._stamp = stamp;
+    entry._contentHash = contentHash;
+    entry._words.clear();
+    appendNumber(entry._words, numbers.size());
+    unsigned int lastNumber = 0;
+    vector<pair<unsigned int, unsigned int> >::const_iterator numberIndex;
+    for (numberIndex = numbers.begin(); numberIndex != numbers.end(); numberIndex++) {
+        appendNumber(entry._words, numberIndex->first - lastNumber);
+        appendNumber(entry._words, numberIndex->second);
+        lastNumber = numberIndex->first;
+    }
+    _modified = true;
+}
+
+// Write the cache back to its file, if anything changed
+void DocumentCache::save()
+{
+    lock_guard<mutex> guard(_lock);
+    if (!_modified)
+        return;
+
+    string data(CacheMagic, 4);
+    appendNumber(data, CacheVersion);
+    appendNumber(data, _key);
+    appendNumber(data, _words.size());
+    vector<string>::const_iterator wordIndex;
+    for (wordIndex = _words.begin(); wordIndex != _words.end(); wordIndex++)
+        appendString(data, *wordIndex);
+    appendNumber(data, _entries.size());
+    map<string, Entry>::const_iterator entryIndex;
+    for (entryIndex = _entries.begin(); entryIndex != _entries.end(); entryIndex++) {
+        appendString(data, entryIndex->first);
+        appendNumber(data, entryIndex->second._stamp._size);
+        appendNumber(data, entryIndex->second._stamp._modifiedTime);
+        appendNumber(data, entryIndex->second._contentHash);
+        appendString(data, entryIndex->second._words);
+    }
+
+    /* Write to a new file and then replace the old one, so a failure part
+        way through never leaves a damaged cache behind */
+    string newFileName(_fileName + ".new");
+    ofstream file(newFileName.c_str(), ios_base::out | ios_base::binary | ios_base::trunc);
+    bool written = file.is_open();
+    if (written) {
+        file.write(data.data(), data.length());
+        file.close();
+        written = !file.fail();
+    }
+    // Rename will not replace an existing file on Windows, so remove it first
+    if (written)
+        remove(_fileName.c_str());
+    if ((!written) || (rename(newFileName.c_str(), _fileName.c_str()) != 0)) {
+        remove(newFileName.c_str());
+        stringstream errorMessage;
+        errorMessage << "Error, could not write document cache " << _fileName;
+        THROW_BASE_EXCEPTION(errorMessage.str().c_str());
+    }
+    _modified = false;
+}
+
+// Documents found in the cache so far
+unsigned long long DocumentCache::getHits() const
+{
+    lock_guard<mutex> guard(_lock);
+    return _hits;
+}
+
+// Documents not found in the cache so far
+unsigned long long DocumentCache::getMisses() const
+{
+    lock_guard<mutex> guard(_lock);
+    return _misses;
+}
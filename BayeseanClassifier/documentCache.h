@@ -0,0 +1,118 @@
+#ifndef DOCUMENT_CACHE_H
+#define DOCUMENT_CACHE_H
+
+/* This file is part of BayseanClassifier. It classifies documents into
+    categories based on the classic Baysean classification algorithm.
+
+    Copyright (C) 2016   Ezra Erb
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License version 3 as published
+    by the Free Software Foundation.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+    I'd appreciate a note if you find this program useful or make
+    updates. Please contact me through LinkedIn (my profile also has
+    a link to the code depository)
+*/
+#include <string>
+#include <vector>
+#include <map>
+#include <mutex>
+#include "documentWordMapFactory.h"
+#include "fileFinder.h"
+
+using std::string;
+using std::vector;
+using std::map;
+
+/* This class saves the word data of documents between runs, so documents
+    that have not changed since the last run don't need to be read and
+    tokenized again. A document is looked up by its path, and its saved data
+    is only used if its size and modification time still match.
+
+    The data also depends on the stopword list, tokenizer and stemmer. A key
+    built from them is saved with the cache, and if it no longer matches the
+    one in use, the whole cache is discarded.
+
+    Words are stored once in a dictionary and documents refer to them by
+    number. Each document stores its word numbers in order as the gap from
+    the previous one, as variable length integers, which keeps the cache
+    small enough that reading it is much cheaper than reading the documents.
+
+    All methods are safe to call from multiple threads */
+class DocumentCache
+{
+public:
+    /* Load the cache from the passed file. If it does not exist, starts
+        empty. If it can not be read, a warning is issued and it starts empty */
+    explicit DocumentCache(const string& fileName);
+
+    // Use default destructor
+
+    /* Set the key for how documents are converted to word data. If it does
+        not match the key the cache was saved with, all entries are dropped */
+    void setKey(unsigned long long key);
+
+    /* Find the word data and content hash of a document. Returns false if it
+        is not cached or has changed since it was */
+    bool lookup(const string& fileName, const FileStamp& stamp, DocumentWordMap& wordMap,
+                unsigned long long& contentHash);
+
+    /* Save the word data for a document, with the hash of its contents so
+        copies can be found without reading it again */
+    void store(const string& fileName, const FileStamp& stamp, unsigned long long contentHash,
+               const DocumentWordMap& wordMap);
+
+    /* Write the cache back to its file, if anything changed. Throws if it
+        can not be written */
+    void save();
+
+    // Documents found and not found in the cache so far
+    unsigned long long getHits() const;
+    unsigned long long getMisses() const;
+
+private:
+    struct Entry {
+        Entry() : _stamp(), _contentHash(0), _words() {}
+
+        FileStamp _stamp;
+        unsigned long long _contentHash;
+
+        // Encoded word numbers and counts
+        string _words;
+    };
+
+    string _fileName;
+    unsigned long long _key;
+    map<string, Entry> _entries;
+
+    // The word dictionary, by number and by word
+    vector<string> _words;
+    map<string, unsigned int> _wordNumbers;
+
+    bool _modified;
+    unsigned long long _hits;
+    unsigned long long _misses;
+
+    mutable std::mutex _lock;
+
+    // Load the cache file. Throws if it is corrupt
+    void load(const string& data);
+
+    // Drop all entries and words
+    void clear();
+
+    // Make non-copyable, owns the saved data
+    DocumentCache(const DocumentCache& other);
+    DocumentCache& operator=(const DocumentCache& other);
+};
+
+#endif // DOCUMENT_CACHE_H
@@ -22,145 +22,863 @@
 #include <string>
 #include <vector>
 #include <map>
+#include <set>
+#include <iterator>
 #include <iostream>
 #include <sstream>
+#include <chrono>
 
 #include "documentClassifier.h"
 #include "stopwords.h"
 #include "documentWordMapFactory.h"
 #include "catWordDataFactory.h"
 #include "classifier.h"
+#include "classifyStats.h"
 #include "baseException.h"
 #include "fileFinder.h"
+#include "countsFile.h"
+#include "documentPipeline.h"
+#include "duplicateFinder.h"
 
 using namespace std;
 
-// Construct the classifier from a set of training data directories
+/* Scores documents as they leave the document pipeline. Each score thread
+    records into its own results, which are merged at the end, so no locking
+    is needed. Copies of documents are not scored; they get the category of
+    the first copy when the results are merged */
+class ClassifySink : public DocumentSink
+{
+public:
+    ClassifySink(const DocumentClassifier& classifier, unsigned short threadCount)
+        : _classifier(classifier), _threadResults(threadCount > 0 ? threadCount : 1),
+          _duplicates()
+        {}
+
+    virtual void process(ProcessedDocument& document, unsigned short threadIndex)
+    {
+        document._category = _classifier.classifyDocumentId(document);
+        _threadResults[threadIndex].insert(
+            make_pair(document._fileName, _classifier.getCategories()[document._category]));
+    }
+
+    virtual bool isDuplicate(const string& /* fileName */, size_t position,
+                             unsigned long long contentHash)
+    {
+        size_t original;
+        return _duplicates.add(string(), contentHash, position, original);
+    }
+
+    /* Merge the results of all threads into the passed map. The file list
+        is the one the pipeline was run on */
+    void getResults(const vector<string>& fileList, DocClassifyMap& results) const
+    {
+        vector<DocClassifyMap>::const_iterator index;
+        for (index = _threadResults.begin(); index != _threadResults.end(); index++)
+            results.insert(index->begin(), index->end());
+
+        // The first copy of a document is never itself a copy, so was scored
+        vector<pair<size_t, size_t> > duplicates(_duplicates.getDuplicates());
+        vector<pair<size_t, size_t> >::const_iterator duplicateIndex;
+        for (duplicateIndex = duplicates.begin(); duplicateIndex != duplicates.end();
+             duplicateIndex++)
+            results[fileList[duplicateIndex->first]] = results[fileList[duplicateIndex->second]];
+    }
+
+private:
+    const DocumentClassifier& _classifier;
+    vector<DocClassifyMap> _threadResults;
+
+    // Documents seen so far, to find copies
+    DuplicateFinder _duplicates;
+};
+
+/* Scores documents with known categories as they leave the document pipeline.
+    Results are recorded by category ID, so no strings are compared. Each
+    score thread records into its own statistics, which are merged at the end */
+class EvaluateSink : public DocumentSink
+{
+public:
+    /* The expected category ID of each document, by its position in the file
+        list, and the statistics ID of each classifier category */
+    EvaluateSink(const DocumentClassifier& classifier, const vector<size_t>& docCategory,
+                 const vector<size_t>& classifierIds, const vector<string>& categories,
+                 unsigned short threadCount)
+        : _classifier(classifier), _docCategory(docCategory), _classifierIds(classifierIds),
+          _threadStats(threadCount > 0 ? threadCount : 1, ClassifyStats(categories))
+        {}
+
+    virtual void process(ProcessedDocument& document, unsigned short threadIndex)
+    {
+        document._category = _classifier.classifyDocumentId(document);
+        _threadStats[threadIndex].addResult(_docCategory[document._index],
+                                            _classifierIds[document._category]);
+    }
+
+    // Merge the statistics of all threads into the passed statistics
+    void getResults(ClassifyStats& stats) const
+    {
+        vector<ClassifyStats>::const_iterator index;
+        for (index = _threadStats.begin(); index != _threadStats.end(); index++)
+            stats.merge(*index);
+    }
+
+private:
+    const DocumentClassifier& _classifier;
+    const vector<size_t>& _docCategory;
+    const vector<size_t>& _classifierIds;
+    vector<ClassifyStats> _threadStats;
+};
+
+/* Check that training data has documents for at least two categories, and
+    return the total document count. Works for exact or approximate data */
+template <class CategoryData>
+static unsigned long long checkCategories(const map<string, CategoryData>& trainingData)
+{
+    /* A category with no documents can't be chosen, and would make the
+        document probability infinite, so leave it out */
+    typename map<string, CategoryData>::const_iterator trainIndex;
+    typename map<string, CategoryData>::const_iterator usedCategory = trainingData.end();
+    size_t categoryCount = 0;
+    for (trainIndex = trainingData.begin(); trainIndex != trainingData.end(); trainIndex++)
+        if (trainIndex->second.getDocCount() > 0) {
+            categoryCount++;
+            usedCategory = trainIndex;
+        }
+
+    /* At least two categories must be found in the training data or
+        classification is not possible */
+    if (categoryCount < 1) {
+        stringstream errorMessage;
+        errorMessage << "Error, no training data found in specified directories";
+        THROW_BASE_EXCEPTION(errorMessage.str().c_str());
+    }
+    else if (categoryCount < 2) {
+        stringstream errorMessage;
+        errorMessage << "Error, training data found only for categoy " << usedCategory->first;
+        THROW_BASE_EXCEPTION(errorMessage.str().c_str());
+    }
+
+    // Need the total document count
+    unsigned long long totalDocCount = 0;
+    for (trainIndex = trainingData.begin(); trainIndex != trainingData.end(); trainIndex++)
+        addCountChecked(totalDocCount, trainIndex->second.getDocCount());
+    return totalDocCount;
+}
+
+/* Construct the classifier from a set of training data directories and
+    counts files written by training elsewhere */
 DocumentClassifier::DocumentClassifier(const vector<string>& trainingDirs,
+                                       const vector<string>& trainingCounts,
                                        const string& stopwordsFile,
-                                       bool traceInfo)
-    : _stopwords(stopwordsFile), _wordDataFactory(_stopwords), _traceInfo(traceInfo)
+                                       bool traceInfo,
+                                       const PipelineSettings& pipelineSettings,
+                                       DocumentCache* cache,
+                                       const ScoringSettings& scoring)
+    : _stopwords(stopwordsFile), _scoring(scoring), _wordDataFactory(_stopwords),
+      _traceInfo(traceInfo), _pipelineSettings(pipelineSettings), _cache(cache),
+      _sketchScored(0), _sketchUncertain(0),
+      _sketchLikelyChanged(0)
 {
     try {
-        CatWordDataFactory trainingDataSource(_stopwords, _traceInfo);
-        InfoByCategory trainingData;
-        trainingDataSource.generateInfo(trainingDirs, trainingData);
-
-        /* At least two categories must be found in the training data or
-            classification is not possible */
-        if (trainingData.size() < 1) {
-            stringstream errorMessage;
-            errorMessage << "Error, no training data found in specified directories";
-            THROW_BASE_EXCEPTION(errorMessage.str().c_str());
+        if (_scoring._bigramMinCount > 0) {
+            if ((_scoring._model != MultinomialScoring) || (_scoring._sketch._heavyHitters > 0) ||
+                (_scoring._hashBits > 0)) {
+                stringstream errorMessage;
+                errorMessage << "Error, word pairs only support multinomial scoring of exact counts";
+                THROW_BASE_EXCEPTION(errorMessage.str().c_str());
+            }
+            // Both training and classification need the pairs of each document
+            _pipelineSettings._bigramMinCount = _scoring._bigramMinCount;
+        }
+        CatWordDataFactory trainingDataSource(_stopwords, _traceInfo, _pipelineSettings, _cache);
+        if (_scoring._sketch._heavyHitters > 0) {
+            buildSketchClassifiers(trainingDataSource, trainingDirs, trainingCounts);
+            return;
         }
-        else if (trainingData.size() < 2) {
-            stringstream errorMessage;
-            errorMessage << "Error, training data found only for categoy " << trainingData.begin()->first;
-            THROW_BASE_EXCEPTION(errorMessage.str().c_str());
+        if (_scoring._hashBits > 0) {
+            buildHashedClassifiers(trainingDataSource, trainingDirs, trainingCounts);
+            return;
         }
 
-        // Need the total document count
-        InfoByCategory::const_iterator trainIndex;
-        unsigned short totalDocCount = 0;
-        for (trainIndex = trainingData.begin(); trainIndex != trainingData.end(); trainIndex++)
-            totalDocCount += trainIndex->second.getDocCount();
+        InfoByCategory trainingData;
+        if (!trainingDirs.empty())
+            trainingDataSource.generateInfo(trainingDirs, trainingData);
+        vector<string>::const_iterator countsIndex;
+        for (countsIndex = trainingCounts.begin(); countsIndex != trainingCounts.end();
+             countsIndex++)
+            CountsFile::read(*countsIndex, trainingData);
+        if (_scoring._bigramMinCount > 0)
+            buildBigramClassifiers(trainingData);
 
-        /* For each category, create a classifier from the training document data
-            for each category. Need to do after all are read in because the total
-            documents read affects the classification
-            NOTE: A known word weight of 1 works well for medium sized documents and above */
-        for (trainIndex = trainingData.begin(); trainIndex != trainingData.end(); trainIndex++)
-            _classifiers.insert(make_pair(trainIndex->first,
-                                          Classifier(trainIndex->second, totalDocCount, 1.0)));
+        switch (_scoring._model) {
+        case ComplementScoring:
+            buildClassifiers(trainingData, _scoring._knownWordWeight, _complementClassifiers);
+            if (_traceInfo)
+                traceClassifiers(_complementClassifiers);
+            break;
+        case BernoulliScoring:
+            buildClassifiers(trainingData, _scoring._knownWordWeight, _bernoulliClassifiers);
+            if (_traceInfo)
+                traceClassifiers(_bernoulliClassifiers);
+            break;
+        default:
+            buildClassifiers(trainingData, _scoring._knownWordWeight, _classifiers);
+            if (_traceInfo)
+                traceClassifiers(_classifiers);
+            break;
+        }
 
-        CategoryClassifiers::const_iterator classifierIndex;
-        if (_traceInfo) {
-            cout << "Classifiers:" << endl;
-            for (classifierIndex = _classifiers.begin(); classifierIndex != _classifiers.end();
-                 classifierIndex++)
-                cout << classifierIndex->first << ": " << classifierIndex->second.classifierToString() << endl;
-        } // _traceInfo
+        // Every policy skips the same categories, so any set gives the names
+        InfoByCategory::const_iterator trainIndex;
+        for (trainIndex = trainingData.begin(); trainIndex != trainingData.end(); trainIndex++)
+            if (trainIndex->second.getDocCount() > 0)
+                _categories.push_back(trainIndex->first);
     }
     catch (...) {
         // Ensure consistent state on exception
         _classifiers.clear();
+        _complementClassifiers.clear();
+        _bernoulliClassifiers.clear();
+        _sketchClassifiers.clear();
+        _hashedClassifiers.clear();
+        _bigramClassifiers.clear();
+        _bigramVocabulary.clear();
+        _categories.clear();
         throw;
     }
 }
 
+// Construct the classifier from a model file written by writeHashedModel()
+DocumentClassifier::DocumentClassifier(const string& hashedModelFile, const string& stopwordsFile,
+                                       const PipelineSettings& pipelineSettings,
+                                       const ScoringSettings& scoring)
+    : _stopwords(stopwordsFile), _hashedModel(new HashedModelFile(hashedModelFile)),
+      _scoring(scoring), _wordDataFactory(_stopwords), _traceInfo(false),
+      _pipelineSettings(pipelineSettings), _cache(NULL), _sketchScored(0), _sketchUncertain(0),
+      _sketchLikelyChanged(0)
+{
+    // Words are hashed into buckets when classified, so the count must match
+    if ((_scoring._hashBits == 0) ||
+        (((size_t)1 << _scoring._hashBits) != _hashedModel->getBucketCount())) {
+        stringstream errorMessage;
+        errorMessage << "Error, model file " << hashedModelFile << " has "
+                     << _hashedModel->getBucketCount() << " buckets, which does not match the"
+                     << " hashed words to classify";
+        THROW_BASE_EXCEPTION(errorMessage.str().c_str());
+    }
+    _hashedModel->getClassifiers(_hashedClassifiers);
+    HashedClassifiers::const_iterator index;
+    for (index = _hashedClassifiers.begin(); index != _hashedClassifiers.end(); index++)
+        _categories.push_back(index->first);
+}
+
+// Write the classifiers to a model file
+void DocumentClassifier::writeHashedModel(const string& fileName) const
+{
+    if (_hashedClassifiers.empty()) {
+        stringstream errorMessage;
+        errorMessage << "Error, only classifiers trained with hashed words can be written to a"
+                     << " model file";
+        THROW_BASE_EXCEPTION(errorMessage.str().c_str());
+    }
+    HashedModelFile::write(fileName, _hashedClassifiers);
+}
+
+// Train with approximate word counts and create a classifier for each category
+void DocumentClassifier::buildSketchClassifiers(const CatWordDataFactory& trainingDataSource,
+                                                const vector<string>& trainingDirs,
+                                                const vector<string>& trainingCounts)
+{
+    if (_scoring._model != MultinomialScoring) {
+        stringstream errorMessage;
+        errorMessage << "Error, approximate training only supports multinomial scoring";
+        THROW_BASE_EXCEPTION(errorMessage.str().c_str());
+    }
+
+    SketchesByCategory sketches;
+    if (!trainingDirs.empty())
+        trainingDataSource.generateSketches(trainingDirs, _scoring._sketch, sketches);
+    vector<string>::const_iterator countsIndex;
+    for (countsIndex = trainingCounts.begin(); countsIndex != trainingCounts.end(); countsIndex++)
+        CountsFile::read(*countsIndex, _scoring._sketch, sketches);
+
+    unsigned long long totalDocCount = checkCategories(sketches);
+    ostringstream summary;
+    SketchesByCategory::const_iterator trainIndex;
+    for (trainIndex = sketches.begin(); trainIndex != sketches.end(); trainIndex++)
+        if (trainIndex->second.getDocCount() > 0) {
+            _sketchClassifiers.insert(make_pair(trainIndex->first,
+                                                SketchClassifier(trainIndex->second, totalDocCount,
+                                                                 _scoring._knownWordWeight)));
+            _categories.push_back(trainIndex->first);
+
+            const CountMinSketch& sketch = trainIndex->second.getSketch();
+            summary << trainIndex->first << ": Total words: "
+                    << trainIndex->second.getTotalWordCount() << " Exact words: "
+                    << trainIndex->second.getHeavyHitters().size() << " Sketch: "
+                    << sketch.getWidth() << "x" << sketch.getDepth()
+                    << " Estimates at most " << sketch.getErrorBound()
+                    << " too high with probability " << (1.0 - _scoring._sketch._failureRate)
+                    << endl;
+        }
+    _sketchSummary = summary.str();
+    if (_traceInfo)
+        traceClassifiers(_sketchClassifiers);
+}
+
+// Train with hashed words and create a classifier for each category
+void DocumentClassifier::buildHashedClassifiers(const CatWordDataFactory& trainingDataSource,
+                                                const vector<string>& trainingDirs,
+                                                const vector<string>& trainingCounts)
+{
+    if (_scoring._model != MultinomialScoring) {
+        stringstream errorMessage;
+        errorMessage << "Error, hashed words only support multinomial scoring";
+        THROW_BASE_EXCEPTION(errorMessage.str().c_str());
+    }
+    if (_scoring._sketch._heavyHitters > 0) {
+        stringstream errorMessage;
+        errorMessage << "Error, hashed words can not be combined with approximate training";
+        THROW_BASE_EXCEPTION(errorMessage.str().c_str());
+    }
+
+    HashedByCategory hashed;
+    if (!trainingDirs.empty())
+        trainingDataSource.generateHashed(trainingDirs, _scoring._hashBits, hashed);
+    vector<string>::const_iterator countsIndex;
+    for (countsIndex = trainingCounts.begin(); countsIndex != trainingCounts.end(); countsIndex++)
+        CountsFile::read(*countsIndex, _scoring._hashBits, hashed);
+
+    unsigned long long totalDocCount = checkCategories(hashed);
+    HashedByCategory::const_iterator trainIndex;
+    for (trainIndex = hashed.begin(); trainIndex != hashed.end(); trainIndex++)
+        if (trainIndex->second.getDocCount() > 0) {
+            _hashedClassifiers.insert(make_pair(trainIndex->first,
+                                                HashedClassifier(trainIndex->second, totalDocCount,
+                                                                 _scoring._knownWordWeight)));
+            _categories.push_back(trainIndex->first);
+        }
+    if (_traceInfo)
+        traceClassifiers(_hashedClassifiers);
+}
+
+/* Create the pair scores for each category in a set of training data. Rare
+    pairs are removed from the data first, so the model stays bounded */
+void DocumentClassifier::buildBigramClassifiers(InfoByCategory& trainingData)
+{
+    CatWordDataFactory::pruneBigrams(trainingData, _scoring._bigramMinCount, _bigramVocabulary);
+    InfoByCategory::const_iterator trainIndex;
+    for (trainIndex = trainingData.begin(); trainIndex != trainingData.end(); trainIndex++)
+        if (trainIndex->second.getDocCount() > 0)
+            _bigramClassifiers.insert(make_pair(trainIndex->first,
+                                                BigramClassifier(trainIndex->second,
+                                                                 _bigramVocabulary.size(),
+                                                                 _scoring._knownWordWeight)));
+    if (_traceInfo)
+        traceClassifiers(_bigramClassifiers);
+}
+
+// Copy the pairs of a document that were kept in training
+void DocumentClassifier::getKnownBigrams(const DocumentBigrams& bigrams,
+                                         DocumentBigrams& known) const
+{
+    // Pairs not kept in training would score the same for every category
+    known.clear();
+    DocumentBigrams::const_iterator pairIndex;
+    for (pairIndex = bigrams.begin(); pairIndex != bigrams.end(); pairIndex++)
+        if (_bigramVocabulary.find(pairIndex->first) != NULL)
+            known.addCount(pairIndex->first, pairIndex->second);
+}
+
+/* Return the position of the category for a document, scored with both its
+    words and its pairs of neighbouring words */
+size_t DocumentClassifier::bigramCategoryId(const ProcessedDocument& document) const
+{
+    DocumentBigrams known;
+    getKnownBigrams(document._bigrams, known);
+
+    // Both sets of classifiers hold the same categories, so step through them together
+    CategoryClassifiers::const_iterator index = _classifiers.begin();
+    BigramClassifiers::const_iterator bigramIndex = _bigramClassifiers.begin();
+    size_t category = 0;
+    size_t position = 0;
+    double logProbability = 0.0;
+    while (index != _classifiers.end()) {
+        double newProbability = index->second.getCategoryProbability(document._wordMap) +
+            bigramIndex->second.getBigramProbability(known);
+        if (_traceInfo)
+            cout << "Category: " << index->first << " Log probability: " << newProbability << '\n';
+        if ((position == 0) || (newProbability > logProbability)) {
+            logProbability = newProbability;
+            category = position;
+        }
+        index++;
+        bigramIndex++;
+        position++;
+    } // While loop
+    return category;
+}
+
+/* Return the position of the category for a document, scored with
+    approximate counts. Records whether exact counts could have chosen a
+    different category, and whether they likely would have */
+size_t DocumentClassifier::sketchCategoryId(const DocumentWordMap& wordMap) const
+{
+    /* The estimated score of every category is never too low. If the lowest
+        the winner could really score is beaten by the estimate of any other
+        category, that one might have won with exact counts. Lowering every
+        estimate by its expected error instead gives the likely winner */
+    SketchClassifiers::const_iterator index;
+    size_t category = 0;
+    size_t position = 0;
+    double logProbability = 0.0;
+    double lowest = 0.0;
+    double runnerUp = 0.0;
+    size_t likelyCategory = 0;
+    double likelyProbability = 0.0;
+    for (index = _sketchClassifiers.begin(); index != _sketchClassifiers.end();
+         index++, position++) {
+        double newLowest, newCorrected;
+        double newProbability = index->second.getCategoryProbability(wordMap, newLowest,
+                                                                     newCorrected);
+        if ((position == 0) || (newCorrected > likelyProbability)) {
+            likelyProbability = newCorrected;
+            likelyCategory = position;
+        }
+        if (_traceInfo)
+            cout << "Category: " << index->first << " Log probability: " << newProbability
+                 << " Lowest: " << newLowest << '\n';
+        if (position == 0) {
+            logProbability = newProbability;
+            lowest = newLowest;
+        }
+        else if (newProbability > logProbability) {
+            runnerUp = logProbability;
+            logProbability = newProbability;
+            lowest = newLowest;
+            category = position;
+        }
+        else if ((position == 1) || (newProbability > runnerUp))
+            runnerUp = newProbability;
+    }
+
+    _sketchScored++;
+    if (runnerUp >= lowest)
+        _sketchUncertain++;
+    if (likelyCategory != category)
+        _sketchLikelyChanged++;
+    return category;
+}
+
+/* Return a description of the approximate training data, and of how many
+    documents were likely, and at worst could have been, classified
+    differently with exact counts.
+    Empty if training was exact */
+string DocumentClassifier::sketchStatsToString() const
+{
+    if (_sketchClassifiers.empty())
+        return string();
+    ostringstream buffer;
+    buffer << "Approximate training:" << endl << _sketchSummary;
+    unsigned long long scored = _sketchScored;
+    unsigned long long uncertain = _sketchUncertain;
+    unsigned long long likelyChanged = _sketchLikelyChanged;
+    buffer << "Documents that exact counts likely classify differently: " << likelyChanged
+           << " of " << scored;
+    if (scored > 0)
+        buffer << " (" << (100.0 * (double)likelyChanged / (double)scored) << "%)";
+    buffer << endl << "Worst case, if every estimate is as far off as the sketch allows: "
+           << uncertain << " of " << scored << endl;
+    return buffer.str();
+}
+
+// Trace the data of every classifier
+template <class CategoryClassifier>
+void DocumentClassifier::traceClassifiers(const map<string, CategoryClassifier>& classifiers)
+{
+    typename map<string, CategoryClassifier>::const_iterator classifierIndex;
+    cout << "Classifiers:" << '\n';
+    for (classifierIndex = classifiers.begin(); classifierIndex != classifiers.end();
+         classifierIndex++)
+        cout << classifierIndex->first << ": " << classifierIndex->second.classifierToString() << '\n';
+}
+
 // Classify documents in a set of files or directories
 void DocumentClassifier::classify(const vector<string>& classifyList, DocClassifyMap& results) const
 {
-    if (_classifiers.empty()) {
+    if (_categories.empty()) {
         // Serious problem. Construction failed and exception not handled
         stringstream errorMessage;
         errorMessage << "Internal error: attempt to classify documents with invalid classifier";
         THROW_BASE_EXCEPTION(errorMessage.str().c_str());
     }
     results.clear();
+    vector<string> fileList;
     vector<string>::const_iterator index;
     for (index = classifyList.begin(); index != classifyList.end(); index++)
-        classifyDirs(*index, results);
+        findDocuments(*index, fileList);
+    classifyFiles(fileList, results);
 }
 
 // Classify documents in a file or directory
 void DocumentClassifier::classify(const string& classifyDir, DocClassifyMap& results) const
 {
-    if (_classifiers.empty()) {
+    if (_categories.empty()) {
         // Serious problem. Construction failed and exception not handled
         stringstream errorMessage;
         errorMessage << "Internal error: attempt to classify documents with invalid classifier";
         THROW_BASE_EXCEPTION(errorMessage.str().c_str());
     }
     results.clear();
-    classifyDirs(classifyDir, results);
+    vector<string> fileList;
+    findDocuments(classifyDir, fileList);
+    classifyFiles(fileList, results);
 }
 
-// Classify a single document or directory of documents
-void DocumentClassifier::classifyDirs(const string& dirName, DocClassifyMap& results) const
+// Find the documents to classify in a directory tree
+void DocumentClassifier::findDocuments(const string& dirName, vector<string>& fileList) const
 {
-    vector<string> fileList;
+    size_t startSize = fileList.size();
     // Fetch all files in the directoy tree
     FileFinder::findFiles(dirName, fileList);
 
-    if (fileList.empty()) {
+    if (fileList.size() == startSize) {
         stringstream errorMessage;
         errorMessage << "ERROR, directory or file to classify " << dirName << " contains no files";
         THROW_BASE_EXCEPTION(errorMessage.str().c_str());
     }
-    vector<string>::const_iterator index;
-    for (index = fileList.begin(); index != fileList.end(); index++)
-        classifyFile(*index, results);
 }
 
-// Classify a single document
-void DocumentClassifier::classifyFile(const string& fileName, DocClassifyMap& results) const
+// Classify a list of documents
+void DocumentClassifier::classifyFiles(const vector<string>& fileList,
+                                       DocClassifyMap& results) const
+{
+    /* Run the files through the document pipeline. Tracing needs the documents
+        in order so the output for each one is together */
+    ClassifySink sink(*this, _pipelineSettings._scoreThreads);
+    DocumentPipeline pipeline(_wordDataFactory, _pipelineSettings, "Classification", _cache);
+    pipeline.run(fileList, sink, _traceInfo);
+    sink.getResults(fileList, results);
+}
+
+/* Classify the documents in directory trees organized by category, and
+    record how many went to the right category */
+void DocumentClassifier::evaluate(const vector<string>& labelledDirs, ClassifyStats& stats) const
+{
+    if (_categories.empty()) {
+        // Serious problem. Construction failed and exception not handled
+        stringstream errorMessage;
+        errorMessage << "Internal error: attempt to classify documents with invalid classifier";
+        THROW_BASE_EXCEPTION(errorMessage.str().c_str());
+    }
+
+    // Documents are on level 2 of the directories, as for training
+    vector<string> fileList;
+    FileFinder::findFiles(labelledDirs, fileList, 2, 2);
+    if (fileList.empty()) {
+        stringstream errorMessage;
+        errorMessage << "ERROR: evaluation directories contained no files in category directories";
+        THROW_BASE_EXCEPTION(errorMessage.str().c_str());
+    }
+
+    // Number the expected categories in name order
+    set<string> categoryNames;
+    vector<string>::const_iterator fileIndex;
+    for (fileIndex = fileList.begin(); fileIndex != fileList.end(); fileIndex++)
+        categoryNames.insert(CatWordDataFactory::getCategory(*fileIndex));
+    vector<string> categories(categoryNames.begin(), categoryNames.end());
+    map<string, size_t> categoryIds;
+    size_t index;
+    for (index = 0; index < categories.size(); index++)
+        categoryIds[categories[index]] = index;
+
+    vector<size_t> docCategory(fileList.size());
+    for (index = 0; index < fileList.size(); index++)
+        docCategory[index] = categoryIds[CatWordDataFactory::getCategory(fileList[index])];
+
+    /* Translate each classifier category to its ID. Categories with no
+        documents to evaluate can still be chosen by mistake */
+    vector<size_t> classifierIds;
+    vector<string>::const_iterator classifierIndex;
+    for (classifierIndex = _categories.begin(); classifierIndex != _categories.end();
+         classifierIndex++) {
+        map<string, size_t>::const_iterator id = categoryIds.find(*classifierIndex);
+        classifierIds.push_back(id != categoryIds.end() ? id->second : ClassifyStats::OtherCategory);
+    }
+
+    EvaluateSink sink(*this, docCategory, classifierIds, categories,
+                      _pipelineSettings._scoreThreads);
+    DocumentPipeline pipeline(_wordDataFactory, _pipelineSettings, "Evaluation", _cache);
+    pipeline.run(fileList, sink, _traceInfo);
+    stats = ClassifyStats(categories);
+    sink.getResults(stats);
+}
+
+// Return the category for a document already converted to word data
+string DocumentClassifier::classifyDocument(const ProcessedDocument& document) const
+{
+    return _categories[classifyDocumentId(document)];
+}
+
+/* Return the position of the category for a document already converted
+    to word data, in category name order */
+size_t DocumentClassifier::classifyDocumentId(const ProcessedDocument& document) const
 {
+    if (_pipelineSettings._metrics != NULL)
+        _pipelineSettings._metrics->addUnknownWords(countUnknownWords(document._wordMap));
     if (_traceInfo)
-        cout << "File to classify: " << fileName << endl;
+        cout << "File to classify: " << document._fileName << '\n';
+    if (!_sketchClassifiers.empty())
+        return sketchCategoryId(document._wordMap);
+    if (!_bigramClassifiers.empty())
+        return bigramCategoryId(document);
+    if (!_hashedClassifiers.empty())
+        return bestCategoryId(_hashedClassifiers, document._wordMap, _traceInfo);
+    switch (_scoring._model) {
+    case ComplementScoring:
+        return bestCategoryId(_complementClassifiers, document._wordMap, _traceInfo);
+    case BernoulliScoring:
+        return bestCategoryId(_bernoulliClassifiers, document._wordMap, _traceInfo);
+    default:
+        return bestCategoryId(_classifiers, document._wordMap, _traceInfo);
+    }
+}
+
+// Score a document with every classifier in a set, in category name order
+template <class CategoryClassifier>
+static void scoreCategories(const map<string, CategoryClassifier>& classifiers,
+                            const DocumentWordTable& words, vector<double>& scores)
+{
+    scores.clear();
+    scores.reserve(classifiers.size());
+    typename map<string, CategoryClassifier>::const_iterator index;
+    for (index = classifiers.begin(); index != classifiers.end(); index++)
+        scores.push_back(index->second.getCategoryProbability(words));
+}
+
+/* Classify a document already read into memory, and return the position of
+    its category in category name order. Only the context is written to */
+size_t DocumentClassifier::classifyBuffer(const char* data, size_t length,
+                                          ClassifyContext& context) const
+{
+    // Converted the same way as documents read from files
+    chrono::steady_clock::time_point start = chrono::steady_clock::now();
+    context._words.clear();
+    context._bigrams.clear();
+    _wordDataFactory.getTokens(data, length, context._tokens, context._scanner);
+    chrono::steady_clock::time_point tokenized = chrono::steady_clock::now();
+    DocumentWordMapFactory::addStems(context._tokens, context._words, context._syllables);
+    if (_pipelineSettings._bigramMinCount > 0)
+        DocumentWordMapFactory::addBigrams(context._tokens, context._bigrams);
+    chrono::steady_clock::time_point stemmed = chrono::steady_clock::now();
+
+    scoreDocument(context._words, context._bigrams, context._knownBigrams, context._scores);
+
+    ClassifyMetrics* metrics = _pipelineSettings._metrics;
+    if (metrics != NULL) {
+        chrono::steady_clock::time_point scored = chrono::steady_clock::now();
+        metrics->addStageTime(ClassifyMetrics::TokenizeStage,
+                              chrono::duration<double>(tokenized - start).count());
+        metrics->addStageTime(ClassifyMetrics::StemStage,
+                              chrono::duration<double>(stemmed - tokenized).count());
+        metrics->addStageTime(ClassifyMetrics::ScoreStage,
+                              chrono::duration<double>(scored - stemmed).count());
+        metrics->addDocument(chrono::duration<double>(scored - start).count(),
+                             context._tokens.size());
+        metrics->addUnknownWords(countUnknownWords(context._words));
+    }
+
+    // Same as classifying files: the first of any equal scores wins
+    size_t best = 0;
+    size_t index;
+    for (index = 1; index < context._scores.size(); index++)
+        if (context._scores[index] > context._scores[best])
+            best = index;
+    return best;
+}
+
+/* Find the scaled log probability of a document already converted to word
+    data for every category, in category name order */
+void DocumentClassifier::scoreDocument(const DocumentWordTable& words,
+                                       const DocumentBigrams& bigrams, DocumentBigrams& known,
+                                       vector<double>& scores) const
+{
+    if (!_sketchClassifiers.empty())
+        scoreCategories(_sketchClassifiers, words, scores);
+    else if (!_bigramClassifiers.empty()) {
+        scoreCategories(_classifiers, words, scores);
+        getKnownBigrams(bigrams, known);
+        BigramClassifiers::const_iterator index;
+        size_t position = 0;
+        for (index = _bigramClassifiers.begin(); index != _bigramClassifiers.end(); index++) {
+            scores[position] += index->second.getBigramProbability(known);
+            position++;
+        }
+    }
+    else if (!_hashedClassifiers.empty())
+        scoreCategories(_hashedClassifiers, words, scores);
+    else
+        switch (_scoring._model) {
+        case ComplementScoring:
+            scoreCategories(_complementClassifiers, words, scores);
+            break;
+        case BernoulliScoring:
+            scoreCategories(_bernoulliClassifiers, words, scores);
+            break;
+        default:
+            scoreCategories(_classifiers, words, scores);
+            break;
+        }
+}
+
+// Names of the categories, in category name order
+const vector<string>& DocumentClassifier::getCategories() const
+{
+    return _categories;
+}
+
+// Record latencies and counts of every document classified from now on
+void DocumentClassifier::setMetrics(ClassifyMetrics* metrics)
+{
+    _pipelineSettings._metrics = metrics;
+}
+
+// Count the words of a document that no classifier in a set has a probability for
+template <class CategoryClassifier, class Document>
+static unsigned long long countUnknown(const map<string, CategoryClassifier>& classifiers,
+                                       const Document& document)
+{
+    unsigned long long unknownWords = 0;
+    typename Document::const_iterator wordIndex;
+    for (wordIndex = document.begin(); wordIndex != document.end(); wordIndex++) {
+        typename map<string, CategoryClassifier>::const_iterator index;
+        for (index = classifiers.begin(); index != classifiers.end(); index++)
+            if (index->second.isKnownWord(wordIndex->first))
+                break;
+        if (index == classifiers.end())
+            unknownWords += wordIndex->second;
+    }
+    return unknownWords;
+}
 
-    // Convert the file to word statistics
-    DocumentWordMap wordMap;
-    _wordDataFactory.getWordMap(fileName, wordMap);
+// Count the words of a document held either as a map or as a table
+template <class Document>
+unsigned long long DocumentClassifier::countUnknownDocumentWords(const Document& document) const
+{
+    if ((!_sketchClassifiers.empty()) || (!_hashedClassifiers.empty()))
+        return 0;
+    switch (_scoring._model) {
+    case ComplementScoring:
+        return countUnknown(_complementClassifiers, document);
+    case BernoulliScoring:
+        return countUnknown(_bernoulliClassifiers, document);
+    default:
+        // Also the single words of bigram scoring
+        return countUnknown(_classifiers, document);
+    }
+}
+
+// Return how many of the words of a document no category saw in training
+unsigned long long DocumentClassifier::countUnknownWords(const DocumentWordMap& wordMap) const
+{
+    return countUnknownDocumentWords(wordMap);
+}
+
+// As above, for a document counted into a reusable table
+unsigned long long DocumentClassifier::countUnknownWords(const DocumentWordTable& wordTable) const
+{
+    return countUnknownDocumentWords(wordTable);
+}
+
+// Create a classifier for each category in a set of training data
+template <class ScoringPolicy>
+void DocumentClassifier::buildClassifiers(const InfoByCategory& trainingData,
+                                          double knownWordWeight,
+                                          map<string, BasicClassifier<ScoringPolicy> >& classifiers)
+{
+    classifiers.clear();
+    unsigned long long totalDocCount = checkCategories(trainingData);
+    InfoByCategory::const_iterator trainIndex;
+
+    // Some policies need the word counts over all categories
+    CatWordData allCategories;
+    if (ScoringPolicy::NeedsAllCategories)
+        for (trainIndex = trainingData.begin(); trainIndex != trainingData.end(); trainIndex++)
+            allCategories.mergeData(trainIndex->second);
+
+    /* For each category, create a classifier from the training document data
+        for each category. Need to do after all are read in because the total
+        documents read affects the classification */
+    for (trainIndex = trainingData.begin(); trainIndex != trainingData.end(); trainIndex++)
+        if (trainIndex->second.getDocCount() > 0)
+            classifiers.insert(make_pair(trainIndex->first,
+                                         BasicClassifier<ScoringPolicy>(trainIndex->second,
+                                                                        allCategories,
+                                                                        totalDocCount,
+                                                                        knownWordWeight)));
+}
+
+// Return the category whose classifier gives a document the highest score
+template <class CategoryClassifier>
+string DocumentClassifier::bestCategory(const map<string, CategoryClassifier>& classifiers,
+                                        const DocumentWordMap& wordMap, bool traceInfo)
+{
+    typename map<string, CategoryClassifier>::const_iterator index = classifiers.begin();
+    advance(index, bestCategoryId(classifiers, wordMap, traceInfo));
+    return index->first;
+}
 
+/* Return the position in the classifiers of the category whose classifier
+    gives a document the highest score */
+template <class CategoryClassifier>
+size_t DocumentClassifier::bestCategoryId(const map<string, CategoryClassifier>& classifiers,
+                                          const DocumentWordMap& wordMap, bool traceInfo)
+{
     /* Iterate through the classifiers and score the file with each.
         Highest score indicates highest probability, so it wins */
-    CategoryClassifiers::const_iterator index = _classifiers.begin();
-    string category(index->first);
+    typename map<string, CategoryClassifier>::const_iterator index = classifiers.begin();
+    size_t category = 0;
+    size_t position = 0;
     double logProbability = index->second.getCategoryProbability(wordMap);
-    if (_traceInfo)
-        cout << "Category: " << index->first << " Log probability: " << logProbability << endl;
+    if (traceInfo)
+        cout << "Category: " << index->first << " Log probability: " << logProbability << '\n';
     index++;
-    while (index != _classifiers.end()) {
+    position++;
+    while (index != classifiers.end()) {
         double newProbability = index->second.getCategoryProbability(wordMap);
-        if (_traceInfo)
-            cout << "Category: " << index->first << " Log probability: " << newProbability << endl;
+        if (traceInfo)
+            cout << "Category: " << index->first << " Log probability: " << newProbability << '\n';
         if (newProbability > logProbability) {
             logProbability = newProbability;
-            category = index->first;
+            category = position;
         }
         index++;
+        position++;
     } // While loop
 
-    results.insert(make_pair(fileName, category));
+    return category;
 }
+
+// Build and scoring code for each scoring policy, used here and by cross validation
+template void DocumentClassifier::buildClassifiers<MultinomialPolicy>(
+    const InfoByCategory&, double, CategoryClassifiers&);
+template void DocumentClassifier::buildClassifiers<ComplementPolicy>(
+    const InfoByCategory&, double, ComplementClassifiers&);
+template void DocumentClassifier::buildClassifiers<BernoulliPolicy>(
+    const InfoByCategory&, double, BernoulliClassifiers&);
+template string DocumentClassifier::bestCategory<Classifier>(
+    const CategoryClassifiers&, const DocumentWordMap&, bool);
+template string DocumentClassifier::bestCategory<ComplementClassifier>(
+    const ComplementClassifiers&, const DocumentWordMap&, bool);
+template string DocumentClassifier::bestCategory<BernoulliClassifier>(
+    const BernoulliClassifiers&, const DocumentWordMap&, bool);
+template string DocumentClassifier::bestCategory<HashedClassifier>(
+    const HashedClassifiers&, const DocumentWordMap&, bool);
+template size_t DocumentClassifier::bestCategoryId<Classifier>(
+    const CategoryClassifiers&, const DocumentWordMap&, bool);
+template size_t DocumentClassifier::bestCategoryId<ComplementClassifier>(
+    const ComplementClassifiers&, const DocumentWordMap&, bool);
+template size_t DocumentClassifier::bestCategoryId<BernoulliClassifier>(
+    const BernoulliClassifiers&, const DocumentWordMap&, bool);
+template size_t DocumentClassifier::bestCategoryId<HashedClassifier>(
+    const HashedClassifiers&, const DocumentWordMap&, bool);
@@ -25,9 +25,18 @@
 #include <map>
 #include <string>
 #include <vector>
+#include <atomic>
+#include <memory>
 #include "classifier.h"
+#include "hashedModelFile.h"
+#include "classifyStats.h"
+#include "catWordDataFactory.h"
 #include "documentWordMapFactory.h"
+#include "documentPipeline.h"
+#include "documentCache.h"
+#include "classifyMetrics.h"
 #include "stopwords.h"
+#include "tokenScanner.h"
 
 using std::map;
 using std::string;
@@ -35,12 +44,66 @@ using std::vector;
 
 typedef map<string, string> DocClassifyMap;
 
+/* Working data for classifying documents held in memory. The classifier is
+    never changed once trained, so any number of threads can use it at once,
+    as long as each has its own context. A context keeps its buffers between
+    documents, including a flat table for the word counts whose entries keep
+    the text of their stems, so once they have grown to fit the documents
+    seen, classifying allocates nothing. The exception is a token too long
+    to fit inside a string, which allocates its text */
+class ClassifyContext
+{
+public:
+    ClassifyContext() : _scanner(), _tokens(), _syllables(), _words(), _bigrams(),
+                        _knownBigrams(), _scores() {}
+
+    // Use default destructor
+
+    /* Score of every category for the last document classified, in
+        category name order. Higher is more likely */
+    const vector<double>& getScores() const
+    {
+        return _scores;
+    }
+
+private:
+    friend class DocumentClassifier;
+
+    TokenScanner _scanner;
+    vector<string> _tokens;
+    vector<size_t> _syllables;
+    DocumentWordTable _words;
+    DocumentBigrams _bigrams;
+    DocumentBigrams _knownBigrams;
+    vector<double> _scores;
+
+    // Make non-copyable, each caller should have its own
+    ClassifyContext(const ClassifyContext& other);
+    ClassifyContext& operator=(const ClassifyContext& other);
+};
+
 class DocumentClassifier
 {
 public:
-    // Construct the classifier from a set of training data directories
-    DocumentClassifier(const vector<string>& trainingDirs, const string& stopwordsFile,
-                       bool traceInfo);
+    /* Construct the classifier from a set of training data directories and
+        counts files written by training elsewhere. Either may be empty. The
+        document cache is optional, and is not owned */
+    DocumentClassifier(const vector<string>& trainingDirs, const vector<string>& trainingCounts,
+                       const string& stopwordsFile, bool traceInfo,
+                       const PipelineSettings& pipelineSettings = PipelineSettings(),
+                       DocumentCache* cache = NULL,
+                       const ScoringSettings& scoring = ScoringSettings());
+
+    /* Construct the classifier from a model file written by writeHashedModel().
+        The file is mapped read only, so processes classifying with the same
+        file share one copy of the model */
+    DocumentClassifier(const string& hashedModelFile, const string& stopwordsFile,
+                       const PipelineSettings& pipelineSettings = PipelineSettings(),
+                       const ScoringSettings& scoring = ScoringSettings());
+
+    /* Write the classifiers to a model file for the constructor above. Throws
+        if not trained with hashed words */
+    void writeHashedModel(const string& fileName) const;
 
     // Classify documents in a set of files or directories
     void classify(const vector<string>& classifyList, DocClassifyMap& results) const;
@@ -48,12 +111,93 @@ public:
     // Classify documents in a file or directory
     void classify(const string& classifyDir, DocClassifyMap& results) const;
 
+    /* Classify the documents in directory trees organized by category, the
+        same as for training, and record how many went to the right category */
+    void evaluate(const vector<string>& labelledDirs, ClassifyStats& stats) const;
+
+    // Return the category for a document already converted to word data
+    string classifyDocument(const ProcessedDocument& document) const;
+
+    /* Return the position of the category for a document already converted
+        to word data, in category name order */
+    size_t classifyDocumentId(const ProcessedDocument& document) const;
+
+    /* Classify a document already read into memory, and return the position
+        of its category in category name order. The context holds the working
+        data, and afterwards the score of every category. Safe to call from
+        many threads at once, each with its own context. Never traced, since
+        the trace output is shared */
+    size_t classifyBuffer(const char* data, size_t length, ClassifyContext& context) const;
+
+    // Names of the categories, in category name order
+    const vector<string>& getCategories() const;
+
+    /* Record latencies and counts of every document classified from now on
+        in the passed metrics, or stop if NULL. Does not take ownership. Must
+        not be called while classifying */
+    void setMetrics(ClassifyMetrics* metrics);
+
+    /* Return how many of the words of a document no category saw in
+        training. Always zero for hashed or approximate training, which
+        give every word a count */
+    unsigned long long countUnknownWords(const DocumentWordMap& wordMap) const;
+
+    // As above, for a document counted into a reusable table
+    unsigned long long countUnknownWords(const DocumentWordTable& wordTable) const;
+
+    /* Return a description of the approximate training data, and of how
+        many documents were likely, and at worst could have been, classified
+        differently with exact counts. Empty if training was exact */
+    string sketchStatsToString() const;
+
+    /* Create a classifier for each category in a set of training data, for
+        one scoring policy. Categories without documents are skipped. Throws if
+        fewer than two categories remain. Defined for the policies in
+        classifier.h */
+    template <class ScoringPolicy>
+    static void buildClassifiers(const InfoByCategory& trainingData, double knownWordWeight,
+                                 map<string, BasicClassifier<ScoringPolicy> >& classifiers);
+
+    /* Return the category whose classifier gives a document the highest
+        score. Defined for the classifiers of each policy and for hashed
+        classifiers */
+    template <class CategoryClassifier>
+    static string bestCategory(const map<string, CategoryClassifier>& classifiers,
+                               const DocumentWordMap& wordMap, bool traceInfo);
+
+    // As above, but returns the position of the category in the classifiers
+    template <class CategoryClassifier>
+    static size_t bestCategoryId(const map<string, CategoryClassifier>& classifiers,
+                                 const DocumentWordMap& wordMap, bool traceInfo);
+
 private:
     // Stop words for all documents. In class to ensure consistency
     const Stopwords _stopwords;
 
-    // Classifiers per category
+    /* Classifiers per category. Only the set for the scoring policy in use
+        is filled in. Each set has its own scoring loop, so the choice between
+        them is made once per document */
     CategoryClassifiers _classifiers;
+    ComplementClassifiers _complementClassifiers;
+    BernoulliClassifiers _bernoulliClassifiers;
+
+    // Classifiers when trained with approximate counts, for any policy
+    SketchClassifiers _sketchClassifiers;
+
+    /* Classifiers when trained with hashed words, and the model file they
+        score from if loaded from one */
+    std::unique_ptr<HashedModelFile> _hashedModel;
+    HashedClassifiers _hashedClassifiers;
+
+    /* Scores for pairs of neighbouring words, added to those of the
+        multinomial classifiers, and the pairs kept in training */
+    BigramClassifiers _bigramClassifiers;
+    CategoryBigrams _bigramVocabulary;
+
+    ScoringSettings _scoring;
+
+    // Names of the categories with classifiers, in name order
+    vector<string> _categories;
 
     // Factory to convert documents to classify into word data
     const DocumentWordMapFactory _wordDataFactory;
@@ -61,11 +205,63 @@ private:
     // Trace classification operations
     bool _traceInfo;
 
-    // Classify a directory tree of documents
-    void classifyDirs(const string& dirName, DocClassifyMap& results) const;
+    /* Threads and queues used to process documents, and the metrics to
+        record classification in, if any */
+    PipelineSettings _pipelineSettings;
+
+    // Saved word data from earlier runs, if any
+    DocumentCache* _cache;
+
+    /* Results of approximate training, the documents scored with it, how
+        many of those might have been classified differently with exact counts,
+        and how many likely were. Classification runs on many threads, so the
+        counts are atomic */
+    string _sketchSummary;
+    mutable std::atomic<unsigned long long> _sketchScored;
+    mutable std::atomic<unsigned long long> _sketchUncertain;
+    mutable std::atomic<unsigned long long> _sketchLikelyChanged;
+
+    // Train with approximate word counts and create a classifier for each category
+    void buildSketchClassifiers(const CatWordDataFactory& trainingDataSource,
+                                const vector<string>& trainingDirs,
+                                const vector<string>& trainingCounts);
+
+    // Train with hashed words and create a classifier for each category
+    void buildHashedClassifiers(const CatWordDataFactory& trainingDataSource,
+                                const vector<string>& trainingDirs,
+                                const vector<string>& trainingCounts);
+
+    // Create the pair scores for each category in a set of training data
+    void buildBigramClassifiers(InfoByCategory& trainingData);
+
+    /* Find the scaled log probability of a document already converted to
+        word data for every category, in category name order. Known is used
+        to hold the pairs of the document kept in training */
+    void scoreDocument(const DocumentWordTable& words, const DocumentBigrams& bigrams,
+                       DocumentBigrams& known, vector<double>& scores) const;
+
+    // Copy the pairs of a document that were kept in training
+    void getKnownBigrams(const DocumentBigrams& bigrams, DocumentBigrams& known) const;
+
+    // Count the words of a document held either as a map or as a table
+    template <class Document>
+    unsigned long long countUnknownDocumentWords(const Document& document) const;
+
+    // Return the position of the category for a document, scored with words and pairs
+    size_t bigramCategoryId(const ProcessedDocument& document) const;
+
+    // Return the position of the category for a document, scored with approximate counts
+    size_t sketchCategoryId(const DocumentWordMap& wordMap) const;
+
+    // Find the documents to classify in a directory tree
+    void findDocuments(const string& dirName, vector<string>& fileList) const;
+
+    // Classify a list of documents
+    void classifyFiles(const vector<string>& fileList, DocClassifyMap& results) const;
 
-    // Classify a single document
-    void classifyFile(const string& fileName, DocClassifyMap& results) const;
+    // Trace the data of every classifier
+    template <class CategoryClassifier>
+    static void traceClassifiers(const map<string, CategoryClassifier>& classifiers);
 };
 
 #endif // DOCUMENT_CLASSIFIER_H
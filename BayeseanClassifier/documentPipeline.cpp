@@ -0,0 +1,472 @@
+/* This file is part of BayseanClassifier. It classifies documents into
+    categories based on the classic Baysean classification algorithm.
+
+    Copyright (C) 2016   Ezra Erb
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License version 3 as published
+    by the Free Software Foundation.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+    I'd appreciate a note if you find this program useful or make
+    updates. Please contact me through LinkedIn (my profile also has
+    a link to the code depository)
+*/
+#include <string>
+#include <vector>
+#include <map>
+#include <sstream>
+#include <iostream>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <chrono>
+#include <exception>
+
+#include "documentPipeline.h"
+#include "documentReader.h"
+#include "documentWordMapFactory.h"
+#include "boundedQueue.h"
+#include "documentCache.h"
+#include "contentHash.h"
+#include "fileFinder.h"
+#include "baseException.h"
+
+using namespace std;
+
+const size_t ProcessedDocument::NoCategory;
+
+/* This class converts a list of documents into word data, using a series of
+    stages connected by bounded queues */
+
+// Construct with the factory to tokenize documents with and the thread setup
+DocumentPipeline::DocumentPipeline(const DocumentWordMapFactory& factory,
+                                   const PipelineSettings& settings, const string& name,
+                                   DocumentCache* cache)
+    : _factory(factory), _settings(settings), _name(name),
+      _cache((settings._bigramMinCount > 0) ? NULL : cache), _fileList(NULL), _sink(NULL),
+      _ordered(false), _progress(NULL), _traceRun(0), _readQueue(NULL), _tokenQueue(NULL), _stemQueue(NULL),
+      _nextToRead(0), _activeReaders(0), _activeTokenizers(0), _activeStemmers(0),
+      _nextToDeliver(0), _window(0), _error(), _aborted(false), _cacheHits(0), _cacheMisses(0),
+      _duplicateCount(0)
+{}
+
+// Process the files, passing each to the sink
+void DocumentPipeline::run(const vector<string>& fileList, DocumentSink& sink, bool ordered)
+{
+    // Zero threads in any stage would never finish, so treat them as one
+    unsigned short readThreads = _settings._readThreads > 0 ? _settings._readThreads : 1;
+    unsigned short tokenizeThreads = _settings._tokenizeThreads > 0 ? _settings._tokenizeThreads : 1;
+    unsigned short stemThreads = _settings._stemThreads > 0 ? _settings._stemThreads : 1;
+    unsigned short scoreThreads = _settings._scoreThreads > 0 ? _settings._scoreThreads : 1;
+    if (ordered)
+        scoreThreads = 1;
+
+    BoundedQueue<DocumentBuffer> readQueue(_settings._queueSize);
+    BoundedQueue<TokenizedDocument> tokenQueue(_settings._queueSize);
+    BoundedQueue<ProcessedDocument> stemQueue(_settings._queueSize);
+
+    _fileList = &fileList;
+    _sink = &sink;
+    _ordered = ordered;
+    _readQueue = &readQueue;
+    _tokenQueue = &tokenQueue;
+    _stemQueue = &stemQueue;
+    _nextToRead = 0;
+    _activeReaders = readThreads;
+    _activeTokenizers = tokenizeThreads;
+    _activeStemmers = stemThreads;
+    _nextToDeliver = 0;
+    /* Enough documents to fill every queue and thread, so the window only
+        limits reading when one document is holding up the rest */
+    _window = ((size_t)_settings._queueSize * 3) + readThreads + tokenizeThreads +
+        stemThreads + 1;
+    _error = exception_ptr();
+    _duplicateCount = 0;
+    _aborted = false;
+
+    unsigned long long startHits = 0;
+    unsigned long long startMisses = 0;
+    if (_cache != NULL) {
+        _cache->setKey(_factory.getCacheKey());
+        startHits = _cache->getHits();
+        startMisses = _cache->getMisses();
+    }
+
+    // Released automatically on exceptions
+    unique_ptr<ProgressReporter> progress;
+    if (_settings._progressInterval > 0)
+        progress.reset(new ProgressReporter(_name, fileList.size(), _settings._progressInterval));
+    _progress = progress.get();
+    if (_settings._tracer != NULL)
+        _traceRun = _settings._tracer->beginRun(_name, fileList);
+
+    vector<thread> threads;
+    try {
+        unsigned short index;
+        for (index = 0; index < readThreads; index++)
+            threads.push_back(thread(&DocumentPipeline::readWorker, this));
+        for (index = 0; index < tokenizeThreads; index++)
+            threads.push_back(thread(&DocumentPipeline::tokenizeWorker, this));
+        for (index = 0; index < stemThreads; index++)
+            threads.push_back(thread(&DocumentPipeline::stemWorker, this));
+        if (ordered)
+            threads.push_back(thread(&DocumentPipeline::orderedScoreWorker, this));
+        else
+            for (index = 0; index < scoreThreads; index++)
+                threads.push_back(thread(&DocumentPipeline::scoreWorker, this, index));
+    }
+    catch (...) {
+        // Could not start every thread. Stop the ones that did start
+        abortRun();
+    }
+
+    vector<thread>::iterator threadIndex;
+    for (threadIndex = threads.begin(); threadIndex != threads.end(); threadIndex++)
+        threadIndex->join();
+
+    _readStats = readQueue.getStats();
+    _tokenStats = tokenQueue.getStats();
+    _stemStats = stemQueue.getStats();
+    if (_cache != NULL) {
+        _cacheHits = _cache->getHits() - startHits;
+        _cacheMisses = _cache->getMisses() - startMisses;
+    }
+    _readQueue = NULL;
+    _tokenQueue = NULL;
+    _stemQueue = NULL;
+    _sink = NULL;
+    _fileList = NULL;
+    _progress = NULL;
+    if (progress.get() != NULL)
+        progress->stop();
+
+    if (_settings._reportStats)
+        cerr << statsToString();
+    if (_error)
+        rethrow_exception(_error);
+}
+
+// Seconds from the passed time to now
+static double secondsSince(const chrono::steady_clock::time_point& start)
+{
+    return chrono::duration<double>(chrono::steady_clock::now() - start).count();
+}
+
+// Record an error from a stage and stop all stages
+void DocumentPipeline::abortRun()
+{
+    {
+        lock_guard<mutex> guard(_lock);
+        // Only the first error is reported, the rest are usually caused by it
+        if (!_error)
+            _error = current_exception();
+        _aborted = true;
+    }
+    _windowMoved.notify_all();
+    _readQueue->abort();
+    _tokenQueue->abort();
+    _stemQueue->abort();
+}
+
+/* Read stage: load files into memory. Documents found in the cache skip
+    the tokenize and stem stages */
+void DocumentPipeline::readWorker()
+{
+    DocumentBuffer document;
+    ProcessedDocument cached;
+    try {
+        while (true) {
+            size_t fileIndex;
+            {
+                unique_lock<mutex> guard(_lock);
+                if (_ordered)
+                    while ((!_aborted) && (_nextToRead < _fileList->size()) &&
+                           (_nextToRead >= _nextToDeliver + _window))
+                        _windowMoved.wait(guard);
+                if (_aborted || (_nextToRead >= _fileList->size()))
+                    break;
+                fileIndex = _nextToRead;
+                _nextToRead++;
+            }
+            chrono::steady_clock::time_point start = chrono::steady_clock::now();
+            document._index = fileIndex;
+            document._fileName = (*_fileList)[fileIndex];
+            if (_cache != NULL) {
+                if (!FileFinder::getFileStamp(document._fileName, document._stamp)) {
+                    stringstream errorMessage;
+                    errorMessage << "Error, could not open data file " << document._fileName;
+                    THROW_BASE_EXCEPTION(errorMessage.str().c_str());
+                }
+                unsigned long long contentHash;
+                bool found = _cache->lookup(document._fileName, document._stamp, cached._wordMap,
+                                            contentHash);
+                if (_settings._metrics != NULL)
+                    _settings._metrics->addCacheLookup(found);
+                if (found) {
+                    if (_progress != NULL)
+                        _progress->addBytes(document._stamp._size);
+                    /* Copies must be found the same way whether or not a document
+                        came from the cache, or the model would depend on it */
+                    if (_settings._skipDuplicates &&
+                        _sink->isDuplicate(document._fileName, fileIndex, contentHash)) {
+                        DocumentCost cost;
+                        cost._bytes = document._stamp._size;
+                        if (!skipDuplicate(cached, document._fileName, fileIndex, cost,
+                                           secondsSince(start)))
+                            break;
+                        continue;
+                    }
+                    cached._index = document._index;
+                    cached._fileName = document._fileName;
+                    cached._duplicate = false;
+                    cached._cost._bytes = document._stamp._size;
+                    cached._cost._tokens = cached._wordMap.getTotalWordCount();
+                    cached._cost._seconds = 0.0;
+                    double seconds = secondsSince(start);
+                    addStageTime(ClassifyMetrics::ReadStage, seconds, cached._cost);
+                    TRACE_EVENT(_settings._tracer, TraceCacheHit, _traceRun, fileIndex,
+                                cached._cost._bytes, seconds);
+                    if (!_stemQueue->push(cached))
+                        break;
+                    continue;
+                }
+            }
+            DocumentReader::readFile(document._fileName, document._data);
+            if (_progress != NULL)
+                _progress->addBytes(document._data.length());
+            document._cost = DocumentCost();
+            document._cost._bytes = document._data.length();
+            // The cache stores the hash, so cached documents can be checked for copies later
+            document._contentHash = 0;
+            if (_settings._skipDuplicates || (_cache != NULL))
+                document._contentHash = hashContent(document._data.data(),
+                                                    document._data.length());
+            if (_settings._skipDuplicates &&
+                _sink->isDuplicate(document._fileName, fileIndex, document._contentHash)) {
+                if (!skipDuplicate(cached, document._fileName, fileIndex, document._cost,
+                                   secondsSince(start)))
+                    break;
+                continue;
+            }
+            double seconds = secondsSince(start);
+            addStageTime(ClassifyMetrics::ReadStage, seconds, document._cost);
+            TRACE_EVENT(_settings._tracer, TraceRead, _traceRun, fileIndex, document._cost._bytes,
+                        seconds);
+            if (!_readQueue->push(document))
+                break;
+        } // While documents to read
+    }
+    catch (...) {
+        abortRun();
+    }
+
+    // Last reader out tells the next stage no more documents are coming
+    lock_guard<mutex> guard(_lock);
+    _activeReaders--;
+    if (_activeReaders == 0)
+        _readQueue->close();
+}
+
+// Send a copy of an earlier document on to the score stage, which drops it
+bool DocumentPipeline::skipDuplicate(ProcessedDocument& marker, const string& fileName,
+                                     size_t fileIndex, const DocumentCost& cost, double seconds)
+{
+    {
+        lock_guard<mutex> guard(_lock);
+        _duplicateCount++;
+    }
+    marker._index = fileIndex;
+    marker._fileName = fileName;
+    marker._wordMap.clear();
+    marker._bigrams.clear();
+    marker._duplicate = true;
+    marker._cost = cost;
+    addStageTime(ClassifyMetrics::ReadStage, seconds, marker._cost);
+    TRACE_EVENT(_settings._tracer, TraceDuplicate, _traceRun, fileIndex, marker._cost._bytes,
+                seconds);
+    return _stemQueue->push(marker);
+}
+
+// Tokenize stage: split documents into words
+void DocumentPipeline::tokenizeWorker()
+{
+    DocumentBuffer document;
+    TokenizedDocument tokenized;
+    try {
+        while (_readQueue->pop(document)) {
+            chrono::steady_clock::time_point start = chrono::steady_clock::now();
+            tokenized._index = document._index;
+            tokenized._fileName.swap(document._fileName);
+            tokenized._stamp = document._stamp;
+            tokenized._contentHash = document._contentHash;
+            _factory.getTokens(document._data.data(), document._data.length(),
+                               tokenized._tokens);
+            tokenized._cost = document._cost;
+            tokenized._cost._tokens = tokenized._tokens.size();
+            double seconds = secondsSince(start);
+            addStageTime(ClassifyMetrics::TokenizeStage, seconds, tokenized._cost);
+            TRACE_EVENT(_settings._tracer, TraceTokenize, _traceRun, tokenized._index,
+                        tokenized._cost._tokens, seconds);
+            if (!_tokenQueue->push(tokenized))
+                break;
+        }
+    }
+    catch (...) {
+        abortRun();
+    }
+
+    lock_guard<mutex> guard(_lock);
+    _activeTokenizers--;
+    if (_activeTokenizers == 0)
+        _tokenQueue->close();
+}
+
+// Stem stage: convert words to stems and count them
+void DocumentPipeline::stemWorker()
+{
+    TokenizedDocument tokenized;
+    ProcessedDocument processed;
+    try {
+        while (_tokenQueue->pop(tokenized)) {
+            chrono::steady_clock::time_point start = chrono::steady_clock::now();
+            processed._index = tokenized._index;
+            processed._fileName.swap(tokenized._fileName);
+            processed._wordMap.clear();
+            processed._duplicate = false;
+            DocumentWordMapFactory::addStems(tokenized._tokens, processed._wordMap);
+            if (_settings._bigramMinCount > 0)
+                DocumentWordMapFactory::addBigrams(tokenized._tokens, processed._bigrams);
+            if (_cache != NULL)
+                _cache->store(processed._fileName, tokenized._stamp, tokenized._contentHash,
+                              processed._wordMap);
+            processed._cost = tokenized._cost;
+            double seconds = secondsSince(start);
+            addStageTime(ClassifyMetrics::StemStage, seconds, processed._cost);
+            TRACE_EVENT(_settings._tracer, TraceStem, _traceRun, processed._index,
+                        processed._wordMap.size(), seconds);
+            if (!_stemQueue->push(processed))
+                break;
+        }
+    }
+    catch (...) {
+        abortRun();
+    }
+
+    lock_guard<mutex> guard(_lock);
+    _activeStemmers--;
+    if (_activeStemmers == 0)
+        _stemQueue->close();
+}
+
+// Score stage: pass documents to the sink
+void DocumentPipeline::scoreWorker(unsigned short threadIndex)
+{
+    ProcessedDocument processed;
+    try {
+        while (_stemQueue->pop(processed))
+            finishDocument(processed, threadIndex);
+    }
+    catch (...) {
+        abortRun();
+    }
+}
+
+// Give documents to the sink in file list order
+void DocumentPipeline::orderedScoreWorker()
+{
+    // Documents that arrived before one earlier in the list
+    map<size_t, ProcessedDocument> pending;
+    ProcessedDocument processed;
+    try {
+        while (_stemQueue->pop(processed)) {
+            if (processed._index != _nextToDeliver) {
+                swap(pending[processed._index], processed);
+                continue;
+            }
+            finishDocument(processed, 0);
+            while (true) {
+                {
+                    lock_guard<mutex> guard(_lock);
+                    _nextToDeliver++;
+                }
+                _windowMoved.notify_all();
+                map<size_t, ProcessedDocument>::iterator next = pending.find(_nextToDeliver);
+                if (next == pending.end())
+                    break;
+                finishDocument(next->second, 0);
+                pending.erase(next);
+            }
+        } // While documents to score
+    }
+    catch (...) {
+        abortRun();
+    }
+}
+
+// Pass one document to the sink, and count it in the progress and statistics
+void DocumentPipeline::finishDocument(ProcessedDocument& document, unsigned short threadIndex)
+{
+    // Copies were skipped, so there is no work to report for them
+    if (!document._duplicate) {
+        chrono::steady_clock::time_point start = chrono::steady_clock::now();
+        document._category = ProcessedDocument::NoCategory;
+        _sink->process(document, threadIndex);
+        double seconds = secondsSince(start);
+        addStageTime(ClassifyMetrics::ScoreStage, seconds, document._cost);
+        TRACE_EVENT(_settings._tracer, TraceScore, _traceRun, document._index,
+                    document._wordMap.size(), seconds);
+        if (document._category != ProcessedDocument::NoCategory)
+            TRACE_EVENT(_settings._tracer, TraceClassify, _traceRun, document._index,
+                        document._category, 0.0);
+        if (_settings._documentStats != NULL)
+            _settings._documentStats->addDocument(_name, document._fileName, document._cost);
+        if (_settings._metrics != NULL)
+            _settings._metrics->addDocument(document._cost._seconds, document._cost._tokens);
+    }
+    if (_progress != NULL)
+        _progress->addDocument();
+}
+
+// Add the time a document spent in a stage to its cost and the metrics
+void DocumentPipeline::addStageTime(ClassifyMetrics::Stage stage, double seconds,
+                                    DocumentCost& cost) const
+{
+    cost._seconds += seconds;
+    if (_settings._metrics != NULL)
+        _settings._metrics->addStageTime(stage, seconds);
+}
+
+/* Return a string describing the queue usage of the last run, used to
+    balance the stage thread counts */
+string DocumentPipeline::statsToString() const
+{
+    const char* queueNames[] = {"read->tokenize", "tokenize->stem", "stem->score"};
+    const QueueStats* queueStats[] = {&_readStats, &_tokenStats, &_stemStats};
+
+    ostringstream buffer;
+    int index;
+    for (index = 0; index < 3; index++) {
+        const QueueStats& stats = *queueStats[index];
+        double averageDepth = 0.0;
+        if (stats._pushCount > 0)
+            averageDepth = (double)stats._depthTotal / (double)stats._pushCount;
+        buffer << _name << " queue " << queueNames[index] << ": capacity: " << stats._capacity
+               << " documents: " << stats._pushCount << " max depth: " << stats._maxDepth
+               << " average depth: " << averageDepth << " producer waits: " << stats._fullWaits
+               << " consumer waits: " << stats._emptyWaits << endl;
+    }
+    if (_cache != NULL)
+        buffer << _name << " document cache: hits: " << _cacheHits << " misses: "
+               << _cacheMisses << endl;
+    if (_settings._skipDuplicates)
+        buffer << _name << " duplicate documents skipped: " << _duplicateCount << endl;
+    return buffer.str();
+}
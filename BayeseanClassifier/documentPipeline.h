@@ -0,0 +1,289 @@
+#ifndef DOCUMENT_PIPELINE_H
+#define DOCUMENT_PIPELINE_H
+
+/* This file is part of BayseanClassifier. It classifies documents into
+    categories based on the classic Baysean classification algorithm.
+
+    Copyright (C) 2016   Ezra Erb
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License version 3 as published
+    by the Free Software Foundation.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+    I'd appreciate a note if you find this program useful or make
+    updates. Please contact me through LinkedIn (my profile also has
+    a link to the code depository)
+*/
+#include <string>
+#include <vector>
+#include <map>
+#include <mutex>
+#include <condition_variable>
+#include <exception>
+#include "boundedQueue.h"
+#include "documentReader.h"
+#include "documentWordMapFactory.h"
+#include "documentCache.h"
+#include "fileFinder.h"
+#include "progressReporter.h"
+#include "documentStats.h"
+#include "classifyMetrics.h"
+#include "eventTracer.h"
+
+using std::string;
+using std::vector;
+using std::map;
+
+// Threads per stage and queue sizes for the document pipeline
+struct PipelineSettings
+{
+    PipelineSettings() : _readThreads(4), _tokenizeThreads(2), _stemThreads(2),
+                         _scoreThreads(2), _queueSize(32), _reportStats(false),
+                         _memoryBudget(0), _bigramMinCount(0), _bigramLimit(1000000), _skipDuplicates(false),
+                         _progressInterval(0),
+                         _documentStats(NULL), _metrics(NULL), _tracer(NULL) {}
+
+    // Use default copy constructor, copy operator and destructor
+
+    unsigned short _readThreads;
+    unsigned short _tokenizeThreads;
+    unsigned short _stemThreads;
+    unsigned short _scoreThreads;
+
+    // Maximum documents waiting between two stages
+    unsigned short _queueSize;
+
+    // Print queue statistics to standard error after each run
+    bool _reportStats;
+
+    /* Approximate bytes training counts may use before they are written to
+        temporary files. Zero for no limit */
+    unsigned long long _memoryBudget;
+
+    /* If not zero, count pairs of neighbouring stems as well as single ones,
+        keeping the pairs seen at least this many times. The document cache
+        only holds single stems, so it is not used */
+    unsigned long long _bigramMinCount;
+
+    /* Pairs each score thread may hold while training before it drops the
+        rarest ones. Zero for no limit */
+    unsigned long long _bigramLimit;
+
+    /* Hash the contents of each document read, and skip the ones its sink
+        says are copies of one already seen */
+    bool _skipDuplicates;
+
+    // Seconds between progress reports to standard error. Zero for none
+    unsigned short _progressInterval;
+
+    // Where to record the costliest documents, if wanted. Not owned
+    DocumentStats* _documentStats;
+
+    // Where to record stage latencies and document counts, if wanted. Not owned
+    ClassifyMetrics* _metrics;
+
+    // Where to trace a sample of the documents, if wanted. Not owned
+    EventTracer* _tracer;
+};
+
+// A document after it has been split into words, before stemming
+struct TokenizedDocument
+{
+    TokenizedDocument() : _index(0), _fileName(), _stamp(), _contentHash(0), _tokens(), _cost() {}
+
+    // Use default copy constructor, copy operator and destructor
+
+    size_t _index;
+    string _fileName;
+    FileStamp _stamp;
+    unsigned long long _contentHash;
+    vector<string> _tokens;
+    DocumentCost _cost;
+};
+
+// A document converted into the word data used to classify it
+struct ProcessedDocument
+{
+    // Category of a document no sink has classified
+    static const size_t NoCategory = (size_t)-1;
+
+    ProcessedDocument() : _index(0), _fileName(), _wordMap(), _bigrams(), _cost(),
+                          _duplicate(false), _category(NoCategory) {}
+
+    // Use default copy constructor, copy operator and destructor
+
+    size_t _index;
+    string _fileName;
+    DocumentWordMap _wordMap;
+
+    // Only filled in if the pipeline counts bigrams
+    DocumentBigrams _bigrams;
+
+    DocumentCost _cost;
+
+    /* A copy of an earlier document, with no word data. Passed through the
+        pipeline only to keep ordered runs in order, never to the sink */
+    bool _duplicate;
+
+    /* Set by sinks that classify the document to the ID of the category
+        chosen, for tracing */
+    size_t _category;
+};
+
+/* Receives documents from the final stage of the pipeline. Implemented by
+    training, which counts them, and classification, which scores them */
+class DocumentSink
+{
+public:
+    virtual ~DocumentSink() {}
+
+    /* Process one document. Called from the score threads, so with more than
+        one thread, must be safe to call concurrently. The thread index is
+        below the number of score threads, for sinks that keep results per
+        thread */
+    virtual void process(ProcessedDocument& document, unsigned short threadIndex) = 0;
+
+    /* Return true if a document is a copy of one already seen, and should
+        not be processed. Given the position of the document in the file list
+        and the hash of its contents. Only asked when the pipeline skips
+        duplicates, and called from the read threads, so must be safe to call
+        concurrently. By default documents are never copies */
+    virtual bool isDuplicate(const string& /* fileName */, size_t /* position */,
+                             unsigned long long /* contentHash */)
+    {
+        return false;
+    }
+};
+
+/* This class converts a list of documents into word data, using a series of
+    stages connected by bounded queues:
+        read: load the file into memory
+        tokenize: split it into words and remove stopwords
+        stem: reduce words to their stems and count them
+        score: pass the result to the caller's sink
+    Reading is dominated by I/O latency and the rest by CPU time, so each
+    stage has its own thread count, and they can be balanced for the
+    hardware. When a stage falls behind, the queue in front of it fills and
+    the stages before it wait, so memory use stays bounded.
+
+    With a document cache, the read stage looks each document up first, and
+    sends the ones found straight to the score stage. The stem stage adds the
+    rest to the cache.
+
+    When skipping duplicates, the read stage hashes each document it reads
+    while the contents are still in the processor cache, and asks the sink if
+    it is a copy. Copies also go straight to the score stage, which drops
+    them. Documents are also hashed whenever there is a document cache, which
+    stores the hash, so a document found in the cache is checked with its
+    stored hash. A copy is then skipped whether or not its original came from
+    the cache, and the model does not depend on what was cached.
+
+    With an event tracer, each run is traced as its own run, and each stage
+    records an event for the sampled documents when it finishes with them.
+
+    If any stage fails, the whole run stops and the error is thrown to the
+    caller */
+class DocumentPipeline
+{
+public:
+    /* Construct with the factory to tokenize documents with and the thread
+        setup. The name identifies the pipeline in statistics. The cache is
+        optional. Does not take ownership of the factory or cache */
+    DocumentPipeline(const DocumentWordMapFactory& factory, const PipelineSettings& settings,
+                     const string& name, DocumentCache* cache = NULL);
+
+    // Use default destructor
+
+    /* Process the files, passing each to the sink. If ordered, the sink gets
+        the documents in file list order on a single score thread, which makes
+        tracing output readable */
+    void run(const vector<string>& fileList, DocumentSink& sink, bool ordered);
+
+    /* Return a string describing the queue usage of the last run, used to
+        balance the stage thread counts */
+    string statsToString() const;
+
+private:
+    const DocumentWordMapFactory& _factory;
+    const PipelineSettings _settings;
+    const string _name;
+    DocumentCache* _cache;
+
+    // State for a single run
+    const vector<string>* _fileList;
+    DocumentSink* _sink;
+    bool _ordered;
+
+    // Where to count finished documents and bytes read, if reporting progress
+    ProgressReporter* _progress;
+
+    // Number of the run in the event trace
+    unsigned int _traceRun;
+
+    BoundedQueue<DocumentBuffer>* _readQueue;
+    BoundedQueue<TokenizedDocument>* _tokenQueue;
+    BoundedQueue<ProcessedDocument>* _stemQueue;
+
+    // Next document to read, and threads still running in each stage
+    size_t _nextToRead;
+    unsigned short _activeReaders;
+    unsigned short _activeTokenizers;
+    unsigned short _activeStemmers;
+
+    /* In ordered mode, the documents a reader may start are limited to a window
+        past the last one given to the sink, so the reorder buffer stays bounded */
+    size_t _nextToDeliver;
+    size_t _window;
+
+    // First error found by any stage
+    std::exception_ptr _error;
+    bool _aborted;
+
+    std::mutex _lock;
+    std::condition_variable _windowMoved;
+
+    // Statistics from the last run
+    QueueStats _readStats;
+    QueueStats _tokenStats;
+    QueueStats _stemStats;
+    unsigned long long _cacheHits;
+    unsigned long long _cacheMisses;
+    unsigned long long _duplicateCount;
+
+    // Thread bodies for each stage
+    void readWorker();
+    void tokenizeWorker();
+    void stemWorker();
+    void scoreWorker(unsigned short threadIndex);
+
+    // Give documents to the sink in file list order
+    void orderedScoreWorker();
+
+    /* Send a copy of an earlier document on to the score stage, which drops
+        it. Returns false if the run was stopped */
+    bool skipDuplicate(ProcessedDocument& marker, const string& fileName, size_t fileIndex,
+                       const DocumentCost& cost, double seconds);
+
+    // Pass one document to the sink, and count it in the progress and statistics
+    void finishDocument(ProcessedDocument& document, unsigned short threadIndex);
+
+    // Add the time a document spent in a stage to its cost and the metrics
+    void addStageTime(ClassifyMetrics::Stage stage, double seconds, DocumentCost& cost) const;
+
+    // Record an error from a stage and stop all stages
+    void abortRun();
+
+    // Make non-copyable, the stage threads refer to this object
+    DocumentPipeline(const DocumentPipeline& other);
+    DocumentPipeline& operator=(const DocumentPipeline& other);
+};
+
+#endif // DOCUMENT_PIPELINE_H
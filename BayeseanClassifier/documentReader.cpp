@@ -0,0 +1,69 @@
+/* This file is part of BayseanClassifier. It classifies documents into
+    categories based on the classic Baysean classification algorithm.
+
+    Copyright (C) 2016   Ezra Erb
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License version 3 as published
+    by the Free Software Foundation.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+    I'd appreciate a note if you find this program useful or make
+    updates. Please contact me through LinkedIn (my profile also has
+    a link to the code depository)
+*/
+#include <string>
+#include <fstream>
+#include <sstream>
+
+#include "documentReader.h"
+#include "baseException.h"
+
+using namespace std;
+
+// Read an entire file into memory. Throws if it can not be read
+void DocumentReader::readFile(const string& fileName, string& data)
+{
+    ifstream file;
+    data.clear();
+    try {
+        /* Read in binary mode to get the file in one operation. The tokenizer
+            treats line ends as whitespace, so no translation is needed */
+        file.open(fileName.c_str(), ios_base::in | ios_base::binary);
+        if (!file.is_open()) {
+            stringstream errorMessage;
+            errorMessage << "Error, could not open data file " << fileName;
+            THROW_BASE_EXCEPTION(errorMessage.str().c_str());
+        }
+
+        file.seekg(0, ios_base::end);
+        streamoff fileSize = file.tellg();
+        file.seekg(0, ios_base::beg);
+        if (fileSize > 0) {
+            data.resize((size_t)fileSize);
+            file.read(&data[0], fileSize);
+            // A file that shrank during the read just gives a shorter document
+            data.resize((size_t)file.gcount());
+        }
+        if (file.bad()) {
+            stringstream errorMessage;
+            errorMessage << "Error, could not read data file " << fileName;
+            THROW_BASE_EXCEPTION(errorMessage.str().c_str());
+        }
+        file.close();
+    }
+    catch (...) {
+        // Ensure file always released
+        if (file.is_open())
+            file.close();
+        data.clear();
+        throw;
+    }
+}
@@ -0,0 +1,79 @@
+#ifndef DOCUMENT_READER_H
+#define DOCUMENT_READER_H
+
+/* This file is part of BayseanClassifier. It classifies documents into
+    categories based on the classic Baysean classification algorithm.
+
+    Copyright (C) 2016   Ezra Erb
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License version 3 as published
+    by the Free Software Foundation.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+    I'd appreciate a note if you find this program useful or make
+    updates. Please contact me through LinkedIn (my profile also has
+    a link to the code depository)
+*/
+#include <string>
+#include "fileFinder.h"
+
+using std::string;
+
+// Work spent on one document, used to find the ones that slow a run down
+struct DocumentCost
+{
+    DocumentCost() : _seconds(0.0), _bytes(0), _tokens(0) {}
+
+    // Use default copy constructor, copy operator and destructor
+
+    // Processing time over all stages, not counting time waiting in queues
+    double _seconds;
+    unsigned long long _bytes;
+
+    // Words left after removing stopwords
+    unsigned long long _tokens;
+};
+
+// A document read into memory
+struct DocumentBuffer
+{
+    DocumentBuffer() : _index(0), _fileName(), _stamp(), _data(), _contentHash(0), _cost() {}
+
+    // Use default copy constructor, copy operator and destructor
+
+    // Position of the document in the list being processed
+    size_t _index;
+
+    string _fileName;
+
+    // Size and modification time when read, used to cache the results
+    FileStamp _stamp;
+
+    string _data;
+
+    // Hash of the data, if the reader computed one
+    unsigned long long _contentHash;
+
+    // Work spent on the document so far
+    DocumentCost _cost;
+};
+
+/* This class reads documents into memory. Callers that need to read many
+    documents use DocumentPipeline, which calls it from multiple threads to
+    hide the latency of each read */
+class DocumentReader
+{
+public:
+    // Read an entire file into memory. Throws if it can not be read
+    static void readFile(const string& fileName, string& data);
+};
+
+#endif // DOCUMENT_READER_H
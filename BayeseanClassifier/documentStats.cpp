@@ -0,0 +1,102 @@
+/* This file is part of BayseanClassifier. It classifies documents into
+    categories based on the classic Baysean classification algorithm.
+
+    Copyright (C) 2016   Ezra Erb
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License version 3 as published
+    by the Free Software Foundation.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+    I'd appreciate a note if you find this program useful or make
+    updates. Please contact me through LinkedIn (my profile also has
+    a link to the code depository)
+*/
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <sstream>
+#include <iomanip>
+#include <mutex>
+#include "documentStats.h"
+
+using namespace std;
+
+const size_t DocumentStats::DefaultKeep;
+
+// Value of the measure for an entry
+double DocumentStats::MoreCostly::getValue(const Entry& entry) const
+{
+    if (_measure == Seconds)
+        return entry._cost._seconds;
+    else if (_measure == Bytes)
+        return (double)entry._cost._bytes;
+    else
+        return (double)entry._cost._tokens;
+}
+
+// Construct to keep the passed number of documents per measure
+DocumentStats::DocumentStats(size_t keep)
+    : _keep(keep)
+{}
+
+// Record the cost of one document
+void DocumentStats::addDocument(const string& runName, const string& fileName,
+                                const DocumentCost& cost)
+{
+    if (_keep == 0)
+        return;
+    Entry entry;
+    entry._cost = cost;
+
+    lock_guard<mutex> guard(_lock);
+    int measure;
+    for (measure = 0; measure < MeasureCount; measure++) {
+        vector<Entry>& worst = _worst[measure];
+        MoreCostly compare((Measure)measure);
+        if (worst.size() >= _keep) {
+            // Most documents cost less than everything kept, so check that first
+            if (!compare(entry, worst.front()))
+                continue;
+            pop_heap(worst.begin(), worst.end(), compare);
+            worst.pop_back();
+        }
+        // Names are only copied for documents that are kept
+        if (entry._fileName.empty()) {
+            entry._runName = runName;
+            entry._fileName = fileName;
+        }
+        worst.push_back(entry);
+        push_heap(worst.begin(), worst.end(), compare);
+    }
+}
+
+// Return the worst documents for each measure, worst first
+string DocumentStats::statsToString() const
+{
+    const char* titles[] = {"Slowest documents", "Largest documents",
+                            "Documents with the most words"};
+
+    ostringstream buffer;
+    lock_guard<mutex> guard(_lock);
+    int measure;
+    for (measure = 0; measure < MeasureCount; measure++) {
+        vector<Entry> worst(_worst[measure]);
+        MoreCostly compare((Measure)measure);
+        sort_heap(worst.begin(), worst.end(), compare);
+        buffer << titles[measure] << ":" << endl;
+        vector<Entry>::const_iterator index;
+        for (index = worst.begin(); index != worst.end(); index++)
+            buffer << "  " << fixed << setprecision(3) << index->_cost._seconds * 1000.0 << " ms "
+                   << index->_cost._bytes << " bytes " << index->_cost._tokens << " words "
+                   << index->_runName << ": " << index->_fileName << endl;
+    }
+    return buffer.str();
+}
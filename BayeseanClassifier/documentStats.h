@@ -0,0 +1,101 @@
+#ifndef DOCUMENT_STATS_H
+#define DOCUMENT_STATS_H
+
+/* This file is part of BayseanClassifier. It classifies documents into
+    categories based on the classic Baysean classification algorithm.
+
+    Copyright (C) 2016   Ezra Erb
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License version 3 as published
+    by the Free Software Foundation.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+    I'd appreciate a note if you find this program useful or make
+    updates. Please contact me through LinkedIn (my profile also has
+    a link to the code depository)
+*/
+#include <string>
+#include <vector>
+#include <mutex>
+#include "documentReader.h"
+
+using std::string;
+using std::vector;
+
+/* This class finds the documents that cost a run the most: the slowest to
+    process, the largest, and those with the most words. A handful of
+    pathological files, like huge logs or text with no spaces, can ruin
+    throughput, and this shows which ones to exclude.
+
+    Each measure keeps a min-heap of the worst documents seen so far, bounded
+    to the number wanted, so recording a document is at worst a logarithmic
+    heap update and memory does not grow with the number of documents. Safe
+    to call from many threads at once */
+class DocumentStats
+{
+public:
+    // Number of documents reported per measure unless told otherwise
+    static const size_t DefaultKeep = 10;
+
+    // Construct to keep the passed number of documents per measure
+    explicit DocumentStats(size_t keep);
+
+    // Use default destructor
+
+    /* Record the cost of one document. The run name says which pipeline
+        processed it */
+    void addDocument(const string& runName, const string& fileName, const DocumentCost& cost);
+
+    // Return the worst documents for each measure, worst first
+    string statsToString() const;
+
+private:
+    // The measures documents are ranked by
+    enum Measure { Seconds, Bytes, Tokens, MeasureCount };
+
+    struct Entry
+    {
+        Entry() : _runName(), _fileName(), _cost() {}
+
+        // Use default copy constructor, copy operator and destructor
+
+        string _runName;
+        string _fileName;
+        DocumentCost _cost;
+    };
+
+    // Orders entries so the least costly is at the top of a heap
+    class MoreCostly
+    {
+    public:
+        explicit MoreCostly(Measure measure) : _measure(measure) {}
+
+        bool operator()(const Entry& first, const Entry& second) const
+        {
+            return getValue(first) > getValue(second);
+        }
+
+        double getValue(const Entry& entry) const;
+
+    private:
+        Measure _measure;
+    };
+
+    const size_t _keep;
+    vector<Entry> _worst[MeasureCount];
+    mutable std::mutex _lock;
+
+    // Make non-copyable, the lock can not be copied
+    DocumentStats(const DocumentStats& other);
+    DocumentStats& operator=(const DocumentStats& other);
+};
+
+#endif // DOCUMENT_STATS_H
@@ -25,120 +25,290 @@
     the document */
 #include <string>
 #include <map>
-#include <fstream>
+#include <vector>
 #include <sstream>
 #include <iostream>
+#include <cctype>
+#include <algorithm>
 
 #include "baseException.h"
+#include "documentReader.h"
 #include "porterStemmer.h"
 #include "stopwords.h"
 #include "documentWordMapFactory.h"
+#include "tokenScanner.h"
 
 using namespace std;
 
 const string DocumentWordMapFactory::_letters("abcdefghijklmnopqrstuvwxyz");
 
-// Return the total word count of the map
-unsigned int DocumentWordMap::getTotalWordCount() const
-{
-    unsigned int result = 0;
-    const_iterator index;
-    for (index = begin(); index != end(); index++)
-        result += index->second;
-    return result;
-}
-
-// Return a atring containing all data in the map
-// WARNING: Likely to be huge
-string DocumentWordMap::allMapData() const
-{
-    ostringstream buffer;
-    const_iterator index;
-    for (index = begin(); index != end(); index++)
-        buffer << index->first << ":" << index->second << " ";
-    return buffer.str();
-}
-
 // Construct with the list of stopwords to use. Does not take ownership
 DocumentWordMapFactory::DocumentWordMapFactory(const Stopwords& stopwords)
     : _stopwords(stopwords)
 {}
 
+/* Return a value that changes whenever the results of converting a
+    document would change */
+unsigned long long DocumentWordMapFactory::getCacheKey() const
+{
+    // Mix the versions into the stopword hash, FNV style
+    unsigned long long key = _stopwords.getHash();
+    key = (key ^ TokenizerVersion) * 1099511628211ULL;
+    key = (key ^ PorterStemmer::Version) * 1099511628211ULL;
+    return key;
+}
+
 // Convert the specified file into a document word map
 void DocumentWordMapFactory::getWordMap(const string& fileName,
                                         DocumentWordMap& wordMap) const
 {
-    ifstream file;
+    string data;
     wordMap.clear();
-    try {
-        file.open(fileName.c_str());
-        if (!file.is_open()) {
-            stringstream errorMessage;
-            errorMessage << "Error, could not open data file " << fileName;
-            THROW_BASE_EXCEPTION(errorMessage.str().c_str());
-        }
+    DocumentReader::readFile(fileName, data);
+    getWordMap(data.data(), data.length(), wordMap);
+}
 
+// Convert a document already read into memory into a document word map
+void DocumentWordMapFactory::getWordMap(const char* data, size_t length,
+                                        DocumentWordMap& wordMap) const
+{
+    vector<string> tokens;
+    wordMap.clear();
+    getTokens(data, length, tokens);
+    addStems(tokens, wordMap);
+}
+
+/* Convert a document already read into memory into the list of words to
+    classify it with, in document order */
+void DocumentWordMapFactory::getTokens(const char* data, size_t length,
+                                       vector<string>& tokens) const
+{
+    TokenScanner scanner;
+    getTokens(data, length, tokens, scanner);
+}
+
+/* Convert a document already read into memory into the list of words to
+    classify it with, using a scanner whose buffers are reused */
+void DocumentWordMapFactory::getTokens(const char* data, size_t length,
+                                       vector<string>& tokens, TokenScanner& scanner) const
+{
+    tokens.clear();
+    try {
         string word;
         string wrapped;
-        // Classic C method of doing case changes
-        unsigned short caseFold = (short)'A' - (short)'a';
-
-        while (file >> word) {
-            string::iterator index;
-            // Convert to lowercase. The classic C method of doing so
-            for (index = word.begin(); index != word.end(); index++) {
-                if ((*index >= 'A') && (*index <= 'Z'))
-                    *index = (char)((short)*index - caseFold);
-            }
 
-            // If a word wrapped from the previous line, prepend it
-            if (!wrapped.empty()) {
-                wrapped.append(word);
-                word.swap(wrapped);
-                wrapped.clear();
+        /* Split the document on whitespace. This matches the definition used
+            when reading words from a stream, so results are the same as
+            reading the file word by word */
+        scanner.scan(data, length);
+        const char* folded = scanner.getFolded();
+        size_t wordStart, wordEnd;
+        while (scanner.nextWord(wordStart, wordEnd)) {
+            if ((!wrapped.empty()) || (folded[wordEnd - 1] == '-')) {
+                // Hyphenated words span two tokens, so put them together as strings
+                word.assign(folded + wordStart, wordEnd - wordStart);
+                addToken(word, wrapped, tokens);
+                continue;
             }
 
-            /* If the last letter is a dash, it wrapped. Remove the dash and append
-                to the next word */
-            if (word[word.length() - 1] == '-') {
-                word.erase(word.length() - 1);
-                wrapped.swap(word);
+            // Same rules as addToken(), done on the positions of the letters
+            size_t firstChar = scanner.findFirstLetter(wordStart, wordEnd);
+            if (firstChar < wordEnd) {
+                size_t lastChar = scanner.findLastLetter(firstChar, wordEnd);
+                if ((lastChar > wordStart + 1) && (folded[lastChar] == 's') &&
+                    (folded[lastChar - 1] == '\''))
+                    lastChar -= 2;
+                if (lastChar >= firstChar) {
+                    word.assign(folded + firstChar, lastChar - firstChar + 1);
+                    if (!_stopwords.isStopword(word))
+                        tokens.push_back(word);
+                }
             }
-            else {
-                /* Strip non-alpha chars at the start and end. Punctuation in
-                    the middle gets kept. Note that this will strip out
-                    numerics, which normally aren't high-frequency enough for
-                    useful classifiation */
-                size_t firstChar = word.find_first_of(_letters);
-                if (firstChar != string::npos) {
-                    size_t lastChar = word.find_last_of(_letters);
-                    // If last two chars are apostophe-s, ignore them
-                    if ((lastChar > 1) && (word[lastChar] == 's') &&
-                        (word[lastChar - 1]) == '\'')
-                        lastChar -= 2;
-                    if (lastChar >= firstChar) {
-                        if ((firstChar > 0) || (lastChar < word.length() - 1))
-                            word = word.substr(firstChar, lastChar - firstChar + 1);
-
-                        // Test the word against the stopword list. If not found, continue processing
-                        if (!_stopwords.isStopword(word)) {
-                            // Convert to stem
-                            word = PorterStemmer::getStem(word);
-                            wordMap.addWord(word);
-                        } // Not a stopword
-                    } // Wanted letters in word
-                } // Found a letter in the word
-                // else word has no letters, ignore
-            } // Word did not wrap to the next line
-        } // While words to read in the file
-        file.close();
+        } // While words to read in the document
     }
     catch (...) {
-        // Ensure file always released
-        if (file.is_open())
-            file.close();
         // Clear the partial results so always consistent
-        wordMap.clear();
+        tokens.clear();
         throw;
     }
 }
+
+// Convert words from getTokens() to their stems and count them into the map
+void DocumentWordMapFactory::addStems(vector<string>& tokens, DocumentWordMap& wordMap)
+{
+    vector<size_t> syllables;
+    addStems(tokens, wordMap, syllables);
+}
+
+/* Convert words from getTokens() to their stems and count them into the map,
+    with working space for the stemmer that is reused between documents */
+void DocumentWordMapFactory::addStems(vector<string>& tokens, DocumentWordMap& wordMap,
+                                      vector<size_t>& syllables)
+{
+    vector<string>::iterator index;
+    for (index = tokens.begin(); index != tokens.end(); index++) {
+        PorterStemmer::stemInPlace(*index, syllables);
+        wordMap.addWord(*index);
+    }
+}
+
+/* Convert words from getTokens() to their stems and count them into a table
+    reused between documents, ready to iterate */
+void DocumentWordMapFactory::addStems(vector<string>& tokens, DocumentWordTable& wordTable,
+                                      vector<size_t>& syllables)
+{
+    vector<string>::iterator index;
+    for (index = tokens.begin(); index != tokens.end(); index++) {
+        PorterStemmer::stemInPlace(*index, syllables);
+        wordTable.addWord(*index);
+    }
+    wordTable.sortWords();
+}
+
+// Count each pair of neighbouring stems from addStems() into the table
+void DocumentWordMapFactory::addBigrams(const vector<string>& stems, DocumentBigrams& bigrams)
+{
+    bigrams.clear();
+    if (stems.empty())
+        return;
+    // The ID of each stem is used for the pair before it and the pair after it
+    unsigned int previous = DocumentBigrams::getTermId(stems[0]);
+    size_t index;
+    for (index = 1; index < stems.size(); index++) {
+        unsigned int current = DocumentBigrams::getTermId(stems[index]);
+        bigrams.addCount(DocumentBigrams::makeKey(previous, current), 1U);
+        previous = current;
+    }
+}
+
+/* Process one whitespace delimited token from a document, adding it to
+    the token list if wanted */
+void DocumentWordMapFactory::addToken(string& word, string& wrapped,
+                                      vector<string>& tokens) const
+{
+    // Classic C method of doing case changes
+    unsigned short caseFold = (short)'A' - (short)'a';
+
+    string::iterator index;
+    // Convert to lowercase. The classic C method of doing so
+    for (index = word.begin(); index != word.end(); index++) {
+        if ((*index >= 'A') && (*index <= 'Z'))
+            *index = (char)((short)*index - caseFold);
+    }
+
+    // If a word wrapped from the previous line, prepend it
+    if (!wrapped.empty()) {
+        wrapped.append(word);
+        word.swap(wrapped);
+        wrapped.clear();
+    }
+
+    /* If the last letter is a dash, it wrapped. Remove the dash and append
+        to the next word */
+    if (word[word.length() - 1] == '-') {
+        word.erase(word.length() - 1);
+        wrapped.swap(word);
+    }
+    else {
+        /* Strip non-alpha chars at the start and end. Punctuation in
+            the middle gets kept. Note that this will strip out
+            numerics, which normally aren't high-frequency enough for
+            useful classifiation */
+        size_t firstChar = word.find_first_of(_letters);
+        if (firstChar != string::npos) {
+            size_t lastChar = word.find_last_of(_letters);
+            // If last two chars are apostophe-s, ignore them
+            if ((lastChar > 1) && (word[lastChar] == 's') &&
+                (word[lastChar - 1]) == '\'')
+                lastChar -= 2;
+            if (lastChar >= firstChar) {
+                if ((firstChar > 0) || (lastChar < word.length() - 1))
+                    word = word.substr(firstChar, lastChar - firstChar + 1);
+
+                /* Test the word against the stopword list. If not found, keep it
+                    to be converted to its stem */
+                if (!_stopwords.isStopword(word))
+                    tokens.push_back(word);
+            } // Wanted letters in word
+        } // Found a letter in the word
+        // else word has no letters, ignore
+    } // Word did not wrap to the next line
+}
+
+// Orders positions in a document word table by their words
+class WordOrder
+{
+public:
+    explicit WordOrder(const vector<DocumentWordTable::Entry>& entries) : _entries(entries) {}
+
+    bool operator()(unsigned int first, unsigned int second) const
+    {
+        return _entries[first].first < _entries[second].first;
+    }
+
+private:
+    const vector<DocumentWordTable::Entry>& _entries;
+};
+
+// Return the slot holding a word, or the empty slot where it belongs
+size_t DocumentWordTable::findSlot(const string& word, unsigned long long hash) const
+{
+    size_t mask = _slots.size() - 1;
+    size_t slot = (size_t)((hash * 0x9E3779B97F4A7C15ULL) >> 32) & mask;
+    while ((_slots[slot] != 0) &&
+           ((_hashes[_slots[slot] - 1] != hash) || (_entries[_slots[slot] - 1].first != word)))
+        slot = (slot + 1) & mask;
+    return slot;
+}
+
+// Recreate the index with the passed number of slots
+void DocumentWordTable::rebuild(size_t slotCount)
+{
+    _slots.assign(slotCount, 0);
+    size_t position;
+    for (position = 0; position < _used; position++)
+        _slots[findSlot(_entries[position].first, _hashes[position])] =
+            (unsigned int)(position + 1);
+}
+
+// Add a word into the table
+void DocumentWordTable::addWord(const string& word)
+{
+    if ((_used + 1) * 2 > _slots.size())
+        rebuild(_slots.empty() ? 64 : _slots.size() * 2);
+    unsigned long long hash = hashWord(word);
+    size_t slot = findSlot(word, hash);
+    if (_slots[slot] == 0) {
+        if ((unsigned int)(_used + 1) != _used + 1)
+            THROW_BASE_EXCEPTION("Error, too many words for the table");
+        if (_used == _entries.size()) {
+            _entries.push_back(Entry());
+            _hashes.push_back(0);
+        }
+        // Reuses the room already in the string
+        _entries[_used].first.assign(word);
+        _entries[_used].second = 0;
+        _hashes[_used] = hash;
+        _used++;
+        _slots[slot] = (unsigned int)_used;
+    }
+    addCountChecked(_entries[_slots[slot] - 1].second, 1U);
+}
+
+// Put the words in word order for iterating
+void DocumentWordTable::sortWords()
+{
+    _order.clear();
+    size_t position;
+    for (position = 0; position < _used; position++)
+        _order.push_back((unsigned int)position);
+    sort(_order.begin(), _order.end(), WordOrder(_entries));
+}
+
+void DocumentWordTable::clear()
+{
+    _used = 0;
+    _order.clear();
+    // Keep the index and entries, so a table reused for each document doesn't grow them again
+    _slots.assign(_slots.size(), 0);
+}
@@ -27,73 +27,510 @@
     the document */
 #include <string>
 #include <map>
+#include <vector>
+#include <sstream>
 #include "stopwords.h"
+#include "baseException.h"
 
 using std::string;
 using std::map;
+using std::vector;
+using std::pair;
 
-/* This is a wrapper around the standard word map, with some additional
-    methods for ease of handling. */
-// Assume not dealing with War and Peace, so a short should be plenty
-class DocumentWordMap : public map<string, unsigned short>
+/* Add a count to a total, throwing if the total would wrap around. Training
+    on huge document sets must fail loudly rather than silently corrupt the
+    counts */
+template <class TotalType, class CountType>
+inline void addCountChecked(TotalType& total, CountType count)
 {
-private:
-    // Add a count for the given word into the map
-    void addWordCount(const string& word, unsigned short count);
+    TotalType newTotal = total + (TotalType)count;
+    if ((newTotal < total) || ((CountType)(TotalType)count != count))
+        THROW_BASE_EXCEPTION("Error, word or document count too large for its counter");
+    total = newTotal;
+}
 
+/* Hash a word with FNV-1a, for tables indexed by word instead of holding
+    the words themselves */
+inline unsigned long long hashWord(const string& word)
+{
+    unsigned long long hash = 14695981039346656037ULL;
+    string::const_iterator index;
+    for (index = word.begin(); index != word.end(); index++) {
+        hash ^= (unsigned char)*index;
+        hash *= 1099511628211ULL;
+    }
+    return hash;
+}
+
+/* Remove a count from a total, throwing if more is removed than was added.
+    Used to back documents out of totals they were added to */
+template <class TotalType, class CountType>
+inline void subtractCountChecked(TotalType& total, CountType count)
+{
+    if ((TotalType)count > total || ((CountType)(TotalType)count != count))
+        THROW_BASE_EXCEPTION("Error, removing more words or documents than were counted");
+    total -= (TotalType)count;
+}
+
+/* This is a wrapper around the standard word map, with some additional
+    methods for ease of handling. The count type is a parameter so single
+    documents can use compact counts while totals over a whole training set
+    use wide ones */
+template <class CountType>
+class WordCountMap : public map<string, CountType>
+{
 public:
     // Use default constuctor, destructor, and copy operator
 
     // Add a word into the map
     void addWord(const string& word);
 
+    // Add a count for the given word into the map
+    void addWordCount(const string& word, CountType count);
+
     // Return the total word count of the map
-    unsigned int getTotalWordCount() const;
+    unsigned long long getTotalWordCount() const;
 
     // Merge another word map into this one
-    void mergeMap(const DocumentWordMap& other);
+    template <class OtherCountType>
+    void mergeMap(const WordCountMap<OtherCountType>& other);
+
+    /* Remove the counts of another word map previously merged into this one.
+        Words whose count drops to zero are removed */
+    template <class OtherCountType>
+    void subtractMap(const WordCountMap<OtherCountType>& other);
 
     // Return a atring containing all data in the map
     // WARNING: Likely to be huge
     string allMapData() const;
 };
 
+/* Word counts for a single document. Assume not dealing with War and Peace
+    a few thousand times over, so 32 bits is plenty */
+typedef WordCountMap<unsigned int> DocumentWordMap;
+
+// Word counts over all the training documents in a category
+typedef WordCountMap<unsigned long long> CategoryWordMap;
+
 // Add a count for the given word into the map
-inline void DocumentWordMap::addWordCount(const string& word, unsigned short count)
+template <class CountType>
+inline void WordCountMap<CountType>::addWordCount(const string& word, CountType count)
 {
-    DocumentWordMap::iterator entry = lower_bound(word);
-    if (entry != end() && (entry->first == word)) // Already present
-        entry->second += count;
+    typename WordCountMap::iterator entry = this->lower_bound(word);
+    if (entry != this->end() && (entry->first == word)) // Already present
+        addCountChecked(entry->second, count);
     else
         // lower_bound returned where the new word should be inserted
-        insert(entry, make_pair(word, count));
+        this->insert(entry, make_pair(word, count));
 }
 
 // Add a word into the map
-inline void DocumentWordMap::addWord(const string& word)
+template <class CountType>
+inline void WordCountMap<CountType>::addWord(const string& word)
 {
     addWordCount(word, 1);
 }
 
+// Return the total word count of the map
+template <class CountType>
+unsigned long long WordCountMap<CountType>::getTotalWordCount() const
+{
+    unsigned long long result = 0;
+    typename WordCountMap::const_iterator index;
+    for (index = this->begin(); index != this->end(); index++)
+        addCountChecked(result, index->second);
+    return result;
+}
+
 // Merge another word map into this one
-inline void DocumentWordMap::mergeMap(const DocumentWordMap& other)
+template <class CountType>
+template <class OtherCountType>
+inline void WordCountMap<CountType>::mergeMap(const WordCountMap<OtherCountType>& other)
+{
+    typename WordCountMap<OtherCountType>::const_iterator index;
+    for (index = other.begin(); index != other.end(); index++) {
+        // The other map may be wider, so check the count fits before adding
+        CountType count = (CountType)index->second;
+        if ((OtherCountType)count != index->second)
+            THROW_BASE_EXCEPTION("Error, word count too large to merge");
+        addWordCount(index->first, count);
+    }
+}
+
+// Remove the counts of another word map previously merged into this one
+template <class CountType>
+template <class OtherCountType>
+inline void WordCountMap<CountType>::subtractMap(const WordCountMap<OtherCountType>& other)
+{
+    typename WordCountMap<OtherCountType>::const_iterator index;
+    for (index = other.begin(); index != other.end(); index++) {
+        typename WordCountMap::iterator entry = this->find(index->first);
+        if (entry == this->end())
+            THROW_BASE_EXCEPTION("Error, removing a word that was not counted");
+        subtractCountChecked(entry->second, index->second);
+        if (entry->second == 0)
+            this->erase(entry);
+    }
+}
+
+// Return a atring containing all data in the map
+// WARNING: Likely to be huge
+template <class CountType>
+string WordCountMap<CountType>::allMapData() const
+{
+    std::ostringstream buffer;
+    typename WordCountMap::const_iterator index;
+    for (index = this->begin(); index != this->end(); index++)
+        buffer << index->first << ":" << index->second << " ";
+    return buffer.str();
+}
+
+/* This class counts pairs of neighbouring stems. Each stem is reduced to a
+    32 bit term ID from its hash, and a pair is the two IDs packed into a 64
+    bit key, so no strings are stored. Pairs are far more numerous than words,
+    so instead of a map the keys and values are held in one array, found
+    through an open addressed index of their positions. The value type is a
+    parameter, for counts and for probabilities */
+template <class ValueType>
+class BigramTable
+{
+public:
+    typedef pair<unsigned long long, ValueType> Entry;
+    typedef typename vector<Entry>::const_iterator const_iterator;
+
+    BigramTable() : _entries(), _slots() {}
+
+    // Use default copy constructor, assignment operator, and destructor
+
+    // Return the term ID of a stem
+    static unsigned int getTermId(const string& stem)
+    {
+        unsigned long long hash = hashWord(stem);
+        return (unsigned int)(hash ^ (hash >> 32));
+    }
+
+    // Return the key of a pair of stems, from their term IDs
+    static unsigned long long makeKey(unsigned int first, unsigned int second)
+    {
+        return ((unsigned long long)first << 32) | second;
+    }
+
+    /* Add a count for the given pair, inserting it if not present. Throws if
+        the count overflows */
+    template <class CountType>
+    void addCount(unsigned long long key, CountType count);
+
+    // Set the value for the given pair, inserting it if not present
+    void setValue(unsigned long long key, ValueType value);
+
+    // Return the value for the given pair, or NULL if not present
+    const ValueType* find(unsigned long long key) const;
+
+    // Add the counts of another table into this one
+    template <class OtherType>
+    void mergeTable(const BigramTable<OtherType>& other);
+
+    // Remove every pair with a value under the passed minimum
+    void removeBelow(ValueType minimum);
+
+    // Remove every pair not in the passed table
+    template <class OtherType>
+    void keepOnly(const BigramTable<OtherType>& keys);
+
+    // Sum of all the values
+    unsigned long long getTotal() const;
+
+    void clear();
+    size_t size() const { return _entries.size(); }
+    bool empty() const { return _entries.empty(); }
+
+    // Pairs in the order they were added
+    const_iterator begin() const { return _entries.begin(); }
+    const_iterator end() const { return _entries.end(); }
+
+private:
+    vector<Entry> _entries;
+
+    /* Position in the entries of each pair plus one, or zero if the slot is
+        empty. Always a power of two in size and at most half full, so
+        searches are short */
+    vector<unsigned int> _slots;
+
+    // Return the slot holding a key, or the empty slot where it belongs
+    size_t findSlot(unsigned long long key) const;
+
+    // Return the position of a key in the entries, adding it if needed
+    size_t getPosition(unsigned long long key);
+
+    // Recreate the index after the entries change
+    void rebuild(size_t slotCount);
+};
+
+// Pair counts for a single document
+typedef BigramTable<unsigned int> DocumentBigrams;
+
+// Pair counts over all the training documents in a category
+typedef BigramTable<unsigned long long> CategoryBigrams;
+
+// Return the slot holding a key, or the empty slot where it belongs
+template <class ValueType>
+inline size_t BigramTable<ValueType>::findSlot(unsigned long long key) const
+{
+    // Keys come from hashes, but mix them anyway so the low bits vary
+    size_t mask = _slots.size() - 1;
+    size_t slot = (size_t)((key * 0x9E3779B97F4A7C15ULL) >> 32) & mask;
+    while ((_slots[slot] != 0) && (_entries[_slots[slot] - 1].first != key))
+        slot = (slot + 1) & mask;
+    return slot;
+}
+
+// Return the position of a key in the entries, adding it if needed
+template <class ValueType>
+inline size_t BigramTable<ValueType>::getPosition(unsigned long long key)
+{
+    if ((_entries.size() + 1) * 2 > _slots.size())
+        rebuild(_slots.empty() ? 16 : _slots.size() * 2);
+    size_t slot = findSlot(key);
+    if (_slots[slot] == 0) {
+        if ((unsigned int)(_entries.size() + 1) != _entries.size() + 1)
+            THROW_BASE_EXCEPTION("Error, too many word pairs for the table");
+        _entries.push_back(Entry(key, ValueType()));
+        _slots[slot] = (unsigned int)_entries.size();
+    }
+    return _slots[slot] - 1;
+}
+
+// Recreate the index after the entries change
+template <class ValueType>
+void BigramTable<ValueType>::rebuild(size_t slotCount)
+{
+    _slots.assign(slotCount, 0);
+    size_t position;
+    for (position = 0; position < _entries.size(); position++)
+        _slots[findSlot(_entries[position].first)] = (unsigned int)(position + 1);
+}
+
+// Add a count for the given pair, inserting it if not present
+template <class ValueType>
+template <class CountType>
+inline void BigramTable<ValueType>::addCount(unsigned long long key, CountType count)
+{
+    addCountChecked(_entries[getPosition(key)].second, count);
+}
+
+// Set the value for the given pair, inserting it if not present
+template <class ValueType>
+inline void BigramTable<ValueType>::setValue(unsigned long long key, ValueType value)
 {
-    DocumentWordMap::const_iterator index;
+    _entries[getPosition(key)].second = value;
+}
+
+// Return the value for the given pair, or NULL if not present
+template <class ValueType>
+inline const ValueType* BigramTable<ValueType>::find(unsigned long long key) const
+{
+    if (_entries.empty())
+        return NULL;
+    size_t slot = findSlot(key);
+    if (_slots[slot] == 0)
+        return NULL;
+    return &_entries[_slots[slot] - 1].second;
+}
+
+// Add the counts of another table into this one
+template <class ValueType>
+template <class OtherType>
+void BigramTable<ValueType>::mergeTable(const BigramTable<OtherType>& other)
+{
+    typename BigramTable<OtherType>::const_iterator index;
     for (index = other.begin(); index != other.end(); index++)
-        addWordCount(index->first, index->second);
+        addCount(index->first, index->second);
 }
 
+// Remove every pair with a value under the passed minimum
+template <class ValueType>
+void BigramTable<ValueType>::removeBelow(ValueType minimum)
+{
+    size_t kept = 0;
+    size_t position;
+    for (position = 0; position < _entries.size(); position++)
+        if (!(_entries[position].second < minimum)) {
+            _entries[kept] = _entries[position];
+            kept++;
+        }
+    _entries.resize(kept);
+    rebuild(_slots.size());
+}
+
+// Remove every pair not in the passed table
+template <class ValueType>
+template <class OtherType>
+void BigramTable<ValueType>::keepOnly(const BigramTable<OtherType>& keys)
+{
+    size_t kept = 0;
+    size_t position;
+    for (position = 0; position < _entries.size(); position++)
+        if (keys.find(_entries[position].first) != NULL) {
+            _entries[kept] = _entries[position];
+            kept++;
+        }
+    _entries.resize(kept);
+    rebuild(_slots.size());
+}
+
+// Sum of all the values
+template <class ValueType>
+unsigned long long BigramTable<ValueType>::getTotal() const
+{
+    unsigned long long result = 0;
+    const_iterator index;
+    for (index = begin(); index != end(); index++)
+        addCountChecked(result, index->second);
+    return result;
+}
+
+template <class ValueType>
+inline void BigramTable<ValueType>::clear()
+{
+    _entries.clear();
+    // Keep the index, so tables reused for each document don't grow it again
+    _slots.assign(_slots.size(), 0);
+}
+
+/* Word counts for a single document, for callers that classify one document
+    after another and want to stop allocating once warmed up. Entries are
+    held in one array found through an open addressed index of their
+    positions, like BigramTable, keyed by the hash of the stem. Clearing the
+    table keeps its entries, so the text of a new stem is copied into a string
+    that already has room for it. Iterates in word order, the same as
+    DocumentWordMap, so scores add up identically */
+class DocumentWordTable
+{
+public:
+    typedef pair<string, unsigned int> Entry;
+
+    // Steps through the entries in word order, found by sortWords()
+    class const_iterator
+    {
+    public:
+        const_iterator() : _entries(NULL), _position() {}
+        const_iterator(const vector<Entry>* entries, vector<unsigned int>::const_iterator position)
+            : _entries(entries), _position(position) {}
+
+        // Use default copy constructor, assignment operator, and destructor
+
+        const Entry& operator*() const { return (*_entries)[*_position]; }
+        const Entry* operator->() const { return &(*_entries)[*_position]; }
+        const_iterator& operator++() { ++_position; return *this; }
+        const_iterator operator++(int)
+        {
+            const_iterator result(*this);
+            ++_position;
+            return result;
+        }
+        bool operator==(const const_iterator& other) const { return _position == other._position; }
+        bool operator!=(const const_iterator& other) const { return _position != other._position; }
+
+    private:
+        const vector<Entry>* _entries;
+        vector<unsigned int>::const_iterator _position;
+    };
+
+    DocumentWordTable() : _entries(), _hashes(), _used(0), _slots(), _order() {}
+
+    // Use default copy constructor, assignment operator, and destructor
+
+    // Add a word into the table. Throws if its count overflows
+    void addWord(const string& word);
+
+    /* Put the words in word order for iterating. Call after the last word is
+        added; adding more afterwards needs another call */
+    void sortWords();
+
+    void clear();
+    size_t size() const { return _used; }
+    bool empty() const { return _used == 0; }
+
+    // Words in the order found by sortWords()
+    const_iterator begin() const { return const_iterator(&_entries, _order.begin()); }
+    const_iterator end() const { return const_iterator(&_entries, _order.end()); }
+
+private:
+    /* Every entry ever used, and the hash of each word. Only the first used
+        hold this document, the rest are kept for their strings */
+    vector<Entry> _entries;
+    vector<unsigned long long> _hashes;
+    size_t _used;
+
+    /* Position in the entries of each word plus one, or zero if the slot is
+        empty. Always a power of two in size and at most half full */
+    vector<unsigned int> _slots;
+
+    // Positions of the used entries, in word order
+    vector<unsigned int> _order;
+
+    // Return the slot holding a word, or the empty slot where it belongs
+    size_t findSlot(const string& word, unsigned long long hash) const;
+
+    // Recreate the index with the passed number of slots
+    void rebuild(size_t slotCount);
+};
+
+class TokenScanner;
+
 class DocumentWordMapFactory {
 private:
     static const string _letters;
     const Stopwords& _stopwords;
 
+    /* Process one whitespace delimited token from a document, adding it to
+        the token list if wanted. Wrapped holds the start of a word hyphenated
+        at the end of the previous token */
+    void addToken(string& word, string& wrapped, vector<string>& tokens) const;
+
 public:
+    /* Version of the tokenizing rules. Change it whenever the rules change,
+        so results saved from a previous version are discarded */
+    static const unsigned int TokenizerVersion = 1;
+
     // Construct with the list of stopwords to use. Does not take ownership
     explicit DocumentWordMapFactory(const Stopwords& stopwords);
 
+    /* Return a value that changes whenever the results of converting a
+        document would change: a new stopword list, tokenizer or stemmer */
+    unsigned long long getCacheKey() const;
+
     // Convert the specified file into a document word map
     void getWordMap(const string& fileName, DocumentWordMap& wordMap) const;
+
+    // Convert a document already read into memory into a document word map
+    void getWordMap(const char* data, size_t length, DocumentWordMap& wordMap) const;
+
+    /* Convert a document already read into memory into the list of words
+        to classify it with, in document order. Words are lowercase with
+        stopwords removed, but not yet stemmed */
+    void getTokens(const char* data, size_t length, vector<string>& tokens) const;
+
+    // As above, with a scanner whose buffers are reused between documents
+    void getTokens(const char* data, size_t length, vector<string>& tokens,
+                   TokenScanner& scanner) const;
+
+    /* Convert words from getTokens() to their stems and count them into the
+        map. The words are overwritten */
+    static void addStems(vector<string>& tokens, DocumentWordMap& wordMap);
+
+    // As above, with working space for the stemmer that is reused between documents
+    static void addStems(vector<string>& tokens, DocumentWordMap& wordMap,
+                         vector<size_t>& syllables);
+
+    /* As above, counting into a table that is reused between documents. The
+        table is left sorted for iterating */
+    static void addStems(vector<string>& tokens, DocumentWordTable& wordTable,
+                         vector<size_t>& syllables);
+
+    /* Count each pair of neighbouring stems from addStems() into the table.
+        Each stem is hashed once, so the cost is linear in document length */
+    static void addBigrams(const vector<string>& stems, DocumentBigrams& bigrams);
 };
 
 #endif // DOCUMENT_WORD_MAP_FACTORY_H
@@ -0,0 +1,55 @@
+/* This file is part of BayseanClassifier. It classifies documents into
+    categories based on the classic Baysean classification algorithm.
+
+    Copyright (C) 2016   Ezra Erb
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License version 3 as published
+    by the Free Software Foundation.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+    I'd appreciate a note if you find this program useful or make
+    updates. Please contact me through LinkedIn (my profile also has
+    a link to the code depository)
+*/
+#include <string>
+#include <vector>
+#include <map>
+#include <utility>
+#include <mutex>
+#include "duplicateFinder.h"
+
+using namespace std;
+
+DuplicateFinder::DuplicateFinder()
+    : _seen(), _duplicates()
+{}
+
+// Record the contents of a document, and return true if they were seen before
+bool DuplicateFinder::add(const string& group, unsigned long long contentHash, size_t position,
+                          size_t& original)
+{
+    pair<string, unsigned long long> key(group, contentHash);
+    lock_guard<mutex> guard(_lock);
+    pair<map<pair<string, unsigned long long>, size_t>::iterator, bool> entry =
+        _seen.insert(make_pair(key, position));
+    if (entry.second)
+        return false;
+    original = entry.first->second;
+    _duplicates.push_back(make_pair(position, original));
+    return true;
+}
+
+// Copies found so far, with the documents they copy
+vector<pair<size_t, size_t> > DuplicateFinder::getDuplicates() const
+{
+    lock_guard<mutex> guard(_lock);
+    return _duplicates;
+}
@@ -0,0 +1,72 @@
+#ifndef DUPLICATE_FINDER_H
+#define DUPLICATE_FINDER_H
+
+/* This file is part of BayseanClassifier. It classifies documents into
+    categories based on the classic Baysean classification algorithm.
+
+    Copyright (C) 2016   Ezra Erb
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License version 3 as published
+    by the Free Software Foundation.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+    I'd appreciate a note if you find this program useful or make
+    updates. Please contact me through LinkedIn (my profile also has
+    a link to the code depository)
+*/
+#include <string>
+#include <vector>
+#include <map>
+#include <utility>
+#include <mutex>
+
+using std::string;
+using std::vector;
+using std::map;
+using std::pair;
+
+/* This class finds documents whose contents are exact copies of one seen
+    earlier, such as cross-posts and mirrored files, from the hash of their
+    contents. Documents are grouped, and only copies within the same group
+    count, so training can drop copies within a category while keeping a
+    document posted to two categories in both.
+
+    Contents are compared by their 64 bit hash only. The chance of two
+    different documents sharing one is negligible for any real collection.
+    Safe to call from many threads at once */
+class DuplicateFinder
+{
+public:
+    DuplicateFinder();
+
+    // Use default destructor
+
+    /* Record the contents of a document, identified by its position in a file
+        list. Returns true if a document with the same contents was already
+        recorded in the group, and sets original to its position */
+    bool add(const string& group, unsigned long long contentHash, size_t position,
+             size_t& original);
+
+    /* Copies found so far, as pairs of the position of the copy and of the
+        document it copies */
+    vector<pair<size_t, size_t> > getDuplicates() const;
+
+private:
+    map<pair<string, unsigned long long>, size_t> _seen;
+    vector<pair<size_t, size_t> > _duplicates;
+    mutable std::mutex _lock;
+
+    // Make non-copyable, the lock can not be copied
+    DuplicateFinder(const DuplicateFinder& other);
+    DuplicateFinder& operator=(const DuplicateFinder& other);
+};
+
+#endif // DUPLICATE_FINDER_H
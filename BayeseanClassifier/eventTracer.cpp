@@ -0,0 +1,410 @@
+/* This file is part of BayseanClassifier. It classifies documents into
+    categories based on the classic Baysean classification algorithm.
+
+    Copyright (C) 2016   Ezra Erb
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License version 3 as published
+    by the Free Software Foundation.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+    I'd appreciate a note if you find this program useful or make
+    updates. Please contact me through LinkedIn (my profile also has
+    a link to the code depository)
+*/
+#include <string>
+#include <vector>
+#include <map>
+#include <algorithm>
+#include <sstream>
+#include <fstream>
+#include <ostream>
+#include <cstdlib>
+#include <cstddef>
+#include <atomic>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+#include <chrono>
+
+#include "eventTracer.h"
+#include "documentReader.h"
+#include "varintCoding.h"
+#include "baseException.h"
+
+using namespace std;
+
+const size_t EventTracer::DefaultCapacity;
+const unsigned int EventTracer::WriteInterval;
+
+static const char TraceMagic[] = "BCTR";
+static const unsigned long long TraceVersion = 1;
+
+// Record types in the trace file
+enum TraceRecordType { RunNameRecord, DocumentNameRecord, CategoryNameRecord, EventRecord,
+                       DroppedRecord };
+
+static const char* EventNames[] = {"read", "cache-hit", "duplicate", "tokenize", "stem", "score",
+                                   "classify"};
+
+// What the value of each event counts, for dumps
+static const char* ValueNames[] = {"bytes", "bytes", "bytes", "words", "stems", "stems",
+                                   "category"};
+
+static const char TraceCorrupt[] = "Error, trace file is truncated or corrupt";
+
+// Positions map to slots with a mask, so round the capacity up to a power of two
+static size_t getSlotMask(size_t capacity)
+{
+    size_t slotCount = 2;
+    while (slotCount < capacity)
+        slotCount <<= 1;
+    return slotCount - 1;
+}
+
+// Trace into the passed file, replacing it
+EventTracer::EventTracer(const string& fileName, size_t capacity)
+    : _start(chrono::steady_clock::now()), _slots(new Slot[getSlotMask(capacity) + 1]),
+      _mask(getSlotMask(capacity)), _nextWrite(0), _nextRead(0),
+      _dropped(0), _runCount(0), _pendingNames(), _file(), _stopping(false), _finished(false),
+      _failed(false)
+{
+    int index;
+    for (index = 0; index < TraceEventCount; index++)
+        _thresholds[index] = 0;
+
+    size_t slot;
+    for (slot = 0; slot <= _mask; slot++)
+        _slots[slot]._sequence.store(slot, memory_order_relaxed);
+
+    _file.open(fileName.c_str(), ios_base::out | ios_base::binary | ios_base::trunc);
+    if (!_file.is_open()) {
+        stringstream errorMessage;
+        errorMessage << "Error, could not create trace file " << fileName;
+        THROW_BASE_EXCEPTION(errorMessage.str().c_str());
+    }
+    string header(TraceMagic, 4);
+    appendNumber(header, TraceVersion);
+    _file.write(header.data(), header.length());
+
+    _thread = thread(&EventTracer::writeWorker, this);
+}
+
+// Stops the writer thread
+EventTracer::~EventTracer()
+{
+    try {
+        stopThread();
+    }
+    catch (...) {
+        // Destructors must not throw, and finish() reports any failure
+    }
+}
+
+// Set the share of documents traced for one event, from 0 to 1
+void EventTracer::setRate(TraceEvent event, double rate)
+{
+    if (rate < 0.0)
+        rate = 0.0;
+    else if (rate > 1.0)
+        rate = 1.0;
+    // A rate of 1 gives 2^32, above every hash
+    _thresholds[event] = (unsigned long long)(rate * 4294967296.0);
+}
+
+// Update the rates of events from a comma separated list of rates
+bool EventTracer::parseRates(const string& rateList, vector<double>& rates)
+{
+    rates.resize(TraceEventCount, 0.0);
+    size_t start = 0;
+    while (start <= rateList.length()) {
+        size_t end = rateList.find(',', start);
+        if (end == string::npos)
+            end = rateList.length();
+        string item(rateList, start, end - start);
+        start = end + 1;
+
+        int event = TraceEventCount; // For every event
+        size_t equals = item.find('=');
+        if (equals != string::npos) {
+            for (event = 0; event < TraceEventCount; event++)
+                if (item.compare(0, equals, getEventName((TraceEvent)event)) == 0)
+                    break;
+            if (event == TraceEventCount)
+                return false;
+            item.erase(0, equals + 1);
+        }
+        char* numberEnd = NULL;
+        double rate = strtod(item.c_str(), &numberEnd);
+        if (item.empty() || (*numberEnd != '\0') || (!(rate >= 0.0)) || (rate > 1.0))
+            return false;
+        if (event == TraceEventCount)
+            fill(rates.begin(), rates.end(), rate);
+        else
+            rates[event] = rate;
+    }
+    return true;
+}
+
+// Start tracing a run of documents, and return its number
+unsigned int EventTracer::beginRun(const string& name, const vector<string>& fileList)
+{
+    // A document is sampled for some event if it is below the highest threshold
+    unsigned long long threshold = 0;
+    int event;
+    for (event = 0; event < TraceEventCount; event++)
+        threshold = max(threshold, _thresholds[event]);
+
+    lock_guard<mutex> guard(_lock);
+    unsigned int run = _runCount;
+    _runCount++;
+    appendNumber(_pendingNames, RunNameRecord);
+    appendNumber(_pendingNames, run);
+    appendString(_pendingNames, name);
+    size_t document;
+    for (document = 0; document < fileList.size(); document++)
+        if (sampleHash(run, document) < threshold) {
+            appendNumber(_pendingNames, DocumentNameRecord);
+            appendNumber(_pendingNames, run);
+            appendNumber(_pendingNames, document);
+            appendString(_pendingNames, fileList[document]);
+        }
+    return run;
+}
+
+// Record the names of the categories classification can choose, in ID order
+void EventTracer::addCategories(const vector<string>& categories)
+{
+    lock_guard<mutex> guard(_lock);
+    size_t index;
+    for (index = 0; index < categories.size(); index++) {
+        appendNumber(_pendingNames, CategoryNameRecord);
+        appendNumber(_pendingNames, index);
+        appendString(_pendingNames, categories[index]);
+    }
+}
+
+/* Put a sampled event in the ring buffer, or count it dropped if full.
+    Each slot's sequence number equals the position that may fill it next;
+    filling sets it one higher, and the writer emptying it moves it a full
+    lap ahead. A producer claims a position by moving the next write
+    position past it, so producers never wait on each other or the writer */
+void EventTracer::addRecord(TraceEvent event, unsigned int run, size_t document,
+                            unsigned long long value, double seconds)
+{
+    size_t position = _nextWrite.load(memory_order_relaxed);
+    Slot* slot;
+    while (true) {
+        slot = &_slots[position & _mask];
+        size_t sequence = slot->_sequence.load(memory_order_acquire);
+        if (sequence == position) {
+            if (_nextWrite.compare_exchange_weak(position, position + 1, memory_order_relaxed))
+                break;
+            // Another producer claimed it, and position now holds the next free one
+        }
+        else if ((ptrdiff_t)(sequence - position) < 0) {
+            // The writer has not emptied this slot from the last lap, so the buffer is full
+            _dropped.fetch_add(1, memory_order_relaxed);
+            return;
+        }
+        else
+            position = _nextWrite.load(memory_order_relaxed);
+    }
+
+    Record& record = slot->_record;
+    record._time = (unsigned long long)chrono::duration_cast<chrono::microseconds>(
+        chrono::steady_clock::now() - _start).count();
+    record._value = value;
+    record._document = document;
+    record._run = run;
+    double micros = seconds * 1e6 + 0.5;
+    record._micros = micros < 4294967295.0 ? (unsigned int)micros : 0xFFFFFFFFU;
+    record._event = (unsigned short)event;
+    slot->_sequence.store(position + 1, memory_order_release);
+}
+
+// Events dropped so far because the buffer was full
+unsigned long long EventTracer::getDropped() const
+{
+    return _dropped.load(memory_order_relaxed);
+}
+
+// Take everything out of the ring buffer and write it to the file
+void EventTracer::drain()
+{
+    /* Names are added before the events for their documents, so take them
+        first. The dump does not need them in order anyway */
+    string data;
+    {
+        lock_guard<mutex> guard(_lock);
+        data.swap(_pendingNames);
+    }
+    while (true) {
+        Slot& slot = _slots[_nextRead & _mask];
+        // Stop at the first slot not yet filled, even if later ones are
+        if (slot._sequence.load(memory_order_acquire) != _nextRead + 1)
+            break;
+        Record record = slot._record;
+        slot._sequence.store(_nextRead + _mask + 1, memory_order_release);
+        _nextRead++;
+
+        appendNumber(data, EventRecord);
+        appendNumber(data, record._event);
+        appendNumber(data, record._run);
+        appendNumber(data, record._document);
+        appendNumber(data, record._time);
+        appendNumber(data, record._micros);
+        appendNumber(data, record._value);
+    }
+    if (!data.empty()) {
+        _file.write(data.data(), data.length());
+        if (_file.fail())
+            _failed = true;
+    }
+}
+
+// Thread body, which drains the buffer every write interval until stopped
+void EventTracer::writeWorker()
+{
+    try {
+        unique_lock<mutex> guard(_lock);
+        while (!_stopping) {
+            _stopped.wait_for(guard, chrono::milliseconds(WriteInterval));
+            guard.unlock();
+            drain();
+            guard.lock();
+        }
+    }
+    catch (...) {
+        _failed = true;
+    }
+}
+
+// Stop the writer thread once it has written everything
+void EventTracer::stopThread()
+{
+    {
+        lock_guard<mutex> guard(_lock);
+        _stopping = true;
+    }
+    _stopped.notify_all();
+    if (_thread.joinable())
+        _thread.join();
+}
+
+// Write out everything recorded and stop
+void EventTracer::finish()
+{
+    if (_finished)
+        return;
+    _finished = true;
+    stopThread();
+    // Events recorded after the last pass of the thread
+    drain();
+    string data;
+    appendNumber(data, DroppedRecord);
+    appendNumber(data, getDropped());
+    _file.write(data.data(), data.length());
+    _file.close();
+    if (_failed || _file.fail())
+        THROW_BASE_EXCEPTION("Error, could not write trace file");
+}
+
+// Return the name of an event
+const char* EventTracer::getEventName(TraceEvent event)
+{
+    return EventNames[event];
+}
+
+// Print the contents of a trace file as text
+void EventTracer::dump(const string& fileName, ostream& output)
+{
+    string data;
+    DocumentReader::readFile(fileName, data);
+    if ((data.length() < 4) || (data.compare(0, 4, TraceMagic) != 0))
+        THROW_BASE_EXCEPTION("Error, file is not a trace file");
+    size_t pos = 4;
+    if (parseNumber(data, pos, TraceCorrupt) != TraceVersion)
+        THROW_BASE_EXCEPTION("Error, trace file has an unsupported format version");
+
+    // Names can come after the events that use them, so collect everything first
+    map<unsigned long long, string> runNames;
+    map<pair<unsigned long long, unsigned long long>, string> documentNames;
+    map<unsigned long long, string> categoryNames;
+    vector<Record> events;
+    unsigned long long dropped = 0;
+    while (pos < data.length()) {
+        unsigned long long type = parseNumber(data, pos, TraceCorrupt);
+        if (type == RunNameRecord) {
+            unsigned long long run = parseNumber(data, pos, TraceCorrupt);
+            parseString(data, pos, runNames[run], TraceCorrupt);
+        }
+        else if (type == DocumentNameRecord) {
+            unsigned long long run = parseNumber(data, pos, TraceCorrupt);
+            unsigned long long document = parseNumber(data, pos, TraceCorrupt);
+            parseString(data, pos, documentNames[make_pair(run, document)], TraceCorrupt);
+        }
+        else if (type == CategoryNameRecord) {
+            unsigned long long category = parseNumber(data, pos, TraceCorrupt);
+            parseString(data, pos, categoryNames[category], TraceCorrupt);
+        }
+        else if (type == EventRecord) {
+            Record record;
+            unsigned long long event = parseNumber(data, pos, TraceCorrupt);
+            if (event >= TraceEventCount)
+                THROW_BASE_EXCEPTION(TraceCorrupt);
+            record._event = (unsigned short)event;
+            record._run = (unsigned int)parseNumber(data, pos, TraceCorrupt);
+            record._document = (size_t)parseNumber(data, pos, TraceCorrupt);
+            record._time = parseNumber(data, pos, TraceCorrupt);
+            record._micros = (unsigned int)parseNumber(data, pos, TraceCorrupt);
+            record._value = parseNumber(data, pos, TraceCorrupt);
+            events.push_back(record);
+        }
+        else if (type == DroppedRecord)
+            dropped += parseNumber(data, pos, TraceCorrupt);
+        else
+            THROW_BASE_EXCEPTION(TraceCorrupt);
+    }
+
+    /* Events are written as threads finish them, so put them in time order.
+        Events at the same time stay in the order written */
+    vector<pair<unsigned long long, size_t> > order;
+    size_t index;
+    for (index = 0; index < events.size(); index++)
+        order.push_back(make_pair(events[index]._time, index));
+    sort(order.begin(), order.end());
+
+    vector<pair<unsigned long long, size_t> >::const_iterator orderIndex;
+    for (orderIndex = order.begin(); orderIndex != order.end(); orderIndex++) {
+        const Record& record = events[orderIndex->second];
+        output << record._time << " us " << runNames[record._run] << " "
+               << getEventName((TraceEvent)record._event) << " ";
+        map<pair<unsigned long long, unsigned long long>, string>::const_iterator name =
+            documentNames.find(make_pair((unsigned long long)record._run,
+                                         (unsigned long long)record._document));
+        if (name != documentNames.end())
+            output << name->second;
+        else
+            output << "#" << record._document;
+        if (record._event != TraceClassify)
+            output << " took " << record._micros << " us";
+        output << " " << ValueNames[record._event] << " ";
+        map<unsigned long long, string>::const_iterator category =
+            categoryNames.find(record._value);
+        if ((record._event == TraceClassify) && (category != categoryNames.end()))
+            output << category->second;
+        else
+            output << record._value;
+        output << '\n';
+    }
+    if (dropped > 0)
+        output << "Events dropped, buffer full: " << dropped << '\n';
+}
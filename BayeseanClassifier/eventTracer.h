@@ -0,0 +1,221 @@
+#ifndef EVENT_TRACER_H
+#define EVENT_TRACER_H
+
+/* This file is part of BayseanClassifier. It classifies documents into
+    categories based on the classic Baysean classification algorithm.
+
+    Copyright (C) 2016   Ezra Erb
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License version 3 as published
+    by the Free Software Foundation.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+    I'd appreciate a note if you find this program useful or make
+    updates. Please contact me through LinkedIn (my profile also has
+    a link to the code depository)
+*/
+#include <string>
+#include <vector>
+#include <ostream>
+#include <fstream>
+#include <atomic>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+#include <chrono>
+#include <memory>
+
+using std::string;
+using std::vector;
+using std::ostream;
+
+/* Records a trace event if tracing is on. Building with
+    BAYESEAN_CLASSIFIER_NO_EVENT_TRACE removes every call, so tracing then
+    costs nothing at all */
+#ifdef BAYESEAN_CLASSIFIER_NO_EVENT_TRACE
+#define TRACE_EVENT(tracer, event, run, document, value, seconds) do {} while (0)
+#else
+#define TRACE_EVENT(tracer, event, run, document, value, seconds) \
+    do { \
+        if ((tracer) != NULL) \
+            (tracer)->record(event, run, document, value, seconds); \
+    } while (0)
+#endif
+
+// Events that can be traced for a document
+enum TraceEvent {
+    TraceRead,      // Read from its file. Value is its bytes
+    TraceCacheHit,  // Taken from the document cache. Value is its bytes
+    TraceDuplicate, // Found to be a copy of an earlier document. Value is its bytes
+    TraceTokenize,  // Split into words. Value is the number of words
+    TraceStem,      // Converted to stems. Value is the number of distinct stems
+    TraceScore,     // Given to training or classification. Value is the number of distinct stems
+    TraceClassify,  // Classified. Value is the category ID
+    TraceEventCount
+};
+
+/* This class records what happens to a sample of the documents processed,
+    for finding out where the time goes in production without the all or
+    nothing flood of --trace-info.
+
+    Each event is a small fixed size record, put in a ring buffer without
+    locks. A background thread drains the buffer to the trace file every
+    so often, so the threads processing documents never wait on I/O. If
+    the buffer fills up anyway, events are dropped and counted rather than
+    slowing processing down.
+
+    Each event has its own sampling rate. Documents are picked by a hash of
+    their run and position, so a document sampled for one event is also
+    sampled for every event with the same or a higher rate, and its whole
+    history is in the trace. Skipping a document not sampled costs a hash
+    and a compare.
+
+    File format, with all numbers as variable length integers, seven bits a
+    byte with the high bit set if more follow, and strings as a length and
+    the bytes:
+        magic "BCTR", format version, then records, each starting with its type:
+        run name: run number, name
+        document name: run number, position in the run, path
+        category name: category ID, name
+        event: event, run number, position, microseconds since tracing
+            started when the event ended, microseconds it took, value
+        dropped: events dropped because the buffer was full
+    Names are only written for sampled documents. dump() prints a trace
+    file as text */
+class EventTracer
+{
+public:
+    // Events the ring buffer holds, a power of two
+    static const size_t DefaultCapacity = 1 << 16;
+
+    // Milliseconds between writes of the buffer to the file
+    static const unsigned int WriteInterval = 100;
+
+    /* Trace into the passed file, replacing it. Every event starts with a
+        sampling rate of zero. Throws if the file can not be created */
+    explicit EventTracer(const string& fileName, size_t capacity = DefaultCapacity);
+
+    // Stops the writer thread. Call finish() first to find write errors
+    ~EventTracer();
+
+    // Set the share of documents traced for one event, from 0 to 1
+    void setRate(TraceEvent event, double rate);
+
+    /* Update the rates of events, by event, from a comma separated list of
+        rates. Each is either a number for every event, or an event name, an
+        equals sign and a number for one. Later ones override earlier ones.
+        Returns false if the list is not valid */
+    static bool parseRates(const string& rateList, vector<double>& rates);
+
+    /* Start tracing a run of documents, and return its number for the
+        events of its documents. Records the names of the documents sampled */
+    unsigned int beginRun(const string& name, const vector<string>& fileList);
+
+    // Record the names of the categories classification can choose, in ID order
+    void addCategories(const vector<string>& categories);
+
+    /* Record one event for a document, if it is sampled. Safe to call from
+        any number of threads */
+    void record(TraceEvent event, unsigned int run, size_t document,
+                unsigned long long value, double seconds)
+    {
+        if (sampleHash(run, document) < _thresholds[event])
+            addRecord(event, run, document, value, seconds);
+    }
+
+    // Events dropped so far because the buffer was full
+    unsigned long long getDropped() const;
+
+    /* Write out everything recorded and stop. Throws if anything failed
+        to write */
+    void finish();
+
+    // Return the name of an event
+    static const char* getEventName(TraceEvent event);
+
+    // Print the contents of a trace file as text. Throws if it is corrupt
+    static void dump(const string& fileName, ostream& output);
+
+private:
+    // One event as held in the ring buffer
+    struct Record
+    {
+        unsigned long long _time;
+        unsigned long long _value;
+        size_t _document;
+        unsigned int _run;
+        unsigned int _micros;
+        unsigned short _event;
+    };
+
+    /* A place in the ring buffer. The sequence number says whether it is
+        free for the producer at that position, or filled for the writer */
+    struct Slot
+    {
+        std::atomic<size_t> _sequence;
+        Record _record;
+    };
+
+    /* Documents are sampled for an event when this hash is below its
+        threshold. Rates are scaled to 32 bits, so a rate of 1 passes all */
+    static unsigned long long sampleHash(unsigned int run, size_t document)
+    {
+        // Final mix of SplitMix64, so neighbouring documents are unrelated
+        unsigned long long hash = ((unsigned long long)run << 40) ^ (unsigned long long)document;
+        hash = (hash ^ (hash >> 30)) * 0xBF58476D1CE4E5B9ULL;
+        hash = (hash ^ (hash >> 27)) * 0x94D049BB133111EBULL;
+        return (hash ^ (hash >> 31)) & 0xFFFFFFFFULL;
+    }
+
+    unsigned long long _thresholds[TraceEventCount];
+
+    const std::chrono::steady_clock::time_point _start;
+
+    // The ring buffer
+    std::unique_ptr<Slot[]> _slots;
+    const size_t _mask;
+    std::atomic<size_t> _nextWrite;
+    size_t _nextRead;
+    std::atomic<unsigned long long> _dropped;
+
+    // Run numbers handed out so far
+    unsigned int _runCount;
+
+    // Encoded name records not yet written
+    string _pendingNames;
+
+    std::ofstream _file;
+    bool _stopping;
+    bool _finished;
+    bool _failed;
+    std::mutex _lock;
+    std::condition_variable _stopped;
+    std::thread _thread;
+
+    // Put a sampled event in the ring buffer, or count it dropped if full
+    void addRecord(TraceEvent event, unsigned int run, size_t document,
+                   unsigned long long value, double seconds);
+
+    // Take everything out of the ring buffer and write it to the file
+    void drain();
+
+    // Thread body, which drains the buffer every write interval until stopped
+    void writeWorker();
+
+    // Stop the writer thread once it has written everything
+    void stopThread();
+
+    // Make non-copyable, the thread refers to this object
+    EventTracer(const EventTracer& other);
+    EventTracer& operator=(const EventTracer& other);
+};
+
+#endif // EVENT_TRACER_H
@@ -115,3 +115,31 @@ void FileFinder::findFiles(const string& dirName, vector<string>& fileList,
     if (!foundSomething)
         cerr << "WARNING: File directoy " << dirName << " skipped, empty" << endl;
 }
+
+/* Get the size and last modification time of a file. Returns false
+    if the file does not exist */
+bool FileFinder::getFileStamp(const string& fileName, FileStamp& stamp)
+{
+    WIN32_FILE_ATTRIBUTE_DATA fileData;
+    if (!GetFileAttributesEx(fileName.c_str(), GetFileExInfoStandard, &fileData))
+        return false;
+    stamp._size = ((unsigned long long)fileData.nFileSizeHigh << 32) | fileData.nFileSizeLow;
+    stamp._modifiedTime = ((unsigned long long)fileData.ftLastWriteTime.dwHighDateTime << 32) |
+        fileData.ftLastWriteTime.dwLowDateTime;
+    return true;
+}
+
+// Create a new empty file in the temporary directory and return its name
+string FileFinder::createTempFile()
+{
+    char tempDir[MAX_PATH];
+    char fileName[MAX_PATH];
+    DWORD length = GetTempPath(MAX_PATH, tempDir);
+    if ((length == 0) || (length > MAX_PATH) ||
+        (GetTempFileName(tempDir, "bcs", 0, fileName) == 0)) {
+        stringstream errorMessage;
+        errorMessage << "Error, could not create a temporary file";
+        THROW_BASE_EXCEPTION(errorMessage.str().c_str());
+    }
+    return string(fileName);
+}
@@ -33,6 +33,24 @@
 using std::string;
 using std::vector;
 
+// Identifies a version of a file, to tell if it changed since it was last seen
+struct FileStamp
+{
+    FileStamp() : _size(0), _modifiedTime(0) {}
+
+    // Use default copy constructor, copy operator and destructor
+
+    bool operator==(const FileStamp& other) const;
+
+    unsigned long long _size;
+    unsigned long long _modifiedTime;
+};
+
+inline bool FileStamp::operator==(const FileStamp& other) const
+{
+    return (_size == other._size) && (_modifiedTime == other._modifiedTime);
+}
+
 class FileFinder
 {
     public:
@@ -47,6 +65,14 @@ class FileFinder
         static void findFiles(const string& root, vector<string>& fileList,
                               short minLevel = 0, short maxLevel = SHRT_MAX);
 
+        /* Get the size and last modification time of a file. Returns false
+            if the file does not exist */
+        static bool getFileStamp(const string& fileName, FileStamp& stamp);
+
+        /* Create a new empty file in the temporary directory and return its
+            name. Throws if one can not be created */
+        static string createTempFile();
+
     private:
         // Find all files starting at a given point in the directoy tree
         static void findFiles(const string& dirName, vector<string>& fileList,
@@ -0,0 +1,162 @@
+/* This file is part of BayseanClassifier. It classifies documents into
+    categories based on the classic Baysean classification algorithm.
+
+    Copyright (C) 2016   Ezra Erb
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License version 3 as published
+    by the Free Software Foundation.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+    I'd appreciate a note if you find this program useful or make
+    updates. Please contact me through LinkedIn (my profile also has
+    a link to the code depository)
+*/
+#include <string>
+#include <fstream>
+#include <sstream>
+#include <cstring>
+
+#include "hashedModelFile.h"
+#include "baseException.h"
+#include "windows.h"
+
+using namespace std;
+
+const unsigned int HashedModelFile::Magic;
+const unsigned int HashedModelFile::Version;
+
+// Map a model file read only
+HashedModelFile::HashedModelFile(const string& fileName)
+    : _fileName(fileName), _file(INVALID_HANDLE_VALUE), _mapping(NULL), _data(NULL), _size(0),
+      _bucketCount(0)
+{
+    _file = CreateFile(fileName.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING,
+                       FILE_ATTRIBUTE_NORMAL, NULL);
+    LARGE_INTEGER fileSize;
+    if ((_file == INVALID_HANDLE_VALUE) || (!GetFileSizeEx(_file, &fileSize))) {
+        if (_file != INVALID_HANDLE_VALUE)
+            CloseHandle(_file);
+        stringstream errorMessage;
+        errorMessage << "Error, model file " << fileName << " could not be opened";
+        THROW_BASE_EXCEPTION(errorMessage.str().c_str());
+    }
+    _size = (size_t)fileSize.QuadPart;
+    if ((_size < 3 * sizeof(unsigned long long)) ||
+        ((unsigned long long)_size != (unsigned long long)fileSize.QuadPart)) {
+        CloseHandle(_file);
+        throwInvalid();
+    }
+    _mapping = CreateFileMapping(_file, NULL, PAGE_READONLY, 0, 0, NULL);
+    if (_mapping != NULL)
+        _data = (const char*)MapViewOfFile(_mapping, FILE_MAP_READ, 0, 0, 0);
+    if (_data == NULL) {
+        if (_mapping != NULL)
+            CloseHandle(_mapping);
+        CloseHandle(_file);
+        stringstream errorMessage;
+        errorMessage << "Error, model file " << fileName << " could not be mapped";
+        THROW_BASE_EXCEPTION(errorMessage.str().c_str());
+    }
+
+    const unsigned int* header = (const unsigned int*)_data;
+    const unsigned long long* counts = (const unsigned long long*)_data + 1;
+    if ((header[0] != Magic) || (header[1] != Version) || (counts[1] == 0) ||
+        (counts[1] > (_size / sizeof(double)))) {
+        UnmapViewOfFile(_data);
+        CloseHandle(_mapping);
+        CloseHandle(_file);
+        throwInvalid();
+    }
+    _bucketCount = (size_t)counts[1];
+}
+
+// Unmaps the file
+HashedModelFile::~HashedModelFile()
+{
+    UnmapViewOfFile(_data);
+    CloseHandle(_mapping);
+    CloseHandle(_file);
+}
+
+// Write the classifiers of every category to a model file
+void HashedModelFile::write(const string& fileName, const HashedClassifiers& classifiers)
+{
+    ofstream output(fileName.c_str(), ios_base::out | ios_base::trunc | ios_base::binary);
+    unsigned int header[2] = { Magic, Version };
+    unsigned long long counts[2] = { classifiers.size(), 0 };
+    if (!classifiers.empty())
+        counts[1] = classifiers.begin()->second.getBucketCount();
+    output.write((const char*)header, sizeof(header));
+    output.write((const char*)counts, sizeof(counts));
+
+    HashedClassifiers::const_iterator index;
+    for (index = classifiers.begin(); index != classifiers.end(); index++) {
+        unsigned long long nameLength = index->first.size();
+        output.write((const char*)&nameLength, sizeof(nameLength));
+        output.write(index->first.data(), index->first.size());
+        const char padding[sizeof(double)] = { 0 };
+        output.write(padding, (sizeof(double) - (index->first.size() % sizeof(double))) %
+                     sizeof(double));
+        double probabilities[2] = { index->second.getDocProbability(),
+                                    index->second.getEmptyBucketProbability() };
+        output.write((const char*)probabilities, sizeof(probabilities));
+        output.write((const char*)index->second.getBucketProbabilities(),
+                     index->second.getBucketCount() * sizeof(double));
+    }
+    output.close();
+    if (output.fail()) {
+        stringstream errorMessage;
+        errorMessage << "Error, could not write model file " << fileName;
+        THROW_BASE_EXCEPTION(errorMessage.str().c_str());
+    }
+}
+
+// Create a classifier for each category in the file
+void HashedModelFile::getClassifiers(HashedClassifiers& classifiers) const
+{
+    classifiers.clear();
+    unsigned long long categoryCount = ((const unsigned long long*)_data)[1];
+    size_t position = 3 * sizeof(unsigned long long);
+    unsigned long long category;
+    for (category = 0; category < categoryCount; category++) {
+        if (_size - position < sizeof(unsigned long long))
+            throwInvalid();
+        unsigned long long nameLength = *(const unsigned long long*)(_data + position);
+        position += sizeof(unsigned long long);
+        // Name rounded up to whole numbers, then the two probabilities and the buckets
+        unsigned long long nameSize = (nameLength + sizeof(double) - 1) / sizeof(double);
+        if ((nameLength > _size) ||
+            ((_size - position) / sizeof(double) < nameSize + 2 + _bucketCount))
+            throwInvalid();
+        string name(_data + position, (size_t)nameLength);
+        position += (size_t)nameSize * sizeof(double);
+        const double* probabilities = (const double*)(_data + position);
+        position += (2 + _bucketCount) * sizeof(double);
+        classifiers.insert(make_pair(name, HashedClassifier(probabilities[0], probabilities[1],
+                                                            probabilities + 2, _bucketCount)));
+    }
+    if (position != _size)
+        throwInvalid();
+}
+
+// Buckets in each classifier
+size_t HashedModelFile::getBucketCount() const
+{
+    return _bucketCount;
+}
+
+// Throw an error for a file that is not a valid model
+void HashedModelFile::throwInvalid() const
+{
+    stringstream errorMessage;
+    errorMessage << "Error, " << _fileName << " is not a valid model file";
+    THROW_BASE_EXCEPTION(errorMessage.str().c_str());
+}
@@ -0,0 +1,83 @@
+#ifndef HASHED_MODEL_FILE_H
+#define HASHED_MODEL_FILE_H
+
+/* This file is part of BayseanClassifier. It classifies documents into
+    categories based on the classic Baysean classification algorithm.
+
+    Copyright (C) 2016   Ezra Erb
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License version 3 as published
+    by the Free Software Foundation.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+    I'd appreciate a note if you find this program useful or make
+    updates. Please contact me through LinkedIn (my profile also has
+    a link to the code depository)
+*/
+#include <string>
+#include "classifier.h"
+
+using std::string;
+
+/* This class holds a hashed model in a file, so processes classifying with
+    the same model share one copy of it. Hashed classifiers are fixed size
+    tables of probabilities, so the file holds them exactly as they are in
+    memory, and a process maps it read only and scores straight from the
+    mapped pages. The operating system then keeps a single copy in memory
+    however many processes map it.
+
+    The file is written and read by the same program on the same machine, so
+    numbers are in native byte order. It starts with a magic number and
+    version, then the number of categories and of buckets. Each category
+    follows, with the length of its name, the name padded to a multiple of 8
+    bytes, its document probability, the probability of an empty bucket, and
+    the probability of every bucket. Everything is 8 bytes wide, so the
+    probabilities stay aligned */
+class HashedModelFile
+{
+public:
+    // Map a model file read only. Throws if it can not be read or is not a model file
+    explicit HashedModelFile(const string& fileName);
+
+    // Unmaps the file
+    ~HashedModelFile();
+
+    /* Write the classifiers of every category to a model file. Throws if it
+        can not be written */
+    static void write(const string& fileName, const HashedClassifiers& classifiers);
+
+    /* Create a classifier for each category in the file. They score from the
+        mapped file, so must not outlive this object */
+    void getClassifiers(HashedClassifiers& classifiers) const;
+
+    // Buckets in each classifier
+    size_t getBucketCount() const;
+
+private:
+    static const unsigned int Magic = 0x4D484342; // "BCHM"
+    static const unsigned int Version = 1;
+
+    string _fileName;
+    void* _file;
+    void* _mapping;
+    const char* _data;
+    size_t _size;
+    size_t _bucketCount;
+
+    // Throw an error for a file that is not a valid model
+    void throwInvalid() const;
+
+    // Make non-copyable, owns the mapping
+    HashedModelFile(const HashedModelFile& other);
+    HashedModelFile& operator=(const HashedModelFile& other);
+};
+
+#endif // HASHED_MODEL_FILE_H
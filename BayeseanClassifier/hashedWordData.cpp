@@ -0,0 +1,84 @@
+/* This file is part of BayseanClassifier. It classifies documents into
+    categories based on the classic Baysean classification algorithm.
+
+    Copyright (C) 2016   Ezra Erb
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License version 3 as published
+    by the Free Software Foundation.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+    I'd appreciate a note if you find this program useful or make
+    updates. Please contact me through LinkedIn (my profile also has
+    a link to the code depository)
+*/
+#include <string>
+#include <vector>
+#include <sstream>
+
+#include "hashedWordData.h"
+#include "baseException.h"
+
+using namespace std;
+
+const unsigned short HashedWordData::MaxHashBits;
+
+// Create with 2 to the power of the passed bits buckets
+HashedWordData::HashedWordData(unsigned short hashBits)
+    : _docCount(0), _wordCount(0), _totalWordCount(0), _buckets()
+{
+    if ((hashBits == 0) || (hashBits > MaxHashBits)) {
+        stringstream errorMessage;
+        errorMessage << "Error, feature hashing needs between 1 and " << MaxHashBits
+                     << " hash bits, not " << hashBits;
+        THROW_BASE_EXCEPTION(errorMessage.str().c_str());
+    }
+    _buckets.resize((size_t)1 << hashBits, 0);
+}
+
+// Add a new document to the category results
+void HashedWordData::addDocument(const DocumentWordMap& docData)
+{
+    DocumentWordMap::const_iterator index;
+    for (index = docData.begin(); index != docData.end(); index++)
+        addWordCount(index->first, index->second);
+    addCountChecked(_docCount, 1);
+    addCountChecked(_wordCount, docData.size()); // Number of different words
+    addCountChecked(_totalWordCount, docData.getTotalWordCount());
+}
+
+// Add category totals found elsewhere, such as a counts file
+void HashedWordData::addTotals(unsigned long long docCount, unsigned long long wordCount,
+                               unsigned long long totalWordCount)
+{
+    addCountChecked(_docCount, docCount);
+    addCountChecked(_wordCount, wordCount);
+    addCountChecked(_totalWordCount, totalWordCount);
+}
+
+// Add word counts found elsewhere, such as a counts file
+void HashedWordData::addWordCount(const string& word, unsigned long long count)
+{
+    addCountChecked(_buckets[getBucket(word, _buckets.size())], count);
+}
+
+// Merge other category data with the same number of buckets into this data
+void HashedWordData::mergeData(const HashedWordData& other)
+{
+    if (other._buckets.size() != _buckets.size()) {
+        stringstream errorMessage;
+        errorMessage << "Internal error: merging hashed word data of different sizes";
+        THROW_BASE_EXCEPTION(errorMessage.str().c_str());
+    }
+    size_t index;
+    for (index = 0; index < _buckets.size(); index++)
+        addCountChecked(_buckets[index], other._buckets[index]);
+    addTotals(other._docCount, other._wordCount, other._totalWordCount);
+}
@@ -0,0 +1,110 @@
+#ifndef HASHED_WORD_DATA_H
+#define HASHED_WORD_DATA_H
+
+/* This file is part of BayseanClassifier. It classifies documents into
+    categories based on the classic Baysean classification algorithm.
+
+    Copyright (C) 2016   Ezra Erb
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License version 3 as published
+    by the Free Software Foundation.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+    I'd appreciate a note if you find this program useful or make
+    updates. Please contact me through LinkedIn (my profile also has
+    a link to the code depository)
+*/
+#include <string>
+#include <vector>
+#include "documentWordMapFactory.h"
+
+using std::string;
+using std::vector;
+
+/* Data about a category of documents with words replaced by a hash of them.
+    Each word is counted in one of a fixed number of buckets, picked by its
+    hash, so no words are stored and the size is set by the number of
+    buckets alone. Words that hash to the same bucket share its count.
+
+    Document and word totals are exact, as for CatWordData */
+class HashedWordData
+{
+public:
+    /* Most hash bits allowed. Each table is 8 bytes a bucket, so 128 MB at
+        this size, and training holds one per category per score thread */
+    static const unsigned short MaxHashBits = 24;
+
+    // Create with 2 to the power of the passed bits buckets
+    explicit HashedWordData(unsigned short hashBits);
+
+    // Use default copy constructor, assignment operator, and destructor
+
+    // Add a new document to the category results. Throws if a count overflows
+    void addDocument(const DocumentWordMap& docData);
+
+    /* Add category totals and word counts found elsewhere, such as a
+        counts file. Throws if a count overflows */
+    void addTotals(unsigned long long docCount, unsigned long long wordCount,
+                   unsigned long long totalWordCount);
+    void addWordCount(const string& word, unsigned long long count);
+
+    /* Merge other category data with the same number of buckets into this
+        data. Throws if a count overflows */
+    void mergeData(const HashedWordData& other);
+
+    unsigned long long getDocCount() const;
+    unsigned long long getWordCount() const;
+    unsigned long long getTotalWordCount() const;
+
+    // Counts of the words in each bucket
+    const vector<unsigned long long>& getBucketCounts() const;
+
+    // The bucket for a word, in a table with the passed number of buckets
+    static size_t getBucket(const string& word, size_t bucketCount);
+
+private:
+    unsigned long long _docCount;
+    unsigned long long _wordCount;
+    unsigned long long _totalWordCount;
+    vector<unsigned long long> _buckets;
+};
+
+// Number of documents in category
+inline unsigned long long HashedWordData::getDocCount() const
+{
+    return _docCount;
+}
+
+// Number of different words in category documents
+inline unsigned long long HashedWordData::getWordCount() const
+{
+    return _wordCount;
+}
+
+// Overall number of words in documents
+inline unsigned long long HashedWordData::getTotalWordCount() const
+{
+    return _totalWordCount;
+}
+
+// Counts of the words in each bucket
+inline const vector<unsigned long long>& HashedWordData::getBucketCounts() const
+{
+    return _buckets;
+}
+
+// The bucket for a word. The number of buckets is a power of two
+inline size_t HashedWordData::getBucket(const string& word, size_t bucketCount)
+{
+    return (size_t)(hashWord(word) & (bucketCount - 1));
+}
+
+#endif // HASHED_WORD_DATA_H
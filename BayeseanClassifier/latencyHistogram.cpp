@@ -0,0 +1,121 @@
+/* This file is part of BayseanClassifier. It classifies documents into
+    categories based on the classic Baysean classification algorithm.
+
+    Copyright (C) 2016   Ezra Erb
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License version 3 as published
+    by the Free Software Foundation.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+    I'd appreciate a note if you find this program useful or make
+    updates. Please contact me through LinkedIn (my profile also has
+    a link to the code depository)
+*/
+#include <atomic>
+#include "latencyHistogram.h"
+
+using namespace std;
+
+const unsigned int LatencyHistogram::SubBucketBits;
+const unsigned long long LatencyHistogram::SubBuckets;
+const unsigned int LatencyHistogram::MaxTimeBits;
+const unsigned int LatencyHistogram::BucketCount;
+
+LatencyHistogram::LatencyHistogram()
+    : _count(0), _sumMicroseconds(0)
+{
+    unsigned int index;
+    for (index = 0; index < BucketCount; index++)
+        _buckets[index].store(0, memory_order_relaxed);
+}
+
+/* Bucket that counts a time in microseconds. Times with their highest bit
+    at position SubBucketBits or above are shifted until only SubBucketBits
+    + 1 bits remain, and the top half of the buckets for that power of two is
+    indexed by the result */
+unsigned int LatencyHistogram::getBucket(unsigned long long microseconds)
+{
+    if (microseconds < SubBuckets)
+        return (unsigned int)microseconds;
+    unsigned int highBit = SubBucketBits;
+    while ((highBit < 63) && ((microseconds >> (highBit + 1)) != 0))
+        highBit++;
+    if (highBit >= MaxTimeBits) {
+        highBit = MaxTimeBits - 1;
+        microseconds = (1ULL << MaxTimeBits) - 1;
+    }
+    unsigned int shift = highBit - SubBucketBits + 1;
+    return (shift * (unsigned int)(SubBuckets / 2)) + (unsigned int)(microseconds >> shift);
+}
+
+// Largest time in microseconds counted in a bucket
+unsigned long long LatencyHistogram::getBucketTop(unsigned int bucket)
+{
+    if (bucket < SubBuckets)
+        return bucket;
+    unsigned int shift = (bucket / (unsigned int)(SubBuckets / 2)) - 1;
+    unsigned long long value = bucket - ((unsigned long long)shift * (SubBuckets / 2));
+    return ((value + 1) << shift) - 1;
+}
+
+// Record one time, in seconds
+void LatencyHistogram::record(double seconds)
+{
+    // Rounded to the nearest microsecond. Clocks can step back, so clamp at zero
+    unsigned long long microseconds = 0;
+    if (seconds > 0.0)
+        microseconds = (unsigned long long)((seconds * 1000000.0) + 0.5);
+    _buckets[getBucket(microseconds)].fetch_add(1, memory_order_relaxed);
+    _count.fetch_add(1, memory_order_relaxed);
+    _sumMicroseconds.fetch_add(microseconds, memory_order_relaxed);
+}
+
+// Number of times recorded
+unsigned long long LatencyHistogram::getCount() const
+{
+    return _count.load(memory_order_relaxed);
+}
+
+// Sum of all times recorded, in seconds
+double LatencyHistogram::getSum() const
+{
+    return (double)_sumMicroseconds.load(memory_order_relaxed) / 1000000.0;
+}
+
+// Return the time, in seconds, that the passed share of the times are at or below
+double LatencyHistogram::getPercentile(double share) const
+{
+    /* Count from the buckets rather than the total, since times recorded
+        while reading are in some counters and not others */
+    unsigned long long counts[BucketCount];
+    unsigned long long total = 0;
+    unsigned int index;
+    for (index = 0; index < BucketCount; index++) {
+        counts[index] = _buckets[index].load(memory_order_relaxed);
+        total += counts[index];
+    }
+    if (total == 0)
+        return 0.0;
+
+    // Rank of the wanted time, counting from one
+    unsigned long long rank = (unsigned long long)((share * (double)total) + 0.999999);
+    if (rank < 1)
+        rank = 1;
+    else if (rank > total)
+        rank = total;
+    unsigned long long seen = 0;
+    for (index = 0; index < BucketCount; index++) {
+        seen += counts[index];
+        if (seen >= rank)
+            break;
+    }
+    return (double)getBucketTop(index) / 1000000.0;
+}
@@ -0,0 +1,84 @@
+#ifndef LATENCY_HISTOGRAM_H
+#define LATENCY_HISTOGRAM_H
+
+/* This file is part of BayseanClassifier. It classifies documents into
+    categories based on the classic Baysean classification algorithm.
+
+    Copyright (C) 2016   Ezra Erb
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License version 3 as published
+    by the Free Software Foundation.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+    I'd appreciate a note if you find this program useful or make
+    updates. Please contact me through LinkedIn (my profile also has
+    a link to the code depository)
+*/
+#include <atomic>
+
+/* This class records how long operations take, and finds percentiles of
+    them. It works like an HDR histogram: times are counted in microseconds,
+    in buckets that double in width with each power of two, and each power of
+    two is split into the same number of equal sized buckets. Any time from a
+    microsecond to days is then found within about three percent, using a
+    fixed, small array.
+
+    Recording a time only adds to atomic counters, so many threads can record
+    at once without locking. Percentiles read a snapshot of the counters, so
+    they can be found while times are still being recorded */
+class LatencyHistogram
+{
+public:
+    LatencyHistogram();
+
+    // Use default destructor
+
+    // Record one time, in seconds
+    void record(double seconds);
+
+    // Number of times recorded
+    unsigned long long getCount() const;
+
+    // Sum of all times recorded, in seconds
+    double getSum() const;
+
+    /* Return the time, in seconds, that the passed share of the times
+        recorded are at or below. Reports the top of the bucket holding it, so
+        it is never too low. Zero if nothing has been recorded */
+    double getPercentile(double share) const;
+
+private:
+    /* Times below this many microseconds get a bucket each. Each power of two
+        above gets half as many */
+    static const unsigned int SubBucketBits = 6;
+    static const unsigned long long SubBuckets = 1ULL << SubBucketBits;
+
+    // Longer times are counted in the last bucket. About twelve days
+    static const unsigned int MaxTimeBits = 40;
+    static const unsigned int BucketCount =
+        (MaxTimeBits - SubBucketBits + 2) * (unsigned int)(SubBuckets / 2);
+
+    std::atomic<unsigned long long> _buckets[BucketCount];
+    std::atomic<unsigned long long> _count;
+    std::atomic<unsigned long long> _sumMicroseconds;
+
+    // Bucket that counts a time in microseconds
+    static unsigned int getBucket(unsigned long long microseconds);
+
+    // Largest time in microseconds counted in a bucket
+    static unsigned long long getBucketTop(unsigned int bucket);
+
+    // Make non-copyable, atomics can not be copied
+    LatencyHistogram(const LatencyHistogram& other);
+    LatencyHistogram& operator=(const LatencyHistogram& other);
+};
+
+#endif // LATENCY_HISTOGRAM_H
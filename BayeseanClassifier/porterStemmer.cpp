@@ -21,6 +21,7 @@
 */
 #include <string>
 #include <vector>
+#include <map>
 #include <iostream>
 #include "porterStemmer.h"
 
@@ -31,6 +32,61 @@ using namespace std;
 const string PorterStemmer::_vowels("aeiou");
 const string PorterStemmer::_vowelsAndY("aeiouy");
 
+/* Adjective and adverb suffixes, chosen by the second to last letter of the
+    word. They sort beautifully based on it */
+static const char* const AdjectiveSuffixTable[][3] = {
+    { "a", "ational", "ate" }, { "a", "tional", "tion" },
+    { "c", "enci", "ence" }, { "c", "anci", "ance" },
+    { "e", "izer", "ize" },
+    { "l", "abli", "able" }, { "l", "alli", "al" }, { "l", "entli", "ent" },
+    { "l", "eli", "e" }, { "l", "ousli", "ous" },
+    { "o", "ization", "ize" }, { "o", "ation", "ate" }, { "o", "ator", "ate" },
+    { "s", "alism", "al" }, { "s", "iveness", "ive" }, { "s", "fulness", "ful" },
+    { "s", "ousness", "ous" },
+    { "t", "aliti", "al" }, { "t", "iviti", "ive" }, { "t", "biliti", "ble" } };
+
+// More adjective and adverb suffixes, chosen by the last letter of the word
+static const char* const MoreAdjectiveSuffixTable[][3] = {
+    { "e", "icate", "ic" }, { "e", "ative", "" }, { "e", "alize", "al" },
+    { "i", "iciti", "ic" },
+    { "l", "ical", "ic" }, { "l", "ful", "" },
+    { "s", "ness", "" } };
+
+// Yet more suffixes, removed entirely, chosen by the second to last letter
+static const char* const LastSuffixTable[][3] = {
+    { "a", "al", "" },
+    { "c", "ance", "" }, { "c", "ence", "" },
+    { "e", "er", "" },
+    { "i", "ic", "" },
+    { "l", "able", "" }, { "l", "ible", "" },
+    { "n", "ant", "" }, { "n", "ement", "" }, { "n", "ment", "" }, { "n", "ent", "" },
+    { "o", "sion", "s" }, { "o", "tion", "t" }, { "o", "ou", "" },
+    { "s", "ism", "" },
+    { "t", "ate", "" }, { "t", "iti", "" },
+    { "u", "ous", "" },
+    { "v", "ive", "" },
+    { "z", "ize", "" } };
+
+const PorterStemmer::SuffixRules PorterStemmer::_adjectiveSuffixes(
+    makeRules(AdjectiveSuffixTable,
+              sizeof(AdjectiveSuffixTable) / sizeof(AdjectiveSuffixTable[0])));
+const PorterStemmer::SuffixRules PorterStemmer::_moreAdjectiveSuffixes(
+    makeRules(MoreAdjectiveSuffixTable,
+              sizeof(MoreAdjectiveSuffixTable) / sizeof(MoreAdjectiveSuffixTable[0])));
+const PorterStemmer::SuffixRules PorterStemmer::_lastSuffixes(
+    makeRules(LastSuffixTable, sizeof(LastSuffixTable) / sizeof(LastSuffixTable[0])));
+
+// Build rules from a table of letter, suffix and replacement
+PorterStemmer::SuffixRules PorterStemmer::makeRules(const char* const table[][3], size_t count)
+{
+    SuffixRules rules;
+    size_t index;
+    for (index = 0; index < count; index++)
+        rules[table[index][0][0]].push_back(make_pair(string(table[index][1]),
+                                                      string(table[index][2])));
+    return rules;
+}
+
 // Private inline methods. Must be declared before they are used
 inline bool PorterStemmer::isConsonant(char letter)
 {
@@ -140,6 +196,15 @@ bool PorterStemmer::replaceSuffix(string& word, const vector<size_t>& syllables,
         return haveMatch;
     }
 }
+// Apply the rules chosen by a letter of the word, if there are any
+void PorterStemmer::applyRules(string& word, const vector<size_t>& syllables,
+                               size_t wantSyllable, const SuffixRules& rules, char letter)
+{
+    SuffixRules::const_iterator suffixes = rules.find(letter);
+    if (suffixes != rules.end())
+        replaceSuffix(word, syllables, wantSyllable, suffixes->second);
+}
+
 // Retuns the location of next syllable in a word
 size_t PorterStemmer::nextSyllable(const string& word, size_t pos)
 {
@@ -208,6 +273,14 @@ void PorterStemmer::getSyllables(const string& word, vector<size_t>& syllables)
 }
 
 string PorterStemmer::getStem(const string& word)
+{
+    string stem(word);
+    vector<size_t> syllables;
+    stemInPlace(stem, syllables);
+    return stem;
+}
+
+void PorterStemmer::stemInPlace(string& stem, vector<size_t>& syllables)
 {
     /* This code implements the classic Porter stemmer. For each step,
         apply patterns in order until one is matched, then replace as
@@ -222,11 +295,7 @@ string PorterStemmer::getStem(const string& word)
         very convenient branching based on the final chars of a word
         NOTE: Strings are indexed from zero, so length - 1 is the last
         char, etc. */
-    vector<size_t> syllables;
-    getSyllables(word, syllables);
-
-    // By default, the word is the stem
-    string stem(word);
+    getSyllables(stem, syllables);
 
     /* Convert plural to singular.
         WARNING: Not all words that end in 's' are plural */
@@ -317,51 +386,7 @@ string PorterStemmer::getStem(const string& word)
         to last letter. Test this in the word to find the appropriate ones
         OPTIMIZATION: Do the syllable test on the shortest suffix up front */
     if ((stem.length() > 3) && hasSyllableCount(stem, syllables, 2, 3)) {
-        SuffixReplacements suffixes;
-        switch (stem[stem.length() - 2]) {
-        case 'a':
-            suffixes.push_back(make_pair(string("ational"), string("ate")));
-            suffixes.push_back(make_pair(string("tional"), string("tion")));
-            break;
-        case 'c':
-            suffixes.push_back(make_pair(string("enci"), string("ence")));
-            suffixes.push_back(make_pair(string("anci"), string("ance")));
-        break;
-        case 'e':
-            suffixes.push_back(make_pair(string("izer"), string("ize")));
-            break;
-        case 'l':
-            suffixes.push_back(make_pair(string("abli"), string("able")));
-            suffixes.push_back(make_pair(string("alli"), string("al")));
-            suffixes.push_back(make_pair(string("entli"), string("ent")));
-            suffixes.push_back(make_pair(string("eli"), string("e")));
-            suffixes.push_back(make_pair(string("ousli"), string("ous")));
-            break;
-        case 'o':
-            suffixes.push_back(make_pair(string("ization"), string("ize")));
-            suffixes.push_back(make_pair(string("ation"), string("ate")));
-            suffixes.push_back(make_pair(string("ator"), string("ate")));
-            break;
-        case 's':
-            suffixes.push_back(make_pair(string("alism"), string("al")));
-            suffixes.push_back(make_pair(string("iveness"), string("ive")));
-            suffixes.push_back(make_pair(string("fulness"), string("ful")));
-            suffixes.push_back(make_pair(string("ousness"), string("ous")));
-            break;
-
-        case 't':
-            suffixes.push_back(make_pair(string("aliti"), string("al")));
-            suffixes.push_back(make_pair(string("iviti"), string("ive")));
-            suffixes.push_back(make_pair(string("biliti"), string("ble")));
-            break;
-
-        default:
-            // Do nothing
-            break;
-        } // Switch on second to last letter
-
-        if (!suffixes.empty()) // Apply the list
-            replaceSuffix(stem, syllables, 2, suffixes);
+        applyRules(stem, syllables, 2, _adjectiveSuffixes, stem[stem.length() - 2]);
     } // Word may have a suffix to remove
 
 
@@ -369,31 +394,7 @@ string PorterStemmer::getStem(const string& word)
         from the stems found above
         OPTIMIZATION: Split on the last letter this time */
     if ((stem.length() > 2) && hasSyllableCount(stem, syllables, 2, 3)) {
-        SuffixReplacements suffixes;
-        switch (stem[stem.length() - 1]) {
-        case 'e':
-            suffixes.push_back(make_pair(string("icate"), string("ic")));
-            suffixes.push_back(make_pair(string("ative"), string("")));
-            suffixes.push_back(make_pair(string("alize"), string("al")));
-            break;
-        case 'i':
-            suffixes.push_back(make_pair(string("iciti"), string("ic")));
-            break;
-        case 'l':
-            suffixes.push_back(make_pair(string("ical"), string("ic")));
-            suffixes.push_back(make_pair(string("ful"), string("")));
-            break;
-        case 's':
-            suffixes.push_back(make_pair(string("ness"), string("")));
-            break;
-        default:
-            // Do nothing
-            break;
-        } // Switch on second to last letter
-
-        if (!suffixes.empty()) // Apply the list
-            replaceSuffix(stem, syllables, 2, suffixes);
-
+        applyRules(stem, syllables, 2, _moreAdjectiveSuffixes, stem[stem.length() - 1]);
     } // Word may have suffix to remove
 
     /* Yet more adjective and adverb suffixes, some of which may be removed
@@ -401,59 +402,7 @@ string PorterStemmer::getStem(const string& word)
         removal of the suffix
         OPTIMIZATION: Split on the second to last letter */
     if ((stem.length() > 3) && hasSyllableCount(stem, syllables, 3, 2)) {
-        SuffixReplacements suffixes;
-        switch (stem[stem.length() - 2]) {
-        case 'a':
-            suffixes.push_back(make_pair(string("al"), string("")));
-            break;
-        case 'c':
-            suffixes.push_back(make_pair(string("ance"), string("")));
-            suffixes.push_back(make_pair(string("ence"), string("")));
-            break;
-        case 'e':
-            suffixes.push_back(make_pair(string("er"), string("")));
-            break;
-        case 'i':
-            suffixes.push_back(make_pair(string("ic"), string("")));
-            break;
-        case 'l':
-            suffixes.push_back(make_pair(string("able"), string("")));
-            suffixes.push_back(make_pair(string("ible"), string("")));
-            break;
-        case 'n':
-            suffixes.push_back(make_pair(string("ant"), string("")));
-            suffixes.push_back(make_pair(string("ement"), string("")));
-            suffixes.push_back(make_pair(string("ment"), string("")));
-            suffixes.push_back(make_pair(string("ent"), string("")));
-            break;
-        case 'o':
-            suffixes.push_back(make_pair(string("sion"), string("s")));
-            suffixes.push_back(make_pair(string("tion"), string("t")));
-            suffixes.push_back(make_pair(string("ou"), string("")));
-            break;
-        case 's':
-            suffixes.push_back(make_pair(string("ism"), string("")));
-            break;
-        case 't':
-            suffixes.push_back(make_pair(string("ate"), string("")));
-            suffixes.push_back(make_pair(string("iti"), string("")));
-            break;
-        case 'u':
-            suffixes.push_back(make_pair(string("ous"), string("")));
-            break;
-        case 'v':
-            suffixes.push_back(make_pair(string("ive"), string("")));
-            break;
-        case 'z':
-            suffixes.push_back(make_pair(string("ize"), string("")));
-            break;
-        default:
-            // Do nothing
-            break;
-        } // Switch on second to last letter
-
-        if (!suffixes.empty()) // Apply the list
-            replaceSuffix(stem, syllables, 3, suffixes);
+        applyRules(stem, syllables, 3, _lastSuffixes, stem[stem.length() - 2]);
     } // More than two syllables in word
 
     // Clean up stems after suffix removal
@@ -480,8 +429,6 @@ string PorterStemmer::getStem(const string& word)
     if (hasSyllableCount(stem, syllables, 3, 1) &&
         hasSuffix(stem, string("ll")))
         stem.erase(stem.length() - 1);
-
-    return stem;
 }
 
 // A function to test the stemmer. Failed tests go to standard out
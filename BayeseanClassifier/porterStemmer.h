@@ -23,10 +23,12 @@
 */
 #include <string>
 #include <vector>
+#include <map>
 
 using std::string;
 using std::vector;
 using std::pair;
+using std::map;
 
 /* This class implements a stemmer, which converts words into their roots. Very
    important in text processing, it allows code to handle different variants of
@@ -57,6 +59,17 @@ class PorterStemmer
             string, replace it with the second */
         typedef vector<pair<string, string> > SuffixReplacements;
 
+        /* Suffix replacement rules for one step, chosen by a letter near the
+            end of the word. Built once, not for every word */
+        typedef map<char, SuffixReplacements> SuffixRules;
+        static const SuffixRules _adjectiveSuffixes;
+        static const SuffixRules _moreAdjectiveSuffixes;
+        static const SuffixRules _lastSuffixes;
+
+        /* Build rules from a table of letter, suffix and replacement. The
+            suffixes for each letter are tested in table order */
+        static SuffixRules makeRules(const char* const table[][3], size_t count);
+
         /* C++ can efficiently search strings for values in other strings. These
             provide the values to search for */
         static const string _vowels;
@@ -101,6 +114,11 @@ class PorterStemmer
         static bool replaceSuffix(string& word, int reqStemLength,
                                   const SuffixReplacements& suffixes);
 
+        /* Apply the rules chosen by a letter of the word, if there are any,
+            as for replaceSuffix() */
+        static void applyRules(string& word, const vector<size_t>& syllables,
+                               size_t wantSyllable, const SuffixRules& rules, char letter);
+
         // Retuns the location of next syllable in a word
         static size_t nextSyllable(const string& word, size_t pos);
 
@@ -108,10 +126,18 @@ class PorterStemmer
         static void getSyllables(const string& word, vector<size_t>& syllables);
 
     public:
+        /* Version of the stemming rules. Change it whenever the rules change,
+            so results saved from a previous version are discarded */
+        static const unsigned int Version = 1;
+
         /* Get the stem for a word. Must be all lowercase with no
             punctuation except for dashes */
         static string getStem(const string& word);
 
+        /* Replace a word with its stem. The syllable list is working space,
+            passed in so callers stemming many words can reuse it */
+        static void stemInPlace(string& word, vector<size_t>& syllables);
+
         // A function to test the stemmer. Failed tests go to standard out
         static void testStemmer();
 };
@@ -0,0 +1,109 @@
+/* This file is part of BayseanClassifier. It classifies documents into
+    categories based on the classic Baysean classification algorithm.
+
+    Copyright (C) 2016   Ezra Erb
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License version 3 as published
+    by the Free Software Foundation.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+    I'd appreciate a note if you find this program useful or make
+    updates. Please contact me through LinkedIn (my profile also has
+    a link to the code depository)
+*/
+#include <string>
+#include <sstream>
+#include <iostream>
+#include <iomanip>
+
+#include "progressReporter.h"
+
+using namespace std;
+
+// Start reporting on a run of the passed number of documents
+ProgressReporter::ProgressReporter(const string& name, size_t total, unsigned short interval)
+    : _name(name), _total(total), _interval(interval > 0 ? interval : 1), _documents(0), _bytes(0),
+      _start(chrono::steady_clock::now()), _stopping(false), _thread()
+{
+    _thread = thread(&ProgressReporter::reportWorker, this);
+}
+
+// Stops reporting if not already done
+ProgressReporter::~ProgressReporter()
+{
+    try {
+        stop();
+    }
+    catch (...) {
+        // Destructors must not throw, and the report is only informational
+    }
+}
+
+// Stop reporting, and print the totals for the whole run
+void ProgressReporter::stop()
+{
+    {
+        lock_guard<mutex> guard(_lock);
+        if (_stopping)
+            return;
+        _stopping = true;
+    }
+    _stopped.notify_all();
+    if (_thread.joinable())
+        _thread.join();
+    cerr << progressToString(true) << endl;
+}
+
+// Thread body, which prints a report each interval until stopped
+void ProgressReporter::reportWorker()
+{
+    unique_lock<mutex> guard(_lock);
+    while (!_stopping) {
+        chrono::steady_clock::time_point next = chrono::steady_clock::now() +
+            chrono::seconds(_interval);
+        while ((!_stopping) && (_stopped.wait_until(guard, next) != cv_status::timeout))
+            ; // Woken early, wait out the rest of the interval
+        if (!_stopping)
+            cerr << progressToString(false) << endl;
+    }
+}
+
+// Return a line describing progress so far
+string ProgressReporter::progressToString(bool finished) const
+{
+    unsigned long long documents = _documents.load(memory_order_relaxed);
+    unsigned long long bytes = _bytes.load(memory_order_relaxed);
+    double seconds = chrono::duration<double>(chrono::steady_clock::now() - _start).count();
+    double documentRate = (seconds > 0.0) ? (double)documents / seconds : 0.0;
+    double megabyteRate = (seconds > 0.0) ? (double)bytes / (1024.0 * 1024.0) / seconds : 0.0;
+
+    ostringstream buffer;
+    buffer << fixed << setprecision(1) << _name << ": " << documents << "/" << _total
+           << " documents";
+    if (finished)
+        buffer << " in " << seconds << " s";
+    else if (_total > 0)
+        buffer << " (" << (100.0 * (double)documents / (double)_total) << "%)";
+    buffer << ", " << documentRate << " documents/s, " << setprecision(2) << megabyteRate
+           << " MB/s";
+    if (!finished) {
+        if (documentRate > 0.0) {
+            // Assumes the remaining documents go at the average rate so far
+            unsigned long long left = (unsigned long long)((double)(_total - documents) /
+                                                           documentRate);
+            buffer << ", ETA " << (left / 3600) << ":" << setfill('0') << setw(2)
+                   << ((left / 60) % 60) << ":" << setw(2) << (left % 60);
+        }
+        else
+            buffer << ", ETA unknown";
+    }
+    return buffer.str();
+}
@@ -0,0 +1,88 @@
+#ifndef PROGRESS_REPORTER_H
+#define PROGRESS_REPORTER_H
+
+/* This file is part of BayseanClassifier. It classifies documents into
+    categories based on the classic Baysean classification algorithm.
+
+    Copyright (C) 2016   Ezra Erb
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License version 3 as published
+    by the Free Software Foundation.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+    I'd appreciate a note if you find this program useful or make
+    updates. Please contact me through LinkedIn (my profile also has
+    a link to the code depository)
+*/
+#include <string>
+#include <atomic>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+#include <chrono>
+
+using std::string;
+
+/* This class reports the progress of a long run to standard error from a
+    background thread: documents done out of the total, documents and
+    megabytes per second, and the estimated time left. The threads doing the
+    work only add to atomic counters, so reporting never makes them wait */
+class ProgressReporter
+{
+public:
+    /* Start reporting on a run of the passed number of documents, every
+        interval seconds. The name identifies the run */
+    ProgressReporter(const string& name, size_t total, unsigned short interval);
+
+    // Stops reporting if not already done
+    ~ProgressReporter();
+
+    // Count a document finished
+    void addDocument()
+    {
+        _documents.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    // Count bytes of documents read
+    void addBytes(unsigned long long bytes)
+    {
+        _bytes.fetch_add(bytes, std::memory_order_relaxed);
+    }
+
+    // Stop reporting, and print the totals for the whole run
+    void stop();
+
+private:
+    const string _name;
+    const size_t _total;
+    const unsigned short _interval;
+
+    std::atomic<unsigned long long> _documents;
+    std::atomic<unsigned long long> _bytes;
+    const std::chrono::steady_clock::time_point _start;
+
+    bool _stopping;
+    std::mutex _lock;
+    std::condition_variable _stopped;
+    std::thread _thread;
+
+    // Thread body, which prints a report each interval until stopped
+    void reportWorker();
+
+    // Return a line describing progress so far
+    string progressToString(bool finished) const;
+
+    // Make non-copyable, the thread refers to this object
+    ProgressReporter(const ProgressReporter& other);
+    ProgressReporter& operator=(const ProgressReporter& other);
+};
+
+#endif // PROGRESS_REPORTER_H
@@ -0,0 +1,199 @@
+/* This file is part of BayseanClassifier. It classifies documents into
+    categories based on the classic Baysean classification algorithm.
+
+    Copyright (C) 2016   Ezra Erb
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License version 3 as published
+    by the Free Software Foundation.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+    I'd appreciate a note if you find this program useful or make
+    updates. Please contact me through LinkedIn (my profile also has
+    a link to the code depository)
+*/
+#include <string>
+#include <vector>
+#include <map>
+#include <sstream>
+#include <ostream>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+#include "resultWriter.h"
+#include "varintCoding.h"
+#include "baseException.h"
+
+using namespace std;
+
+const size_t ResultWriter::DefaultBufferSize;
+
+static const char ResultsMagic[] = "BCRS";
+static const unsigned long long ResultsVersion = 1;
+
+
+// Append a number as decimal digits, without going through a stream
+static void appendDecimal(string& buffer, size_t value)
+{
+    char digits[24];
+    size_t position = sizeof(digits);
+    do {
+        position--;
+        digits[position] = (char)('0' + (value % 10));
+        value /= 10;
+    } while (value > 0);
+    buffer.append(digits + position, sizeof(digits) - position);
+}
+
+// Write results in the passed format to the stream
+ResultWriter::ResultWriter(ostream& output, ResultFormat format, const vector<string>& categories,
+                           bool backgroundWrite, size_t bufferSize)
+    : _output(output), _format(format), _categoryIds(), _bufferSize(bufferSize > 0 ? bufferSize : 1),
+      _buffer(), _backgroundWrite(backgroundWrite), _writing(), _stopping(false), _failed(false)
+{
+    size_t index;
+    for (index = 0; index < categories.size(); index++)
+        _categoryIds[categories[index]] = index;
+
+    _buffer.reserve(_bufferSize);
+    if (_format == TsvResults)
+        for (index = 0; index < categories.size(); index++) {
+            _buffer.push_back('#');
+            appendDecimal(_buffer, index);
+            _buffer.push_back('\t');
+            _buffer.append(categories[index]);
+            _buffer.push_back('\n');
+        }
+    else if (_format == BinaryResults) {
+        _buffer.append(ResultsMagic, 4);
+        appendNumber(_buffer, ResultsVersion);
+        appendNumber(_buffer, categories.size());
+        for (index = 0; index < categories.size(); index++)
+            appendString(_buffer, categories[index]);
+    }
+
+    // Anything printed before, like trace output, must come out first
+    _output.flush();
+    if (_backgroundWrite)
+        _thread = thread(&ResultWriter::writeWorker, this);
+}
+
+// Stops the background thread
+ResultWriter::~ResultWriter()
+{
+    try {
+        stopThread();
+    }
+    catch (...) {
+        // Destructors must not throw, and finish() reports any failure
+    }
+}
+
+// Write the result for one document
+void ResultWriter::write(const string& path, const string& category)
+{
+    if (_format == TextResults) {
+        _buffer.append(path);
+        _buffer.append(": ", 2);
+        _buffer.append(category);
+        _buffer.push_back('\n');
+    }
+    else {
+        map<string, size_t>::const_iterator id = _categoryIds.find(category);
+        if (id == _categoryIds.end()) {
+            stringstream errorMessage;
+            errorMessage << "Internal error: result for " << path << " has unknown category "
+                         << category;
+            THROW_BASE_EXCEPTION(errorMessage.str().c_str());
+        }
+        if (_format == TsvResults) {
+            _buffer.append(path);
+            _buffer.push_back('\t');
+            appendDecimal(_buffer, id->second);
+            _buffer.push_back('\n');
+        }
+        else {
+            appendString(_buffer, path);
+            appendNumber(_buffer, id->second);
+        }
+    }
+    if (_buffer.length() >= _bufferSize)
+        flushBuffer();
+}
+
+// Write out the collected results, or hand them to the background thread
+void ResultWriter::flushBuffer()
+{
+    if (_buffer.empty())
+        return;
+    if (!_backgroundWrite) {
+        _output.write(_buffer.data(), _buffer.length());
+        if (!_output)
+            _failed = true;
+        _buffer.clear();
+        return;
+    }
+
+    unique_lock<mutex> guard(_lock);
+    while (!_writing.empty())
+        _changed.wait(guard);
+    // Swapping keeps both buffers' memory, so neither is allocated again
+    _writing.swap(_buffer);
+    _buffer.clear();
+    guard.unlock();
+    _changed.notify_all();
+}
+
+// Thread body, which writes each buffer handed to it
+void ResultWriter::writeWorker()
+{
+    unique_lock<mutex> guard(_lock);
+    while (true) {
+        while (_writing.empty() && (!_stopping))
+            _changed.wait(guard);
+        if (_writing.empty())
+            break; // Stopping with nothing left
+        // The buffer is not touched by the other thread until it is emptied
+        guard.unlock();
+        _output.write(_writing.data(), _writing.length());
+        bool failed = !_output;
+        guard.lock();
+        if (failed)
+            _failed = true;
+        _writing.clear();
+        _changed.notify_all();
+    }
+}
+
+// Stop the background thread once it has written everything
+void ResultWriter::stopThread()
+{
+    if (!_thread.joinable())
+        return;
+    {
+        lock_guard<mutex> guard(_lock);
+        _stopping = true;
+    }
+    _changed.notify_all();
+    _thread.join();
+}
+
+// Write everything collected so far and stop
+void ResultWriter::finish()
+{
+    flushBuffer();
+    stopThread();
+    _output.flush();
+    if (_failed || (!_output)) {
+        stringstream errorMessage;
+        errorMessage << "Error, could not write classification results";
+        THROW_BASE_EXCEPTION(errorMessage.str().c_str());
+    }
+}
@@ -0,0 +1,112 @@
+#ifndef RESULT_WRITER_H
+#define RESULT_WRITER_H
+
+/* This file is part of BayseanClassifier. It classifies documents into
+    categories based on the classic Baysean classification algorithm.
+
+    Copyright (C) 2016   Ezra Erb
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License version 3 as published
+    by the Free Software Foundation.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+    I'd appreciate a note if you find this program useful or make
+    updates. Please contact me through LinkedIn (my profile also has
+    a link to the code depository)
+*/
+#include <string>
+#include <vector>
+#include <map>
+#include <ostream>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+
+using std::string;
+using std::vector;
+using std::map;
+using std::ostream;
+
+// Ways to write classification results
+enum ResultFormat { TextResults, TsvResults, BinaryResults };
+
+/* This class writes classification results. Results are collected in a
+    large buffer and written a buffer at a time, instead of flushing the
+    stream for every line, so writing millions of results costs a few large
+    writes. Optionally a background thread does the writing, so results are
+    formatted into one buffer while the previous one is written.
+
+    Formats:
+        text: "path: category" lines, as always printed
+        tsv: a "#ID<tab>category" line for each category, then
+            "path<tab>ID" lines. Windows paths can not hold tabs or newlines,
+            so nothing needs escaping
+        binary: magic "BCRS", format version, number of categories, then
+            each category name; then for each result the path and the
+            category ID. Numbers are variable length integers, seven bits a
+            byte with the high bit set if more follow, and strings are a
+            length followed by the bytes
+    Category IDs are positions in the category list given at construction */
+class ResultWriter
+{
+public:
+    // Bytes collected before they are written
+    static const size_t DefaultBufferSize = 1 << 20;
+
+    /* Write results in the passed format to the stream. The categories
+        give the IDs of compact formats. For binary output the stream must
+        not translate line ends */
+    ResultWriter(ostream& output, ResultFormat format, const vector<string>& categories,
+                 bool backgroundWrite, size_t bufferSize = DefaultBufferSize);
+
+    // Stops the background thread. Call finish() first to find write errors
+    ~ResultWriter();
+
+    // Write the result for one document. Throws for an unknown category
+    void write(const string& path, const string& category);
+
+    // Write everything collected so far and stop. Throws if anything failed to write
+    void finish();
+
+private:
+    ostream& _output;
+    const ResultFormat _format;
+    map<string, size_t> _categoryIds;
+    const size_t _bufferSize;
+
+    // Results being collected
+    string _buffer;
+
+    /* With a background thread, the buffer it is writing. Empty when the
+        thread is free for the next one */
+    bool _backgroundWrite;
+    string _writing;
+    bool _stopping;
+    bool _failed;
+    std::mutex _lock;
+    std::condition_variable _changed;
+    std::thread _thread;
+
+    // Write out the collected results, or hand them to the background thread
+    void flushBuffer();
+
+    // Thread body, which writes each buffer handed to it
+    void writeWorker();
+
+    // Stop the background thread once it has written everything
+    void stopThread();
+
+    // Make non-copyable, the thread refers to this object
+    ResultWriter(const ResultWriter& other);
+    ResultWriter& operator=(const ResultWriter& other);
+};
+
+#endif // RESULT_WRITER_H
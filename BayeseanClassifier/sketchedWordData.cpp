@@ -0,0 +1,236 @@
+/* This file is part of BayseanClassifier. It classifies documents into
+    categories based on the classic Baysean classification algorithm.
+
+    Copyright (C) 2016   Ezra Erb
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License version 3 as published
+    by the Free Software Foundation.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+    I'd appreciate a note if you find this program useful or make
+    updates. Please contact me through LinkedIn (my profile also has
+    a link to the code depository)
+*/
+#include <string>
+#include <vector>
+#include <map>
+#include <set>
+#include <cmath>
+#include <sstream>
+
+#include "sketchedWordData.h"
+#include "baseException.h"
+
+using namespace std;
+
+// Base of natural logarithms, which sets the sketch width for an error rate
+static const double NaturalBase = 2.718281828459045;
+
+// Size the table for the error rate and the probability of exceeding it
+CountMinSketch::CountMinSketch(double errorRate, double failureRate)
+    : _width(0), _depth(0), _total(0), _counters()
+{
+    if ((!(errorRate > 0.0)) || (errorRate >= 1.0) || (!(failureRate > 0.0)) ||
+        (failureRate >= 1.0)) {
+        stringstream errorMessage;
+        errorMessage << "Error, sketch error rate " << errorRate << " and failure rate "
+                     << failureRate << " must both be between zero and one";
+        THROW_BASE_EXCEPTION(errorMessage.str().c_str());
+    }
+    _width = (size_t)ceil(NaturalBase / errorRate);
+    _depth = (size_t)ceil(log(1.0 / failureRate));
+    _counters.resize(_width * _depth, 0);
+}
+
+// Hash of the word, split in two to pick the counter in each row
+void CountMinSketch::hashRows(const string& word, size_t& first, size_t& step)
+{
+    unsigned long long hash = hashWord(word);
+    /* Each row steps from the first counter by a different multiple of the
+        second half, which is as good as a separate hash per row. The step is
+        odd so it never lands on the same counter every row */
+    first = (size_t)(hash & 0xFFFFFFFF);
+    step = (size_t)((hash >> 32) | 1);
+}
+
+void CountMinSketch::add(const string& word, unsigned long long count)
+{
+    size_t first, step;
+    hashRows(word, first, step);
+    size_t row;
+    for (row = 0; row < _depth; row++)
+        addCountChecked(_counters[(row * _width) + ((first + (row * step)) % _width)], count);
+    addCountChecked(_total, count);
+}
+
+// Estimated count of a word. Never less than its true count
+unsigned long long CountMinSketch::estimate(const string& word) const
+{
+    size_t first, step;
+    hashRows(word, first, step);
+    unsigned long long result = _counters[first % _width];
+    size_t row;
+    for (row = 1; row < _depth; row++) {
+        unsigned long long count = _counters[(row * _width) + ((first + (row * step)) % _width)];
+        if (count < result)
+            result = count;
+    }
+    return result;
+}
+
+// Add the counts of another sketch with the same table size
+void CountMinSketch::merge(const CountMinSketch& other)
+{
+    if ((other._width != _width) || (other._depth != _depth)) {
+        stringstream errorMessage;
+        errorMessage << "Internal error: merging sketches of different sizes";
+        THROW_BASE_EXCEPTION(errorMessage.str().c_str());
+    }
+    size_t index;
+    for (index = 0; index < _counters.size(); index++)
+        addCountChecked(_counters[index], other._counters[index]);
+    addCountChecked(_total, other._total);
+}
+
+// Most an estimate is too high by
+unsigned long long CountMinSketch::getErrorBound() const
+{
+    return (unsigned long long)ceil(NaturalBase * (double)_total / (double)_width);
+}
+
+// Average amount a single row's counter is too high by
+double CountMinSketch::getExpectedError() const
+{
+    return (double)_total / (double)_width;
+}
+
+size_t CountMinSketch::getWidth() const
+{
+    return _width;
+}
+
+size_t CountMinSketch::getDepth() const
+{
+    return _depth;
+}
+
+SketchedWordData::SketchedWordData(const SketchSettings& settings)
+    : _capacity(settings._heavyHitters), _docCount(0), _wordCount(0), _totalWordCount(0),
+      _heavyHitters(), _byCount(), _sketch(settings._errorRate, settings._failureRate)
+{}
+
+// Add a new document to the category results
+void SketchedWordData::addDocument(const DocumentWordMap& docData)
+{
+    DocumentWordMap::const_iterator index;
+    for (index = docData.begin(); index != docData.end(); index++)
+        addWordCount(index->first, index->second);
+    addCountChecked(_docCount, 1);
+    addCountChecked(_wordCount, docData.size()); // Number of different words
+    addCountChecked(_totalWordCount, docData.getTotalWordCount());
+}
+
+// Add category totals found elsewhere, such as a counts file
+void SketchedWordData::addTotals(unsigned long long docCount, unsigned long long wordCount,
+                                 unsigned long long totalWordCount)
+{
+    addCountChecked(_docCount, docCount);
+    addCountChecked(_wordCount, wordCount);
+    addCountChecked(_totalWordCount, totalWordCount);
+}
+
+// Add word counts found elsewhere, such as a counts file
+void SketchedWordData::addWordCount(const string& word, unsigned long long count)
+{
+    _sketch.add(word, count);
+    addHeavyHitter(word, count);
+}
+
+// Count a word into the tracked words
+void SketchedWordData::addHeavyHitter(const string& word, unsigned long long count)
+{
+    if (_capacity == 0)
+        return;
+    HeavyHitterMap::iterator entry = _heavyHitters.find(word);
+    if (entry != _heavyHitters.end()) {
+        _byCount.erase(make_pair(entry->second._count, word));
+        addCountChecked(entry->second._count, count);
+        _byCount.insert(make_pair(entry->second._count, word));
+        return;
+    }
+
+    HeavyHitter newEntry;
+    if (_heavyHitters.size() >= _capacity) {
+        /* Replace the word with the smallest count. The new word could have
+            been seen up to that many times while it was not tracked */
+        set<pair<unsigned long long, string> >::iterator smallest = _byCount.begin();
+        newEntry._error = smallest->first;
+        newEntry._count = smallest->first;
+        _heavyHitters.erase(smallest->second);
+        _byCount.erase(smallest);
+    }
+    addCountChecked(newEntry._count, count);
+    _heavyHitters.insert(make_pair(word, newEntry));
+    _byCount.insert(make_pair(newEntry._count, word));
+}
+
+// Smallest tracked count if no more words can be tracked, otherwise zero
+unsigned long long SketchedWordData::getMissedBound() const
+{
+    if ((_capacity == 0) || (_heavyHitters.size() < _capacity))
+        return 0;
+    return _byCount.begin()->first;
+}
+
+// Merge other category data built with the same settings into this data
+void SketchedWordData::mergeData(const SketchedWordData& other)
+{
+    _sketch.merge(other._sketch);
+
+    /* A word tracked by only one side could have been seen by the other up
+        to its smallest tracked count, so add that to both count and error.
+        Then keep the words with the largest counts */
+    unsigned long long missed = getMissedBound();
+    unsigned long long otherMissed = other.getMissedBound();
+    HeavyHitterMap merged;
+    HeavyHitterMap::const_iterator index;
+    for (index = _heavyHitters.begin(); index != _heavyHitters.end(); index++) {
+        HeavyHitter& entry = merged[index->first];
+        entry = index->second;
+        HeavyHitterMap::const_iterator otherEntry = other._heavyHitters.find(index->first);
+        if (otherEntry != other._heavyHitters.end()) {
+            addCountChecked(entry._count, otherEntry->second._count);
+            addCountChecked(entry._error, otherEntry->second._error);
+        }
+        else {
+            addCountChecked(entry._count, otherMissed);
+            addCountChecked(entry._error, otherMissed);
+        }
+    }
+    for (index = other._heavyHitters.begin(); index != other._heavyHitters.end(); index++)
+        if (_heavyHitters.find(index->first) == _heavyHitters.end()) {
+            HeavyHitter& entry = merged[index->first];
+            entry = index->second;
+            addCountChecked(entry._count, missed);
+            addCountChecked(entry._error, missed);
+        }
+
+    _byCount.clear();
+    for (index = merged.begin(); index != merged.end(); index++)
+        _byCount.insert(make_pair(index->second._count, index->first));
+    while (_byCount.size() > _capacity) {
+        merged.erase(_byCount.begin()->second);
+        _byCount.erase(_byCount.begin());
+    }
+    _heavyHitters.swap(merged);
+
+    addTotals(other._docCount, other._wordCount, other._totalWordCount);
+}
@@ -0,0 +1,200 @@
+#ifndef SKETCHED_WORD_DATA_H
+#define SKETCHED_WORD_DATA_H
+
+/* This file is part of BayseanClassifier. It classifies documents into
+    categories based on the classic Baysean classification algorithm.
+
+    Copyright (C) 2016   Ezra Erb
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License version 3 as published
+    by the Free Software Foundation.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+    I'd appreciate a note if you find this program useful or make
+    updates. Please contact me through LinkedIn (my profile also has
+    a link to the code depository)
+*/
+#include <string>
+#include <vector>
+#include <map>
+#include <set>
+#include "documentWordMapFactory.h"
+
+using std::string;
+using std::vector;
+using std::map;
+using std::set;
+using std::pair;
+
+// How to train with approximate word counts
+struct SketchSettings
+{
+    SketchSettings() : _heavyHitters(0), _errorRate(0.0001), _failureRate(0.001) {}
+
+    // Use default copy constructor, copy operator and destructor
+
+    // Words per category to keep exact counts for. Zero to count every word exactly
+    size_t _heavyHitters;
+
+    /* Estimated counts are too high by at most this share of the words in
+        the category... */
+    double _errorRate;
+
+    // ...except with this probability
+    double _failureRate;
+};
+
+/* A count-min sketch. Counts words in a fixed table of counters, several
+    rows deep, where each row adds the count to one counter picked by a hash
+    of the word. Words that share a counter add to each other's counts, so
+    the smallest counter of a word over all rows is an estimate that is
+    never too low. The table size is picked from the wanted error bounds,
+    not from the number of words */
+class CountMinSketch
+{
+public:
+    // Size the table for the error rate and the probability of exceeding it
+    CountMinSketch(double errorRate, double failureRate);
+
+    // Use default copy constructor, copy operator and destructor
+
+    void add(const string& word, unsigned long long count);
+
+    // Estimated count of a word. Never less than its true count
+    unsigned long long estimate(const string& word) const;
+
+    /* Add the counts of another sketch with the same table size. Throws if
+        the sizes differ */
+    void merge(const CountMinSketch& other);
+
+    /* Most an estimate is too high by, except with the failure probability
+        the sketch was built for */
+    unsigned long long getErrorBound() const;
+
+    /* Average amount a single row's counter is too high by, from the other
+        words sharing it. Estimates take the smallest row, so are usually off
+        by less */
+    double getExpectedError() const;
+
+    size_t getWidth() const;
+    size_t getDepth() const;
+
+private:
+    size_t _width;
+    size_t _depth;
+    unsigned long long _total;
+    vector<unsigned long long> _counters;
+
+    // Hash of the word, split in two to pick the counter in each row
+    static void hashRows(const string& word, size_t& first, size_t& step);
+};
+
+/* Approximate data about a category of documents, for training over huge
+    vocabularies in fixed memory. The most common words have exact counts,
+    found with the space saving algorithm: a fixed number of words are
+    tracked, and a new word replaces the one with the smallest count, taking
+    that count as the most it could have been missed by. Every word is also
+    added to a count-min sketch, which estimates the rest.
+
+    Document and word totals are exact, as for CatWordData */
+class SketchedWordData
+{
+public:
+    // Count for a tracked word, and the most it could be too high by
+    struct HeavyHitter
+    {
+        HeavyHitter() : _count(0), _error(0) {}
+
+        // Use default copy constructor, copy operator and destructor
+
+        unsigned long long _count;
+        unsigned long long _error;
+    };
+
+    typedef map<string, HeavyHitter> HeavyHitterMap;
+
+    explicit SketchedWordData(const SketchSettings& settings);
+
+    // Use default copy constructor, assignment operator, and destructor
+
+    // Add a new document to the category results. Throws if a count overflows
+    void addDocument(const DocumentWordMap& docData);
+
+    /* Add category totals and word counts found elsewhere, such as a
+        counts file. Throws if a count overflows */
+    void addTotals(unsigned long long docCount, unsigned long long wordCount,
+                   unsigned long long totalWordCount);
+    void addWordCount(const string& word, unsigned long long count);
+
+    /* Merge other category data built with the same settings into this
+        data. Throws if a count overflows */
+    void mergeData(const SketchedWordData& other);
+
+    unsigned long long getDocCount() const;
+    unsigned long long getWordCount() const;
+    unsigned long long getTotalWordCount() const;
+
+    // The tracked words with exact or nearly exact counts
+    const HeavyHitterMap& getHeavyHitters() const;
+
+    // Estimates for all other words
+    const CountMinSketch& getSketch() const;
+
+private:
+    size_t _capacity;
+    unsigned long long _docCount;
+    unsigned long long _wordCount;
+    unsigned long long _totalWordCount;
+    HeavyHitterMap _heavyHitters;
+
+    // The tracked words by count, so the smallest can be found quickly
+    set<pair<unsigned long long, string> > _byCount;
+
+    CountMinSketch _sketch;
+
+    // Count a word into the tracked words
+    void addHeavyHitter(const string& word, unsigned long long count);
+
+    // Smallest tracked count if no more words can be tracked, otherwise zero
+    unsigned long long getMissedBound() const;
+};
+
+// Number of documents in category
+inline unsigned long long SketchedWordData::getDocCount() const
+{
+    return _docCount;
+}
+
+// Number of different words in category documents
+inline unsigned long long SketchedWordData::getWordCount() const
+{
+    return _wordCount;
+}
+
+// Overall number of words in documents
+inline unsigned long long SketchedWordData::getTotalWordCount() const
+{
+    return _totalWordCount;
+}
+
+// The tracked words with exact or nearly exact counts
+inline const SketchedWordData::HeavyHitterMap& SketchedWordData::getHeavyHitters() const
+{
+    return _heavyHitters;
+}
+
+// Estimates for all other words
+inline const CountMinSketch& SketchedWordData::getSketch() const
+{
+    return _sketch;
+}
+
+#endif // SKETCHED_WORD_DATA_H
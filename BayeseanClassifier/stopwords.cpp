@@ -37,7 +37,7 @@ using namespace std;
 /* Initialize the stopword list from the supplied file. Not finding
     it causes an exception */
 Stopwords::Stopwords(const string& dataFileName)
-    : _wordList()
+    : _wordList(), _hash(0)
 {
     // Read file in a try..catch block to ensure it is closed on error
     ifstream dataFile;
@@ -69,6 +69,20 @@ Stopwords::Stopwords(const string& dataFileName)
             THROW_BASE_EXCEPTION(errorMessage.str().c_str());
         }
         dataFile.close();
+
+        /* Hash the words with FNV-1a. The set is sorted, so the hash does not
+            depend on how the file was laid out */
+        _hash = 14695981039346656037ULL;
+        set<string>::const_iterator index;
+        for (index = _wordList.begin(); index != _wordList.end(); index++) {
+            string::const_iterator letter;
+            for (letter = index->begin(); letter != index->end(); letter++) {
+                _hash ^= (unsigned char)*letter;
+                _hash *= 1099511628211ULL;
+            }
+            // Separator, so word boundaries count
+            _hash *= 1099511628211ULL;
+        }
     } // Try block
     catch (...) {
         /* Close file, and delete word list to ensure class is always in
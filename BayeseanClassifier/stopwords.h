@@ -47,16 +47,28 @@ class Stopwords
             for debugging */
         string allStopwords() const;
 
+        /* Return a hash of the word list. Results saved from processing
+            documents are only valid for the same list */
+        unsigned long long getHash() const;
+
 
     private:
         // The words
         set<string> _wordList;
 
+        // Hash of the words, found once the list is loaded
+        unsigned long long _hash;
+
         // Make non-copyable, ensures all clients use the same list
         Stopwords(const Stopwords& other);
         Stopwords& operator=(const Stopwords& other);
 };
 
+inline unsigned long long Stopwords::getHash() const
+{
+    return _hash;
+}
+
 inline bool Stopwords::isStopword(const string& word) const
 {
     // The classic set search
@@ -0,0 +1,206 @@
+/* This file is part of BayseanClassifier. It classifies documents into
+    categories based on the classic Baysean classification algorithm.
+
+    Copyright (C) 2016   Ezra Erb
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License version 3 as published
+    by the Free Software Foundation.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+    I'd appreciate a note if you find this program useful or make
+    updates. Please contact me through LinkedIn (my profile also has
+    a link to the code depository)
+*/
+#include <string>
+#include <vector>
+
+#if defined(_M_X64) || defined(_M_AMD64) || (defined(_M_IX86_FP) && (_M_IX86_FP >= 2)) || \
+    defined(__SSE2__)
+#define TOKEN_SCANNER_SSE2
+#include <emmintrin.h>
+#endif
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+#include "tokenScanner.h"
+
+using namespace std;
+
+const size_t TokenScanner::BlockSize;
+
+// Position of the lowest and highest set bits of a non-zero value
+static inline unsigned int lowestBit(unsigned int bits)
+{
+#ifdef _MSC_VER
+    unsigned long index;
+    _BitScanForward(&index, bits);
+    return index;
+#else
+    return __builtin_ctz(bits);
+#endif
+}
+
+static inline unsigned int highestBit(unsigned int bits)
+{
+#ifdef _MSC_VER
+    unsigned long index;
+    _BitScanReverse(&index, bits);
+    return index;
+#else
+    return 31 - __builtin_clz(bits);
+#endif
+}
+
+// Convert and mark a document
+TokenScanner::TokenScanner(const char* data, size_t length)
+    : _folded(), _length(0), _spaces(), _letters(), _position(0)
+{
+    scan(data, length);
+}
+
+// Construct with no document, for a scanner that will be reused
+TokenScanner::TokenScanner()
+    : _folded(), _length(0), _spaces(), _letters(), _position(0)
+{
+    scan(NULL, 0);
+}
+
+// Convert and mark a document, replacing any scanned before
+void TokenScanner::scan(const char* data, size_t length)
+{
+    if (length > 0)
+        _folded.assign(data, length);
+    else
+        _folded.clear();
+    _length = length;
+    // An extra block so a search can always look one block past the end
+    _spaces.assign(length / BlockSize + 1, 0);
+    _letters.assign(length / BlockSize + 1, 0);
+    _position = 0;
+
+    size_t position = 0;
+#ifdef TOKEN_SCANNER_SSE2
+    const __m128i beforeUpper = _mm_set1_epi8('A' - 1);
+    const __m128i afterUpper = _mm_set1_epi8('Z' + 1);
+    const __m128i beforeLower = _mm_set1_epi8('a' - 1);
+    const __m128i afterLower = _mm_set1_epi8('z' + 1);
+    const __m128i caseBit = _mm_set1_epi8(0x20);
+    const __m128i blank = _mm_set1_epi8(' ');
+    const __m128i beforeControl = _mm_set1_epi8('\t' - 1);
+    const __m128i afterControl = _mm_set1_epi8('\r' + 1);
+    for (; position + 16 <= length; position += 16) {
+        __m128i bytes = _mm_loadu_si128((const __m128i*)(_folded.data() + position));
+
+        /* Comparisons are signed, so bytes of 0x80 and up are negative and
+            are never letters or whitespace, the same as in the C locale */
+        __m128i upper = _mm_and_si128(_mm_cmpgt_epi8(bytes, beforeUpper),
+                                      _mm_cmplt_epi8(bytes, afterUpper));
+        bytes = _mm_or_si128(bytes, _mm_and_si128(upper, caseBit));
+        _mm_storeu_si128((__m128i*)&_folded[position], bytes);
+
+        __m128i letter = _mm_and_si128(_mm_cmpgt_epi8(bytes, beforeLower),
+                                       _mm_cmplt_epi8(bytes, afterLower));
+        // Letters were folded, but whitespace is never changed by it
+        __m128i space = _mm_or_si128(_mm_cmpeq_epi8(bytes, blank),
+                                     _mm_and_si128(_mm_cmpgt_epi8(bytes, beforeControl),
+                                                   _mm_cmplt_epi8(bytes, afterControl)));
+
+        // Blocks are two SSE2 registers long, so each fills half a mark word
+        unsigned int shift = (unsigned int)(position % BlockSize);
+        _letters[position / BlockSize] |= (unsigned int)_mm_movemask_epi8(letter) << shift;
+        _spaces[position / BlockSize] |= (unsigned int)_mm_movemask_epi8(space) << shift;
+    }
+#endif
+    for (; position < length; position++)
+        markByte(position);
+
+    // Mark the space past the end as whitespace, so searches for it stop there
+    for (position = length; position < _spaces.size() * BlockSize; position++)
+        _spaces[position / BlockSize] |= 1u << (position % BlockSize);
+}
+
+// Mark a single byte
+void TokenScanner::markByte(size_t position)
+{
+    char letter = _folded[position];
+    if ((letter >= 'A') && (letter <= 'Z')) {
+        letter = (char)(letter - 'A' + 'a');
+        _folded[position] = letter;
+    }
+    unsigned int bit = 1u << (position % BlockSize);
+    if ((letter >= 'a') && (letter <= 'z'))
+        _letters[position / BlockSize] |= bit;
+    else if ((letter == ' ') || ((letter >= '\t') && (letter <= '\r')))
+        _spaces[position / BlockSize] |= bit;
+}
+
+// Find the first marked position from start, stopping at the limit
+size_t TokenScanner::findNext(const vector<unsigned int>& marks, unsigned int flip,
+                              size_t start, size_t limit) const
+{
+    if (start >= limit)
+        return limit;
+    size_t block = start / BlockSize;
+    unsigned int bits = (marks[block] ^ flip) & (~0u << (start % BlockSize));
+    while (!bits) {
+        block++;
+        if (block * BlockSize >= limit)
+            return limit;
+        bits = marks[block] ^ flip;
+    }
+    size_t found = block * BlockSize + lowestBit(bits);
+    return (found < limit) ? found : limit;
+}
+
+// Find the next whitespace delimited word
+bool TokenScanner::nextWord(size_t& start, size_t& end)
+{
+    start = findNext(_spaces, ~0u, _position, _length);
+    if (start >= _length) {
+        _position = _length;
+        return false;
+    }
+    end = findNext(_spaces, 0, start, _length);
+    _position = end;
+    return true;
+}
+
+// Position of the first letter in the range, or end if there is none
+size_t TokenScanner::findFirstLetter(size_t start, size_t end) const
+{
+    return findNext(_letters, 0, start, end);
+}
+
+// Position of the last letter in the range, or end if there is none
+size_t TokenScanner::findLastLetter(size_t start, size_t end) const
+{
+    if (start >= end)
+        return end;
+    size_t firstBlock = start / BlockSize;
+    size_t block = (end - 1) / BlockSize;
+    unsigned int bits = _letters[block] & (~0u >> (BlockSize - 1 - (end - 1) % BlockSize));
+    while (true) {
+        if (block == firstBlock) {
+            // Letters before the range don't count
+            bits &= ~0u << (start % BlockSize);
+            break;
+        }
+        if (bits)
+            break;
+        block--;
+        bits = _letters[block];
+    }
+    if (!bits)
+        return end;
+    return block * BlockSize + highestBit(bits);
+}
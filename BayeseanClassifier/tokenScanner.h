@@ -0,0 +1,97 @@
+#ifndef TOKEN_SCANNER_H
+#define TOKEN_SCANNER_H
+
+/* This file is part of BayseanClassifier. It classifies documents into
+    categories based on the classic Baysean classification algorithm.
+
+    Copyright (C) 2016   Ezra Erb
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License version 3 as published
+    by the Free Software Foundation.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+    I'd appreciate a note if you find this program useful or make
+    updates. Please contact me through LinkedIn (my profile also has
+    a link to the code depository)
+*/
+#include <string>
+#include <vector>
+
+using std::string;
+using std::vector;
+
+/* This class finds the words in a document for the tokenizer. The whole
+    document is converted to lowercase and every byte is marked as whitespace
+    and as a letter or not in one pass, which is done 16 bytes at a time with
+    SSE2 where available. Words and the letters within them are then found
+    from the marks a block at a time, rather than testing every character
+    against a list.
+
+    Whitespace has the same definition as isspace() in the C locale and
+    letters are 'a' to 'z' after conversion to lowercase, which are the rules
+    the tokenizer used before, so the results are exactly the same. The
+    portable code gives the same marks on processors without SSE2 */
+class TokenScanner
+{
+public:
+    // Convert and mark a document. The data is copied
+    TokenScanner(const char* data, size_t length);
+
+    /* Construct with no document, for a scanner that will be reused for
+        many. Call scan() before anything else */
+    TokenScanner();
+
+    // Use default destructor
+
+    /* Convert and mark a document, replacing any scanned before. The data is
+        copied. Buffers are reused, so they only grow for larger documents */
+    void scan(const char* data, size_t length);
+
+    /* Find the next whitespace delimited word. Returns false if there are
+        no more. End is one past the last character */
+    bool nextWord(size_t& start, size_t& end);
+
+    // The document in lowercase
+    const char* getFolded() const
+    {
+        return _folded.data();
+    }
+
+    // Position of the first letter in the range, or end if there is none
+    size_t findFirstLetter(size_t start, size_t end) const;
+
+    // Position of the last letter in the range, or end if there is none
+    size_t findLastLetter(size_t start, size_t end) const;
+
+private:
+    // Marks are kept as bits, one word of them per block of the document
+    static const size_t BlockSize = 32;
+
+    string _folded;
+    size_t _length;
+    vector<unsigned int> _spaces;
+    vector<unsigned int> _letters;
+    size_t _position;
+
+    // Mark a single byte, for the parts of the document not done in blocks
+    void markByte(size_t position);
+
+    /* Find the first marked position from start, stopping at the limit. Marks
+        are inverted by the flip mask first */
+    size_t findNext(const vector<unsigned int>& marks, unsigned int flip, size_t start,
+                    size_t limit) const;
+
+    // Make non-copyable, the scan is for a single pass over each document
+    TokenScanner(const TokenScanner& other);
+    TokenScanner& operator=(const TokenScanner& other);
+};
+
+#endif // TOKEN_SCANNER_H
@@ -0,0 +1,92 @@
+#ifndef VARINT_CODING_H
+#define VARINT_CODING_H
+
+/* This file is part of BayseanClassifier. It classifies documents into
+    categories based on the classic Baysean classification algorithm.
+
+    Copyright (C) 2016   Ezra Erb
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License version 3 as published
+    by the Free Software Foundation.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+    I'd appreciate a note if you find this program useful or make
+    updates. Please contact me through LinkedIn (my profile also has
+    a link to the code depository)
+*/
+#include <string>
+#include <cstddef>
+#include "baseException.h"
+
+using std::string;
+
+/* Variable length integers, as used by every binary file of the classifier.
+    Numbers are written seven bits at a time, low bits first, with the high
+    bit of a byte set if more follow. Strings are a length and the bytes.
+    These are called for every number of large files, so are inline */
+
+// Most bytes a number can take
+static const size_t MaxNumberBytes = 10;
+
+// Write a number into the passed buffer, and return the bytes it took
+inline size_t encodeNumber(unsigned long long value, char* buffer)
+{
+    size_t length = 0;
+    while (value >= 0x80) {
+        buffer[length] = (char)((value & 0x7F) | 0x80);
+        length++;
+        value >>= 7;
+    }
+    buffer[length] = (char)value;
+    return length + 1;
+}
+
+inline void appendNumber(string& buffer, unsigned long long value)
+{
+    char bytes[MaxNumberBytes];
+    buffer.append(bytes, encodeNumber(value, bytes));
+}
+
+inline void appendString(string& buffer, const string& value)
+{
+    appendNumber(buffer, value.length());
+    buffer.append(value);
+}
+
+/* Read a number, advancing the position. Throws the passed message if the
+    data ends first */
+inline unsigned long long parseNumber(const string& data, size_t& pos, const char* corruptMessage)
+{
+    unsigned long long value = 0;
+    int shift = 0;
+    while (true) {
+        if ((pos >= data.length()) || (shift > 63))
+            THROW_BASE_EXCEPTION(corruptMessage);
+        unsigned char byte = (unsigned char)data[pos];
+        pos++;
+        value |= (unsigned long long)(byte & 0x7F) << shift;
+        if (!(byte & 0x80))
+            break;
+        shift += 7;
+    }
+    return value;
+}
+
+inline void parseString(const string& data, size_t& pos, string& value, const char* corruptMessage)
+{
+    unsigned long long length = parseNumber(data, pos, corruptMessage);
+    if (length > data.length() - pos)
+        THROW_BASE_EXCEPTION(corruptMessage);
+    value.assign(data, pos, (size_t)length);
+    pos += (size_t)length;
+}
+
+#endif // VARINT_CODING_H
@@ -43,162 +43,310 @@
   warning. A file classified to a category not in the expected
   results is treated as misclassified.
 
-  Expected input: resultgs file root1 root2 ...
+  The count of documents for every pair of expected and assigned
+  categories can also be written out as a confusion matrix, to see
+  which categories get mistaken for each other.
+
+  Expected input: [--confusion-csv file] [--confusion-json file] resultgs file root1 root2 ...
 */
 #include <iostream>
-#include <fstream>
 #include <sstream>
-#include <map>
+#include <fstream>
 #include <string>
 #include <vector>
+#include <cstring>
+#include <thread>
+#include <functional>
+#include <exception>
 #include "baseException.h"
 #include "expectedResults.h"
+#include "mappedFile.h"
+#include "confusionMatrix.h"
 
 using namespace std;
 
-struct CatStats {
-    CatStats() : _correct(0), _misclassToThis(0), _misclassToOther(0) {}
+
+/* Problem found with one line of the results file. Lines are parsed in
+    parallel, so problems are collected and reported in order afterward */
+struct LineWarning {
+    LineWarning() : _line(0), _fileName() {}
+
+    // Use default copy constructor, copy operator and destructor
+
+    // Line number within the section of the file being parsed
+    unsigned long long _line;
+
+    // File with no expected results. Empty if the line itself was invalid
+    string _fileName;
+};
+
+// Results of parsing one section of the results file
+struct SectionResults {
+    explicit SectionResults(const vector<string>& categories)
+        : _lineCount(0), _matrix(categories), _warnings(), _error() {}
 
     // Use default copy constructor, copy operator and destructor
 
-    // Documents correctly classified in this category
-    unsigned short _correct;
+    unsigned long long _lineCount;
+    ConfusionMatrix _matrix;
 
-    // Documents for some other category classified in this one
-    unsigned short _misclassToThis;
+    vector<LineWarning> _warnings;
 
-    // Documents for this category classifed in some other one
-    unsigned short _misclassToOther;
+    // Set if parsing failed
+    exception_ptr _error;
 };
 
-typedef map<string, CatStats> CategoryStatsMap;
+// Sections smaller than this are not worth a thread of their own
+static const size_t MinSectionSize = 1024 * 1024;
+
+// Process one line of the results file
+static void parseResultsLine(const char* line, size_t length, const ExpectedResults& expected,
+                             SectionResults& results)
+{
+    results._lineCount++;
+    // Files written in text mode on Windows end lines with a carriage return as well
+    if ((length > 0) && (line[length - 1] == '\r'))
+        length--;
+
+    /* Split into file path and category. To handle spaces in file
+        names, look for the last ': ' */
+    size_t splitPos = string::npos;
+    if (length >= 2) {
+        size_t pos = length - 1;
+        while ((pos > 0) && (splitPos == string::npos)) {
+            if ((line[pos - 1] == ':') && (line[pos] == ' '))
+                splitPos = pos - 1;
+            pos--;
+        }
+    }
+    // To be valid, must be found with text on either side
+    if ((splitPos == string::npos) || (splitPos == 0) || (splitPos + 2 >= length)) {
+        LineWarning warning;
+        warning._line = results._lineCount;
+        results._warnings.push_back(warning);
+        return;
+    }
+    /* Look up the file in the expected results. Not finding it indicates
+        a problem. Most likely, relative paths were specified for the
+        diretory hierarchy and they do not match up to the origianl
+        classification program */
+    size_t expectedCategory = expected.getCorrectCategoryId(line, splitPos);
+    if (expectedCategory == ExpectedResults::NoCategory) {
+        LineWarning warning;
+        warning._line = results._lineCount;
+        warning._fileName.assign(line, splitPos);
+        results._warnings.push_back(warning);
+        // Ignore it
+    }
+    else {
+        /* Categories are compared by ID. A category that is not a valid
+            result has no ID, so is counted as some other category */
+        size_t category = expected.getCategoryId(line + splitPos + 2, length - splitPos - 2);
+        if (category == ExpectedResults::NoCategory)
+            category = ConfusionMatrix::OtherCategory;
+        results._matrix.addResult(expectedCategory, category);
+    } // Expected results found
+}
 
+/* Process a section of the results file. Every section but the last ends
+    just after a newline. The text after the last newline of the file counts
+    as a line even if empty, as it does when reading with getline */
+static void parseResultsSection(const char* start, const char* end, bool lastSection,
+                                const ExpectedResults& expected, SectionResults& results)
+{
+    try {
+        const char* lineStart = start;
+        while (lineStart < end) {
+            const char* lineEnd = (const char*)memchr(lineStart, '\n', end - lineStart);
+            if (lineEnd == NULL) {
+                // Last line of the file, with no newline
+                parseResultsLine(lineStart, end - lineStart, expected, results);
+                return;
+            }
+            parseResultsLine(lineStart, lineEnd - lineStart, expected, results);
+            lineStart = lineEnd + 1;
+        }
+        if (lastSection)
+            parseResultsLine(end, 0, expected, results);
+    }
+    catch (...) {
+        results._error = current_exception();
+    }
+}
 
-// Given a results file and map of expected results, calculate classification success stats
+/* Given a results file and map of expected results, count how the documents of each
+    category were classified. The file is mapped into memory and split into sections at
+    line boundaries, which are parsed in parallel, each into its own matrix */
 void getClassifyResultStats(const string& resultsFile, const ExpectedResults& expected,
-                            CategoryStatsMap& stats)
+                            ConfusionMatrix& matrix)
 {
-    ifstream input;
-    string buffer;
-    stats.clear();
-    unsigned short lineCount = 0;
-    try { // Process in a try...catch block to ensure file does not leak
-        input.open(resultsFile.c_str());
-        if (!input.is_open()) {
-            stringstream errorMessage;
-            errorMessage << "Error, results file " << resultsFile << " could not be opened";
-            THROW_BASE_EXCEPTION(errorMessage.str().c_str());
+    matrix = ConfusionMatrix(expected.getCategories());
+    MappedFile input(resultsFile);
+    const char* data = input.getData();
+    size_t size = input.getSize();
+
+    size_t sectionCount = thread::hardware_concurrency();
+    if (sectionCount > size / MinSectionSize)
+        sectionCount = size / MinSectionSize;
+    if (sectionCount < 1)
+        sectionCount = 1;
+
+    // Move each split point forward to just after the next newline
+    vector<const char*> splits(1, data);
+    size_t index;
+    for (index = 1; index < sectionCount; index++) {
+        const char* split = data + (size / sectionCount) * index;
+        if (split < splits.back())
+            split = splits.back();
+        const char* newline = (const char*)memchr(split, '\n', (data + size) - split);
+        splits.push_back(newline != NULL ? newline + 1 : data + size);
+    }
+    splits.push_back(data + size);
+
+    vector<SectionResults> results(sectionCount, SectionResults(expected.getCategories()));
+    if (sectionCount == 1)
+        parseResultsSection(splits[0], splits[1], true, expected, results[0]);
+    else {
+        vector<thread> threads;
+        try {
+            for (index = 0; index < sectionCount; index++)
+                threads.push_back(thread(parseResultsSection, splits[index], splits[index + 1],
+                                         index + 1 == sectionCount, cref(expected),
+                                         ref(results[index])));
         }
-        // In Windows file paths can have spaces, so need to read line by line
-        while ((!input.fail()) && (!input.eof())) {
-            getline(input, buffer);
-            lineCount++;
-            /* Split into file path and category. To handle spaces in file
-                names, look for ': ' */
-            unsigned int splitPos = buffer.rfind(": ");
-            // To be valid, must be found with text on either side
-            if ((splitPos == string::npos) || (splitPos == 0) ||
-                (splitPos + 2 >= buffer.length()))
-                cout << "WARNING: " << resultsFile << " line " << lineCount
-                     << " ignored, missing file or category" << endl;
-            else {
-                string classifyFile(buffer.substr(0, splitPos));
-                string category(buffer.substr(splitPos + 2, buffer.length() - splitPos - 2));
-
-                /* Look up the file in the expected results map. Not finding it indicates
-                    a problem. Most likely, relative paths were specified for the
-                    diretory hierarchy and they do not match up to the origianl
-                    classification program */
-                string expectedCategory(expected.getCorrectCategory(classifyFile));
-                if (expectedCategory.empty()) {
-                    cout << "WARNING: Expected results not found for file " << classifyFile << endl;
-                    // Ignore it
-                }
-                else {
-                    // Locate the statistics for the correct category. Initialize if not found
-                    CatStats& correctStats = stats[expectedCategory];
-                    if (expectedCategory != category) { // Missclassified
-                        correctStats._misclassToOther++;
-                        /* If the category it was classifed under is a valid result,
-                            note this document as classifed in that category by mistake */
-                        if (expected.isCatValid(category))
-                            stats[category]._misclassToThis++;
-                    } // Misclassifed
-                    else
-                        correctStats._correct++;
-                } // Expected results found
-            } // Valid classification result
-        } // Lines to process
-        input.close();
-
-        /* If have no results at this point, the expected results directories
-            were likely specified with paths that did not match the original
-            classification. This is an error */
-        if (stats.size() <= 0) {
-            stringstream errorMessage;
-            errorMessage << "ERROR: results file " << resultsFile << " contained no files in expected category directories";
-            THROW_BASE_EXCEPTION(errorMessage.str().c_str());
+        catch (...) {
+            // Could not start every thread. Wait for the ones that did start
+            vector<thread>::iterator threadIndex;
+            for (threadIndex = threads.begin(); threadIndex != threads.end(); threadIndex++)
+                threadIndex->join();
+            throw;
         }
+        vector<thread>::iterator threadIndex;
+        for (threadIndex = threads.begin(); threadIndex != threads.end(); threadIndex++)
+            threadIndex->join();
     }
-    catch (...) {
-        if (input.is_open())
-            input.close();
-        throw;
+
+    // Report problems in file order, and combine the counts
+    unsigned long long lineCount = 0;
+    for (index = 0; index < sectionCount; index++) {
+        const SectionResults& section = results[index];
+        if (section._error)
+            rethrow_exception(section._error);
+        vector<LineWarning>::const_iterator warningIndex;
+        for (warningIndex = section._warnings.begin(); warningIndex != section._warnings.end();
+             warningIndex++)
+            if (warningIndex->_fileName.empty())
+                cout << "WARNING: " << resultsFile << " line " << (lineCount + warningIndex->_line)
+                     << " ignored, missing file or category" << endl;
+            else
+                cout << "WARNING: Expected results not found for file " << warningIndex->_fileName
+                     << endl;
+        matrix.merge(section._matrix);
+        lineCount += section._lineCount;
+    }
+
+    /* If have no results at this point, the expected results directories
+        were likely specified with paths that did not match the original
+        classification. This is an error */
+    if (matrix.getTotal() == 0) {
+        stringstream errorMessage;
+        errorMessage << "ERROR: results file " << resultsFile << " contained no files in expected category directories";
+        THROW_BASE_EXCEPTION(errorMessage.str().c_str());
+    }
+}
+
+// Write the confusion matrix to a file in the given format
+void writeMatrix(const ConfusionMatrix& matrix, const string& fileName, bool json)
+{
+    ofstream output(fileName.c_str());
+    if (!output.is_open()) {
+        stringstream errorMessage;
+        errorMessage << "Error, confusion matrix file " << fileName << " could not be opened";
+        THROW_BASE_EXCEPTION(errorMessage.str().c_str());
+    }
+    if (json)
+        matrix.writeJson(output);
+    else
+        matrix.writeCsv(output);
+    output.close();
+    if (output.fail()) {
+        stringstream errorMessage;
+        errorMessage << "Error, confusion matrix file " << fileName << " could not be written";
+        THROW_BASE_EXCEPTION(errorMessage.str().c_str());
     }
 }
 
 int main(int argc, char** argv)
 {
-    /* Need at least two arguments, a results file and the directory
-        organized by expected categories. Note that the program name
-        is also an argument! */
-    if (argc < 3) {
-        cerr << "ERROR: Not enough arguments" << endl
-             << "Usage: CategoryValidator.exe results_file directory_of_classified_files [additional_directories]" << endl;
+    /* Options come first, each followed by a file name. Note that the program
+        name is also an argument! */
+    string csvFile;
+    string jsonFile;
+    int firstArgument = 1;
+    bool valid = true;
+    while (valid && (firstArgument < argc) && (strncmp(argv[firstArgument], "--", 2) == 0)) {
+        if (firstArgument + 1 >= argc) {
+            cerr << "ERROR: " << argv[firstArgument] << " option specified without file name" << endl;
+            valid = false;
+        }
+        else if (strcmp(argv[firstArgument], "--confusion-csv") == 0)
+            csvFile = argv[firstArgument + 1];
+        else if (strcmp(argv[firstArgument], "--confusion-json") == 0)
+            jsonFile = argv[firstArgument + 1];
+        else {
+            cerr << "ERROR: unknown option " << argv[firstArgument] << " specified" << endl;
+            valid = false;
+        }
+        firstArgument += 2;
+    }
+
+    /* Need at least two more arguments, a results file and the directory
+        organized by expected categories */
+    if (valid && (argc - firstArgument < 2)) {
+        cerr << "ERROR: Not enough arguments" << endl;
+        valid = false;
     }
+    if (!valid)
+        cerr << "Usage: CategoryValidator.exe [options] results_file directory_of_classified_files [additional_directories]" << endl
+             << "Options:" << endl
+             << "--confusion-csv file   Writes the count of documents for each pair of expected and" << endl
+             << "                       assigned categories to the file as CSV" << endl
+             << "--confusion-json file  Writes the same counts, and the measures per category, as JSON" << endl;
     else {
         try {
             // Assemble expected results
             vector<string> resultsDirs;
             int index;
-            for (index = 2; index < argc; index++) // Program is zero, results file is 1
+            for (index = firstArgument + 1; index < argc; index++) // Results file is first
                 resultsDirs.push_back(argv[index]);
             ExpectedResults expectedResults(resultsDirs);
 
-            CategoryStatsMap stats;
-            getClassifyResultStats(argv[1], expectedResults, stats);
-
-            CategoryStatsMap::const_iterator statIndex;
-            for (statIndex = stats.begin(); statIndex != stats.end(); statIndex++) {
-                /* When evaluating a classification algorithm, people care about two things,
-                    precision and recall. Precision is the percentage of documents classified
-                    for a given category that actually belong there. Recall is the percentage
-                    of documents in a category that were classified there. These are normaly
-                    combined into a statistic called the balanced F-mesaure: F = PR/2(P+R)
-                    This code reports this statistic per category */
-                cout << statIndex->first << ": _correct: " << statIndex->second._correct
-                     << " _misclassToThis: " << statIndex->second._misclassToThis
-                     << " _misclassToOther: " << statIndex->second._misclassToOther << endl;
+            ConfusionMatrix matrix(expectedResults.getCategories());
+            getClassifyResultStats(argv[firstArgument], expectedResults, matrix);
 
+            const vector<string>& categories = matrix.getCategories();
+            size_t category;
+            for (category = 0; category < categories.size(); category++) {
                 /* NOTE: To appear in the categoy list, a document must have either been classified
-                    in the category, or supposed to be clssified in it. If ALL documents were classified in
-                    error for a category, precision or recall is zero. */
-                double precision = 0.0;
-                if ((statIndex->second._correct != 0) || (statIndex->second._misclassToThis != 0))
-                    precision = ((double)statIndex->second._correct /
-                                 ((double)statIndex->second._correct + (double)statIndex->second._misclassToThis));
-                double recall = 0.0;
-                if ((statIndex->second._correct != 0) || (statIndex->second._misclassToThis != 0))
-                    recall = ((double)statIndex->second._correct /
-                              ((double)statIndex->second._correct + (double)statIndex->second._misclassToOther));
-                double fmeasure = 0.0;
-                // Avoid a divide by zero for truly horrible classifiers
-                if (precision + recall)
-                    fmeasure = precision * recall * 2 / (precision + recall);
-
-                cout << statIndex->first << ": " << "Balance F measure: " << fmeasure
+                    in the category, or supposed to be clssified in it */
+                CatStats stats(matrix.getCatStats(category));
+                if ((stats._correct == 0) && (stats._misclassToThis == 0) &&
+                    (stats._misclassToOther == 0))
+                    continue;
+                cout << categories[category] << ": _correct: " << stats._correct
+                     << " _misclassToThis: " << stats._misclassToThis
+                     << " _misclassToOther: " << stats._misclassToOther << endl;
+
+                double precision, recall, fmeasure;
+                stats.getMeasures(precision, recall, fmeasure);
+                cout << categories[category] << ": " << "Balance F measure: " << fmeasure
                      << " precision: " << precision << " recall: " << recall << endl;
             } // For each category
+
+            if (!csvFile.empty())
+                writeMatrix(matrix, csvFile, false);
+            if (!jsonFile.empty())
+                writeMatrix(matrix, jsonFile, true);
         }
         catch (exception& e) {
             cerr << "ERROR: Caught exception " << e.what() << endl;
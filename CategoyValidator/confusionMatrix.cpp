@@ -0,0 +1,194 @@
+/* This file is part of Cagtegoy Validator for BayseanClassifier.
+    It verifies the classification of documents against expected
+    results and computes the accuacy of classification.
+
+    Copyright (C) 2016   Ezra Erb
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License version 3 as published
+    by the Free Software Foundation.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+    I'd appreciate a note if you find this program useful or make
+    updates. Please contact me through LinkedIn (my profile also has
+    a link to the code depository)
+*/
+#include <vector>
+#include <string>
+#include <sstream>
+#include <ostream>
+#include "confusionMatrix.h"
+#include "baseException.h"
+
+using namespace std;
+
+const size_t ConfusionMatrix::OtherCategory;
+
+// Calculate the precision, recall, and balanced F measure
+void CatStats::getMeasures(double& precision, double& recall, double& fmeasure) const
+{
+    precision = 0.0;
+    if ((_correct != 0) || (_misclassToThis != 0))
+        precision = ((double)_correct / ((double)_correct + (double)_misclassToThis));
+    recall = 0.0;
+    if ((_correct != 0) || (_misclassToOther != 0))
+        recall = ((double)_correct / ((double)_correct + (double)_misclassToOther));
+    fmeasure = 0.0;
+    // Avoid a divide by zero for truly horrible classifiers
+    if (precision + recall)
+        fmeasure = precision * recall * 2 / (precision + recall);
+}
+
+// Construct with the names of the categories, in ID order
+ConfusionMatrix::ConfusionMatrix(const vector<string>& categories)
+    : _categories(categories), _counts(categories.size() * (categories.size() + 1), 0)
+{}
+
+// Add the counts of another matrix for the same categories
+void ConfusionMatrix::merge(const ConfusionMatrix& other)
+{
+    if (other._categories != _categories) {
+        stringstream errorMessage;
+        errorMessage << "Internal error: merging confusion matrices for different categories";
+        THROW_BASE_EXCEPTION(errorMessage.str().c_str());
+    }
+    size_t index;
+    for (index = 0; index < _counts.size(); index++)
+        _counts[index] += other._counts[index];
+}
+
+// Total documents recorded
+unsigned long long ConfusionMatrix::getTotal() const
+{
+    unsigned long long total = 0;
+    vector<unsigned long long>::const_iterator index;
+    for (index = _counts.begin(); index != _counts.end(); index++)
+        total += *index;
+    return total;
+}
+
+// Summary of the results for one category
+CatStats ConfusionMatrix::getCatStats(size_t category) const
+{
+    CatStats stats;
+    stats._correct = getCount(category, category);
+    size_t index;
+    // Row is where documents of the category went, column is where documents came from
+    for (index = 0; index < _categories.size(); index++)
+        if (index != category) {
+            stats._misclassToOther += getCount(category, index);
+            stats._misclassToThis += getCount(index, category);
+        }
+    stats._misclassToOther += getCount(category, OtherCategory);
+    return stats;
+}
+
+// Quote a CSV field if it contains characters that would split it
+static void writeCsvField(ostream& output, const string& field)
+{
+    if (field.find_first_of(",\"\r\n") == string::npos) {
+        output << field;
+        return;
+    }
+    output << '"';
+    string::const_iterator index;
+    for (index = field.begin(); index != field.end(); index++) {
+        if (*index == '"')
+            output << '"';
+        output << *index;
+    }
+    output << '"';
+}
+
+// Write the matrix as CSV
+void ConfusionMatrix::writeCsv(ostream& output) const
+{
+    output << "expected";
+    vector<string>::const_iterator nameIndex;
+    for (nameIndex = _categories.begin(); nameIndex != _categories.end(); nameIndex++) {
+        output << ',';
+        writeCsvField(output, *nameIndex);
+    }
+    output << ",(other)" << endl;
+
+    size_t row;
+    for (row = 0; row < _categories.size(); row++) {
+        writeCsvField(output, _categories[row]);
+        size_t column;
+        for (column = 0; column < _categories.size(); column++)
+            output << ',' << getCount(row, column);
+        output << ',' << getCount(row, OtherCategory) << endl;
+    }
+}
+
+// Write a JSON string, escaping characters as needed
+static void writeJsonString(ostream& output, const string& value)
+{
+    output << '"';
+    string::const_iterator index;
+    for (index = value.begin(); index != value.end(); index++) {
+        unsigned char letter = (unsigned char)*index;
+        if ((letter == '"') || (letter == '\\'))
+            output << '\\' << *index;
+        else if (letter < 0x20) {
+            const char* digits = "0123456789abcdef";
+            output << "\\u00" << digits[letter >> 4] << digits[letter & 0xF];
+        }
+        else
+            output << *index;
+    }
+    output << '"';
+}
+
+// Write the matrix and the measures for each category as JSON
+void ConfusionMatrix::writeJson(ostream& output) const
+{
+    output << "{" << endl << "  \"categories\": [";
+    size_t row;
+    for (row = 0; row < _categories.size(); row++) {
+        if (row > 0)
+            output << ", ";
+        writeJsonString(output, _categories[row]);
+    }
+    output << "]," << endl;
+
+    /* Each row is an expected category. The last value of each row counts
+        documents assigned a category not in the list */
+    output << "  \"matrix\": [" << endl;
+    for (row = 0; row < _categories.size(); row++) {
+        output << "    [";
+        size_t column;
+        for (column = 0; column < _categories.size(); column++)
+            output << getCount(row, column) << ", ";
+        output << getCount(row, OtherCategory) << "]";
+        if (row + 1 < _categories.size())
+            output << ",";
+        output << endl;
+    }
+    output << "  ]," << endl;
+
+    output << "  \"measures\": [" << endl;
+    for (row = 0; row < _categories.size(); row++) {
+        CatStats stats(getCatStats(row));
+        double precision, recall, fmeasure;
+        stats.getMeasures(precision, recall, fmeasure);
+        output << "    {\"category\": ";
+        writeJsonString(output, _categories[row]);
+        output << ", \"correct\": " << stats._correct
+               << ", \"misclassToThis\": " << stats._misclassToThis
+               << ", \"misclassToOther\": " << stats._misclassToOther
+               << ", \"precision\": " << precision << ", \"recall\": " << recall
+               << ", \"fmeasure\": " << fmeasure << "}";
+        if (row + 1 < _categories.size())
+            output << ",";
+        output << endl;
+    }
+    output << "  ]" << endl << "}" << endl;
+}
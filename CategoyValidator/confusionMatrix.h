@@ -0,0 +1,137 @@
+#ifndef CONFUSION_MATRIX_H
+#define CONFUSION_MATRIX_H
+
+/* This file is part of Cagtegoy Validator for BayseanClassifier.
+    It verifies the classification of documents against expected
+    results and computes the accuacy of classification.
+
+    Copyright (C) 2016   Ezra Erb
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License version 3 as published
+    by the Free Software Foundation.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+    I'd appreciate a note if you find this program useful or make
+    updates. Please contact me through LinkedIn (my profile also has
+    a link to the code depository)
+*/
+
+#include <vector>
+#include <string>
+#include <ostream>
+
+using std::vector;
+using std::string;
+using std::ostream;
+
+// Classification results for one category
+struct CatStats {
+    CatStats() : _correct(0), _misclassToThis(0), _misclassToOther(0) {}
+
+    // Use default copy constructor, copy operator and destructor
+
+    /* When evaluating a classification algorithm, people care about two things,
+        precision and recall. Precision is the percentage of documents classified
+        for a given category that actually belong there. Recall is the percentage
+        of documents in a category that were classified there. These are normaly
+        combined into a statistic called the balanced F-mesaure: F = 2PR/(P+R)
+        If ALL documents were classified in error for a category, precision or
+        recall is zero */
+    void getMeasures(double& precision, double& recall, double& fmeasure) const;
+
+    // Documents correctly classified in this category
+    unsigned long long _correct;
+
+    // Documents for some other category classified in this one
+    unsigned long long _misclassToThis;
+
+    // Documents for this category classifed in some other one
+    unsigned long long _misclassToOther;
+};
+
+/* This class counts how documents of each expected category were classified,
+    for every pair of categories. This shows which categories get confused
+    with each other, not just how many documents were misclassified.
+
+    Rows are the expected category and columns the category assigned, both by
+    category ID. An extra column counts documents assigned a category that is
+    not in the expected results. The counts are one block of memory, so
+    recording a result is a single increment, and matrices filled by different
+    threads are merged by adding them */
+class ConfusionMatrix
+{
+public:
+    // Passed as the assigned category when it is not in the expected results
+    static const size_t OtherCategory = (size_t)-1;
+
+    // Construct with the names of the categories, in ID order
+    explicit ConfusionMatrix(const vector<string>& categories);
+
+    // Use default copy constructor, assignment operator, and destructor
+
+    // Record the result of classifying one document
+    void addResult(size_t expectedCategory, size_t actualCategory);
+
+    // Add the counts of another matrix for the same categories
+    void merge(const ConfusionMatrix& other);
+
+    // Documents expected in one category and classified in another
+    unsigned long long getCount(size_t expectedCategory, size_t actualCategory) const;
+
+    // Total documents recorded
+    unsigned long long getTotal() const;
+
+    // Summary of the results for one category
+    CatStats getCatStats(size_t category) const;
+
+    const vector<string>& getCategories() const;
+
+    /* Write the matrix as CSV. The first row and column hold the category
+        names, with assigned categories across and expected ones down */
+    void writeCsv(ostream& output) const;
+
+    // Write the matrix and the measures for each category as JSON
+    void writeJson(ostream& output) const;
+
+private:
+    vector<string> _categories;
+
+    // Rows of category count plus one columns, by expected category
+    vector<unsigned long long> _counts;
+
+    // Position of a count in the storage. Other category is the last column
+    size_t countIndex(size_t expectedCategory, size_t actualCategory) const;
+};
+
+inline size_t ConfusionMatrix::countIndex(size_t expectedCategory, size_t actualCategory) const
+{
+    if (actualCategory == OtherCategory)
+        actualCategory = _categories.size();
+    return (expectedCategory * (_categories.size() + 1)) + actualCategory;
+}
+
+inline void ConfusionMatrix::addResult(size_t expectedCategory, size_t actualCategory)
+{
+    _counts[countIndex(expectedCategory, actualCategory)]++;
+}
+
+inline unsigned long long ConfusionMatrix::getCount(size_t expectedCategory,
+                                                    size_t actualCategory) const
+{
+    return _counts[countIndex(expectedCategory, actualCategory)];
+}
+
+inline const vector<string>& ConfusionMatrix::getCategories() const
+{
+    return _categories;
+}
+
+#endif // CONFUSION_MATRIX_H
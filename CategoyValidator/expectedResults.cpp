@@ -48,6 +48,8 @@
 
 using namespace std;
 
+const size_t ExpectedResults::NoCategory;
+
 ExpectedResults::ExpectedResults(const vector<string>& dirRoots)
 {
     if (dirRoots.size() <= 0) {
@@ -63,12 +65,17 @@ ExpectedResults::ExpectedResults(const vector<string>& dirRoots)
 
     vector<string>::const_iterator index;
 
+    // Category of each file, found first so IDs can be given in name order
+    vector<string> fileCategories;
+    fileCategories.reserve(fileList.size());
+    set<string> categoryNames;
+    size_t totalPathLength = 0;
     for (index = fileList.begin(); index != fileList.end(); index++) {
         /* With the required directoy setup, the last directory above
             the file name is the category. Find it in the path. If not
             found, its an error */
-        unsigned int secondLastSlash = string::npos;
-        unsigned int lastSlash = index->find_last_of("/\\");
+        size_t secondLastSlash = string::npos;
+        size_t lastSlash = index->find_last_of("/\\");
         if ((lastSlash != string::npos) && (lastSlash != 0))
             secondLastSlash = index->find_last_of("/\\", lastSlash - 1);
         if ((secondLastSlash == string::npos) ||
@@ -80,32 +87,123 @@ ExpectedResults::ExpectedResults(const vector<string>& dirRoots)
         }
 
         // NOTE: The extra 1 to avoid the slash before the category
-        string category(index->substr(secondLastSlash + 1, lastSlash - secondLastSlash - 1));
-        _expectedResults.insert(make_pair(*index, category));
-        _validCategories.insert(category);
-
+        fileCategories.push_back(index->substr(secondLastSlash + 1, lastSlash - secondLastSlash - 1));
+        categoryNames.insert(fileCategories.back());
+        totalPathLength += index->length();
     } // Loop on found files
 
     // If no files at all were found, issue an exception for bad directories
-    if (_validCategories.size() <= 0) {
+    if (categoryNames.size() <= 0) {
         stringstream errorMessage;
         errorMessage << "ERROR: results directories contained no files";
         THROW_BASE_EXCEPTION(errorMessage.str().c_str());
     }
+
+    _categories.assign(categoryNames.begin(), categoryNames.end());
+    map<string, unsigned int> categoryIds;
+    size_t categoryIndex;
+    for (categoryIndex = 0; categoryIndex < _categories.size(); categoryIndex++)
+        categoryIds[_categories[categoryIndex]] = (unsigned int)categoryIndex;
+
+    // Keep the index at most half full, so searches stay short
+    size_t indexSize = 16;
+    while (indexSize < fileList.size() * 2)
+        indexSize *= 2;
+    _index.assign(indexSize, 0);
+    _paths.reserve(totalPathLength);
+    _entries.reserve(fileList.size());
+
+    size_t fileIndex;
+    for (fileIndex = 0; fileIndex < fileList.size(); fileIndex++) {
+        const string& path = fileList[fileIndex];
+        size_t slot = findSlot(path.data(), path.length());
+        // The same file found twice keeps its first category
+        if (_index[slot] != 0)
+            continue;
+        Entry entry;
+        entry._pathStart = _paths.length();
+        entry._pathLength = (unsigned int)path.length();
+        entry._category = categoryIds[fileCategories[fileIndex]];
+        _paths.append(path);
+        _entries.push_back(entry);
+        _index[slot] = (unsigned int)_entries.size();
+    } // Loop on found files
+}
+
+// Returns the ID of a category. Returns NoCategory if it is not valid
+size_t ExpectedResults::getCategoryId(const char* category, size_t length) const
+{
+    // Categories are in name order, so binary search them
+    size_t low = 0;
+    size_t high = _categories.size();
+    while (low < high) {
+        size_t middle = low + ((high - low) / 2);
+        int compare = _categories[middle].compare(0, string::npos, category, length);
+        if (compare == 0)
+            return middle;
+        else if (compare < 0)
+            low = middle + 1;
+        else
+            high = middle;
+    }
+    return NoCategory;
+}
+
+// Hash a path, ignoring the difference between path separators
+size_t ExpectedResults::hashPath(const char* path, size_t length)
+{
+    // FNV-1a
+    unsigned long long hash = 14695981039346656037ULL;
+    size_t index;
+    for (index = 0; index < length; index++) {
+        char value = path[index];
+        if (value == '/')
+            value = '\\';
+        hash ^= (unsigned char)value;
+        hash *= 1099511628211ULL;
+    }
+    return (size_t)(hash ^ (hash >> 32));
+}
+
+// Returns true if two paths match, ignoring the difference between path separators
+bool ExpectedResults::pathsMatch(const char* path1, const char* path2, size_t length)
+{
+    size_t index;
+    for (index = 0; index < length; index++)
+        if (path1[index] != path2[index]) {
+            if (((path1[index] != '/') && (path1[index] != '\\')) ||
+                ((path2[index] != '/') && (path2[index] != '\\')))
+                return false;
+        }
+    return true;
+}
+
+// Find the index slot for a path. Either holds the path, or is empty
+size_t ExpectedResults::findSlot(const char* path, size_t length) const
+{
+    size_t mask = _index.size() - 1;
+    size_t slot = hashPath(path, length) & mask;
+    while (_index[slot] != 0) {
+        const Entry& entry = _entries[_index[slot] - 1];
+        if ((entry._pathLength == length) &&
+            pathsMatch(_paths.data() + entry._pathStart, path, length))
+            break;
+        slot = (slot + 1) & mask;
+    }
+    return slot;
 }
 
 // Logs the object conents to standard out for debugging
 void ExpectedResults::debugOutput() const
 {
-    map<string, string>::const_iterator resultsIndex;
-    for (resultsIndex = _expectedResults.begin(); resultsIndex != _expectedResults.end();
-         resultsIndex++)
-        cout << resultsIndex->first << ": " << resultsIndex->second << endl;
-    set<string>::const_iterator catIndex;
+    vector<Entry>::const_iterator entryIndex;
+    for (entryIndex = _entries.begin(); entryIndex != _entries.end(); entryIndex++) {
+        cout.write(_paths.data() + entryIndex->_pathStart, entryIndex->_pathLength);
+        cout << ": " << _categories[entryIndex->_category] << endl;
+    }
+    vector<string>::const_iterator catIndex;
     cout << "Valid categories:";
-    for (catIndex = _validCategories.begin(); catIndex != _validCategories.end();
-         catIndex++)
+    for (catIndex = _categories.begin(); catIndex != _categories.end(); catIndex++)
         cout << " " << *catIndex;
     cout << endl;
 }
-
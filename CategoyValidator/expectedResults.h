@@ -25,23 +25,49 @@
 */
 
 #include <vector>
-#include <map>
-#include <set>
 #include <string>
 
 using std::vector;
-using std::map;
-using std::set;
 using std::string;
 
+/* This class holds the correct category of every document in directory trees
+    of documents by category. Results files can have tens of millions of
+    lines, so it is built for size and lookup speed:
+    - All paths are stored end to end in one string, and each document
+      refers to its path by position
+    - Categories are stored once, and documents refer to them by ID. IDs
+      are in category name order
+    - Documents are found by a hash of their path. Lookups take a pointer
+      and length, so callers can search with text straight from a buffer
+    Paths are compared with '/' and '\\' treated as the same, so results
+    written with either separator will match */
 class ExpectedResults
 {
 public:
+    // Returned for a file or category not found
+    static const size_t NoCategory = (size_t)-1;
+
     /* Construct with the vector of roots of directory trees
         of documents by category. If any are invalid, construction
         fails and an exception is thrown */
     explicit ExpectedResults(const vector<string>& dirRoots);
 
+    // Use default copy constructor, assignment operator, and destructor
+
+    // Returns the category ID for a file. Returns NoCategory if none found
+    size_t getCorrectCategoryId(const char* fileName, size_t length) const;
+
+    // Returns the ID of a category. Returns NoCategory if it is not valid
+    size_t getCategoryId(const char* category, size_t length) const;
+
+    // Number of valid categories. IDs are below this
+    size_t getCategoryCount() const;
+
+    const string& getCategoryName(size_t categoryId) const;
+
+    // Valid categories, in ID order
+    const vector<string>& getCategories() const;
+
     // Returns the category for a file. Returns the empty string if none found
     string getCorrectCategory(const string& fileName) const;
 
@@ -52,22 +78,76 @@ public:
     void debugOutput() const;
 
 private:
-    map<string, string> _expectedResults;
-    set<string> _validCategories;
+    struct Entry {
+        Entry() : _pathStart(0), _pathLength(0), _category(0) {}
+
+        // Use default copy constructor, copy operator and destructor
+
+        // Position of the path in the path storage
+        size_t _pathStart;
+        unsigned int _pathLength;
+
+        unsigned int _category;
+    };
+
+    // Paths of all documents, end to end
+    string _paths;
+
+    vector<Entry> _entries;
+
+    // Valid categories in name order. Position is the ID
+    vector<string> _categories;
+
+    /* Hash index into the entries. Slots hold the entry number plus one, and
+        zero marks an empty slot. Size is a power of two */
+    vector<unsigned int> _index;
+
+    // Hash a path, ignoring the difference between path separators
+    static size_t hashPath(const char* path, size_t length);
+
+    // Returns true if two paths match, ignoring the difference between path separators
+    static bool pathsMatch(const char* path1, const char* path2, size_t length);
+
+    // Find the index slot for a path. Either holds the path, or is empty
+    size_t findSlot(const char* path, size_t length) const;
 };
 
+inline size_t ExpectedResults::getCategoryCount() const
+{
+    return _categories.size();
+}
+
+inline const string& ExpectedResults::getCategoryName(size_t categoryId) const
+{
+    return _categories[categoryId];
+}
+
+inline const vector<string>& ExpectedResults::getCategories() const
+{
+    return _categories;
+}
+
+inline size_t ExpectedResults::getCorrectCategoryId(const char* fileName, size_t length) const
+{
+    unsigned int entry = _index[findSlot(fileName, length)];
+    if (entry == 0)
+        return NoCategory;
+    else
+        return _entries[entry - 1]._category;
+}
+
 inline string ExpectedResults::getCorrectCategory(const string& fileName) const
 {
-    map<string, string>::const_iterator index = _expectedResults.find(fileName);
-    if (index != _expectedResults.end())
-        return index->second;
+    size_t category = getCorrectCategoryId(fileName.data(), fileName.length());
+    if (category != NoCategory)
+        return _categories[category];
     else
         return string("");
 }
 
 inline bool ExpectedResults::isCatValid(const string& category) const
 {
-    return _validCategories.find(category) != _validCategories.end();
+    return getCategoryId(category.data(), category.length()) != NoCategory;
 }
 
 #endif // EXPECTED_RESULTS_H
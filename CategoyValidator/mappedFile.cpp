@@ -0,0 +1,87 @@
+/* This file is part of Cagtegoy Validator for BayseanClassifier.
+    It verifies the classification of documents against expected
+    results and computes the accuacy of classification.
+
+    Copyright (C) 2016   Ezra Erb
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License version 3 as published
+    by the Free Software Foundation.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+    I'd appreciate a note if you find this program useful or make
+    updates. Please contact me through LinkedIn (my profile also has
+    a link to the code depository)
+*/
+#include <string>
+#include <sstream>
+#include "windows.h"
+#include "mappedFile.h"
+#include "baseException.h"
+
+using namespace std;
+
+// Map the entire file
+MappedFile::MappedFile(const string& fileName)
+    : _file(INVALID_HANDLE_VALUE), _mapping(NULL), _data(NULL), _size(0)
+{
+    try {
+        _file = CreateFile(fileName.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL,
+                           OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+        LARGE_INTEGER fileSize;
+        if ((_file == INVALID_HANDLE_VALUE) || (!GetFileSizeEx(_file, &fileSize))) {
+            stringstream errorMessage;
+            errorMessage << "Error, file " << fileName << " could not be opened";
+            THROW_BASE_EXCEPTION(errorMessage.str().c_str());
+        }
+        if ((unsigned long long)fileSize.QuadPart > (size_t)-1) {
+            stringstream errorMessage;
+            errorMessage << "Error, file " << fileName << " too large to map into memory";
+            THROW_BASE_EXCEPTION(errorMessage.str().c_str());
+        }
+        _size = (size_t)fileSize.QuadPart;
+
+        // Windows can't map an empty file, and there is nothing to read anyway
+        if (_size > 0) {
+            _mapping = CreateFileMapping(_file, NULL, PAGE_READONLY, 0, 0, NULL);
+            if (_mapping != NULL)
+                _data = (const char*)MapViewOfFile(_mapping, FILE_MAP_READ, 0, 0, 0);
+            if (_data == NULL) {
+                stringstream errorMessage;
+                errorMessage << "Error, file " << fileName << " could not be mapped into memory";
+                THROW_BASE_EXCEPTION(errorMessage.str().c_str());
+            }
+        }
+    }
+    catch (...) {
+        close();
+        throw;
+    }
+}
+
+MappedFile::~MappedFile()
+{
+    close();
+}
+
+// Release all handles
+void MappedFile::close()
+{
+    if (_data != NULL)
+        UnmapViewOfFile(_data);
+    if (_mapping != NULL)
+        CloseHandle(_mapping);
+    if (_file != INVALID_HANDLE_VALUE)
+        CloseHandle(_file);
+    _data = NULL;
+    _mapping = NULL;
+    _file = INVALID_HANDLE_VALUE;
+    _size = 0;
+}
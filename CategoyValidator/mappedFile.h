@@ -0,0 +1,76 @@
+#ifndef MAPPED_FILE_H
+#define MAPPED_FILE_H
+
+/* This file is part of Cagtegoy Validator for BayseanClassifier.
+    It verifies the classification of documents against expected
+    results and computes the accuacy of classification.
+
+    Copyright (C) 2016   Ezra Erb
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License version 3 as published
+    by the Free Software Foundation.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+    I'd appreciate a note if you find this program useful or make
+    updates. Please contact me through LinkedIn (my profile also has
+    a link to the code depository)
+*/
+
+/* This class maps a file into memory for reading. Large files can then be
+    parsed in place, by several threads at once, without copying them into
+    buffers first. Mapping files is OS specific, so this class encapsulates
+    the details from the rest of the evaluator. Currently only a Windows
+    implementation is available */
+#include <string>
+
+using std::string;
+
+class MappedFile
+{
+public:
+    /* Map the entire file. If it can not be opened or mapped, construction
+        fails and an exception is thrown */
+    explicit MappedFile(const string& fileName);
+
+    ~MappedFile();
+
+    // Contents of the file. NULL for an empty file
+    const char* getData() const;
+
+    size_t getSize() const;
+
+private:
+    // OS handles for the open file and its mapping
+    void* _file;
+    void* _mapping;
+
+    const char* _data;
+    size_t _size;
+
+    // Release all handles
+    void close();
+
+    // Make non-copyable, owns the mapping
+    MappedFile(const MappedFile& other);
+    MappedFile& operator=(const MappedFile& other);
+};
+
+inline const char* MappedFile::getData() const
+{
+    return _data;
+}
+
+inline size_t MappedFile::getSize() const
+{
+    return _size;
+}
+
+#endif // MAPPED_FILE_H